@@ -0,0 +1,117 @@
+#include "backupstatuscache.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QStringList>
+
+namespace {
+
+constexpr quint32 CacheMagic = 0x50424353; // "PBCS"
+constexpr quint16 CacheVersion = 1;
+// host index, type index, vmid, backupTime, size and an empty verifyState.
+constexpr qint64 MinRecordBytes = 2 + 1 + 4 + 8 + 8 + 4;
+
+} // namespace
+
+QString BackupStatusCache::defaultPath() {
+    const QString base = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (base.isEmpty()) {
+        return {};
+    }
+    return base + QStringLiteral("/proxmon/backup-status.bin");
+}
+
+bool BackupStatusCache::load(const QString &path, QHash<BackupKey, PBSSnapshot> *table, qint64 *savedAt) {
+    if (path.isEmpty()) return false;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    in >> magic >> version;
+    if (magic != CacheMagic || version != CacheVersion) return false;
+
+    qint64 stamp = 0;
+    QStringList hosts;
+    QStringList types;
+    quint32 count = 0;
+    in >> stamp >> hosts >> types >> count;
+    if (in.status() != QDataStream::Ok) return false;
+    // count comes from the file; a corrupt one must not size an allocation.
+    if (qint64(count) > (file.size() - file.pos()) / MinRecordBytes) return false;
+
+    QHash<BackupKey, PBSSnapshot> loaded;
+    loaded.reserve(qsizetype(count));
+    for (quint32 i = 0; i < count; ++i) {
+        quint16 hostIndex = 0;
+        quint8 typeIndex = 0;
+        qint32 vmid = 0;
+        PBSSnapshot snapshot;
+        in >> hostIndex >> typeIndex >> vmid >> snapshot.backupTime >> snapshot.size >> snapshot.verifyState;
+        if (in.status() != QDataStream::Ok || hostIndex >= hosts.size() || typeIndex >= types.size()) {
+            return false;
+        }
+        snapshot.vmid = vmid;
+        snapshot.backupType = types.at(typeIndex);
+        loaded.insert(BackupKey{hosts.at(hostIndex), snapshot.backupType, vmid}, snapshot);
+    }
+
+    *table = std::move(loaded);
+    if (savedAt) *savedAt = stamp;
+    return true;
+}
+
+bool BackupStatusCache::save(const QString &path, const QHash<BackupKey, PBSSnapshot> &table) {
+    if (path.isEmpty()) return false;
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) return false;
+
+    // Hosts and backup types repeat on every entry; write each once and refer
+    // to them by index.
+    QStringList hosts;
+    QStringList types;
+    QHash<QString, quint16> hostIndex;
+    QHash<QString, quint8> typeIndex;
+    for (auto it = table.constBegin(); it != table.constEnd(); ++it) {
+        if (!hostIndex.contains(it.key().pbsHost)) {
+            if (hosts.size() >= 0xffff) return false;
+            hostIndex.insert(it.key().pbsHost, quint16(hosts.size()));
+            hosts.push_back(it.key().pbsHost);
+        }
+        if (!typeIndex.contains(it.key().backupType)) {
+            if (types.size() >= 0xff) return false;
+            typeIndex.insert(it.key().backupType, quint8(types.size()));
+            types.push_back(it.key().backupType);
+        }
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << CacheMagic << CacheVersion
+        << qint64(QDateTime::currentSecsSinceEpoch())
+        << hosts << types << quint32(table.size());
+    for (auto it = table.constBegin(); it != table.constEnd(); ++it) {
+        const PBSSnapshot &snapshot = it.value();
+        out << hostIndex.value(it.key().pbsHost)
+            << typeIndex.value(it.key().backupType)
+            << qint32(it.key().vmid)
+            << snapshot.backupTime
+            << snapshot.size
+            << snapshot.verifyState;
+    }
+    if (out.status() != QDataStream::Ok) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
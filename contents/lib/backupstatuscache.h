@@ -0,0 +1,18 @@
+#pragma once
+
+#include <QHash>
+#include <QString>
+
+#include "pbstypes.h"
+
+// On-disk copy of the latest-backup table so backup dots can be drawn from
+// the previous session before the first PBS crawl finishes. Versioned binary
+// (QDataStream); an unknown magic/version or a short read is treated as "no
+// cache" rather than an error.
+class BackupStatusCache {
+public:
+    static QString defaultPath();
+
+    static bool load(const QString &path, QHash<BackupKey, PBSSnapshot> *table, qint64 *savedAt = nullptr);
+    static bool save(const QString &path, const QHash<BackupKey, PBSSnapshot> &table);
+};
@@ -0,0 +1,44 @@
+#include "consoleiothread.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QTimer>
+
+// Heartbeat on the I/O thread. A tick this late means something parked
+// there blocked its event loop — and with it every console's sockets.
+static constexpr int kHeartbeatMs = 1000;
+static constexpr int kStallWarnMs = 100;
+
+QThread *consoleIoThread()
+{
+    static QThread *thread = [] {
+        auto *t = new QThread;
+        t->setObjectName(QStringLiteral("ProxMon console I/O"));
+        // Transport objects still parked here at exit go down with the
+        // process; their sockets close with it.
+        QObject::connect(qApp, &QCoreApplication::aboutToQuit, t, [t]() {
+            t->quit();
+            t->wait();
+        });
+
+        auto *heartbeat = new QTimer;
+        heartbeat->setInterval(kHeartbeatMs);
+        heartbeat->moveToThread(t);
+        QObject::connect(t, &QThread::started, heartbeat, [heartbeat]() {
+            QElapsedTimer clock;
+            clock.start();
+            QObject::connect(heartbeat, &QTimer::timeout, heartbeat, [clock]() mutable {
+                const qint64 late = clock.restart() - kHeartbeatMs;
+                if (late > kStallWarnMs)
+                    qWarning().noquote() << QStringLiteral("[ConsoleIo] event loop blocked for ~%1 ms").arg(late);
+            });
+            heartbeat->start();
+        });
+        QObject::connect(t, &QThread::finished, heartbeat, &QObject::deleteLater);
+        t->start();
+        return t;
+    }();
+    return thread;
+}
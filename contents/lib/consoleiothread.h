@@ -0,0 +1,15 @@
+#pragma once
+
+class QThread;
+
+// Process-wide event-loop thread for console transports. VncWsProxy and
+// LxcTerminal park their sockets here so a busy GUI thread (layout passes,
+// expensive bindings, synchronous D-Bus calls in plasmashell) doesn't stall
+// the console byte streams. Started on first use, stopped when the
+// application quits. Call from the GUI thread.
+//
+// Every console shares this loop, so nothing parked here may block: no
+// waitFor*(), no sleeps, no nested event loops. Throttle by pausing reads
+// and resuming from bytesWritten instead. A heartbeat logs a warning when
+// the loop falls behind.
+QThread *consoleIoThread();
@@ -0,0 +1,58 @@
+#include "filterrules.h"
+
+#include <QStringList>
+
+FilterRules::FilterRules(const QString &patterns, const QString &tag)
+    : m_tag(tag.trimmed()) {
+    const QStringList tokens = patterns.split(QLatin1Char(','), Qt::SkipEmptyParts);
+    for (const QString &raw : tokens) {
+        const QString token = raw.trimmed().toLower();
+        if (token.isEmpty()) continue;
+
+        if (token.contains(QLatin1Char('*'))) {
+            // Escape everything, then turn the escaped "*" back into ".*".
+            QString pattern = QRegularExpression::escape(token);
+            pattern.replace(QStringLiteral("\\*"), QStringLiteral(".*"));
+            QRegularExpression re(QRegularExpression::anchoredPattern(pattern),
+                                  QRegularExpression::CaseInsensitiveOption);
+            if (re.isValid()) {
+                re.optimize();
+                m_wildcards.push_back(re);
+            }
+            continue;
+        }
+
+        bool numeric = false;
+        const int vmid = token.toInt(&numeric);
+        if (numeric) {
+            m_vmids.insert(vmid);
+        }
+        m_names.insert(token);
+    }
+}
+
+bool FilterRules::isEmpty() const {
+    return m_vmids.isEmpty() && m_names.isEmpty() && m_wildcards.isEmpty() && m_tag.isEmpty();
+}
+
+bool FilterRules::matches(const Row &row) const {
+    if (!m_tag.isEmpty() && row.tags.contains(m_tag, Qt::CaseInsensitive)) {
+        return true;
+    }
+    if (m_vmids.contains(row.vmid)) {
+        return true;
+    }
+    if (!row.name.isEmpty() && !m_names.isEmpty() && m_names.contains(row.name.toLower())) {
+        return true;
+    }
+    if (m_wildcards.isEmpty()) {
+        return false;
+    }
+    const QString vmidText = QString::number(row.vmid);
+    for (const QRegularExpression &re : m_wildcards) {
+        if ((!row.name.isEmpty() && re.match(row.name).hasMatch()) || re.match(vmidText).hasMatch()) {
+            return true;
+        }
+    }
+    return false;
+}
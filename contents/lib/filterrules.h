@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QList>
+#include <QRegularExpression>
+#include <QSet>
+#include <QString>
+
+// Comma-separated filter list compiled once into lookup structures, so a
+// row is matched without re-splitting or re-building patterns:
+//   "101"   -> vmid (also compared against the name, like the old QML filter)
+//   "web01" -> exact name, case-insensitive
+//   "web*"  -> anchored wildcard over name and vmid, case-insensitive
+// An optional tag is matched as a case-insensitive substring of the row's
+// tag string.
+class FilterRules {
+public:
+    struct Row {
+        int vmid = 0;
+        QString name; // empty: name rules are skipped
+        QString tags;
+    };
+
+    FilterRules() = default;
+    explicit FilterRules(const QString &patterns, const QString &tag = QString());
+
+    bool isEmpty() const;
+    bool matches(const Row &row) const;
+
+private:
+    QSet<int> m_vmids;
+    QSet<QString> m_names;            // lowercased
+    QList<QRegularExpression> m_wildcards;
+    QString m_tag;
+};
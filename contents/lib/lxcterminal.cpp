@@ -1,5 +1,7 @@
 #include "lxcterminal.h"
 
+#include "consoleiothread.h"
+
 #include <QCloseEvent>
 #include <QContextMenuEvent>
 #include <QMenu>
@@ -20,6 +22,7 @@
 #include <QVBoxLayout>
 #include <QWebSocket>
 #include <QWidget>
+#include <utility>
 
 #include <qtermwidget.h>
 
@@ -43,6 +46,93 @@ protected:
 
 } // namespace
 
+// Owns the terminal WebSocket on consoleIoThread(). It only moves bytes and
+// sends the auth line; protocol state stays with LxcTerminal, which hears
+// back through queued signals.
+class LxcTerminalSocket : public QObject {
+    Q_OBJECT
+public:
+    struct Session {
+        QUrl       url;
+        QString    user;
+        QByteArray ticket;
+        QByteArray authHeader;
+        bool       ignoreSsl = false;
+    };
+
+    ~LxcTerminalSocket() override
+    {
+        if (m_ws) m_ws->close();
+        m_authHeader.fill(0);
+        m_authHeader.clear();
+        m_ticket.fill(0);
+        m_ticket.clear();
+    }
+
+    // Takes the credentials out of session (moved, not copied).
+    void open(Session &session)
+    {
+        m_user       = session.user;
+        m_ticket     = std::exchange(session.ticket, QByteArray());
+        m_authHeader = std::exchange(session.authHeader, QByteArray());
+
+        m_ws = new QWebSocket(QString(), QWebSocketProtocol::VersionLatest, this);
+
+        if (session.ignoreSsl) {
+            QSslConfiguration cfg = m_ws->sslConfiguration();
+            cfg.setPeerVerifyMode(QSslSocket::VerifyNone);
+            m_ws->setSslConfiguration(cfg);
+            QObject::connect(m_ws, &QWebSocket::sslErrors, this,
+                [this](const QList<QSslError> &) { m_ws->ignoreSslErrors(); });
+        }
+
+        QObject::connect(m_ws, &QWebSocket::connected, this, [this]() {
+            // Upgrade complete — burn auth header, send user:ticket\n, burn ticket.
+            m_authHeader.fill(0);
+            m_authHeader.clear();
+            QByteArray ba = m_user.toUtf8() + ':' + m_ticket + '\n';
+            m_ws->sendTextMessage(QString::fromUtf8(ba));
+            ba.fill(0);
+            m_ticket.fill(0);
+            m_ticket.clear();
+            emit authSent();
+        });
+        QObject::connect(m_ws, &QWebSocket::disconnected, this, &LxcTerminalSocket::closed);
+        QObject::connect(m_ws, &QWebSocket::errorOccurred, this,
+            [this](QAbstractSocket::SocketError) { emit failed(m_ws->errorString()); });
+        QObject::connect(m_ws, &QWebSocket::textMessageReceived, this,
+            [this](const QString &text) { emit received(text.toUtf8()); });
+        QObject::connect(m_ws, &QWebSocket::binaryMessageReceived, this,
+            &LxcTerminalSocket::received);
+
+        QNetworkRequest req(session.url);
+        if (!m_authHeader.isEmpty()) {
+            // Required — Proxmox returns 401 without it.
+            req.setRawHeader("Authorization", m_authHeader);
+        }
+        m_ws->open(req);
+    }
+
+    void send(const QString &frame)
+    {
+        if (m_ws && m_ws->state() == QAbstractSocket::ConnectedState)
+            m_ws->sendTextMessage(frame);
+    }
+
+signals:
+    // The upgrade completed and the user:ticket auth line is on the wire.
+    void authSent();
+    void received(const QByteArray &data);
+    void closed();
+    void failed(const QString &message);
+
+private:
+    QWebSocket *m_ws = nullptr;
+    QString     m_user;
+    QByteArray  m_ticket;
+    QByteArray  m_authHeader;
+};
+
 LxcTerminal::LxcTerminal(QObject *parent)
     : QObject(parent)
 {
@@ -114,12 +204,7 @@ void LxcTerminal::raise()
 
 void LxcTerminal::disconnect()
 {
-    if (m_ws) {
-        m_ws->disconnect(this);
-        m_ws->close();
-        m_ws->deleteLater();
-        m_ws = nullptr;
-    }
+    releaseSocket();
     m_phase = Phase::Disconnected;
     m_authBuffer.clear();
     if (m_state != QStringLiteral("disconnected")) {
@@ -215,13 +300,8 @@ void LxcTerminal::openSocket()
         return;
     }
 
-    if (m_ws) {
-        // Tear down any previous socket cleanly before re-opening.
-        m_ws->disconnect(this);
-        m_ws->close();
-        m_ws->deleteLater();
-        m_ws = nullptr;
-    }
+    // Tear down any previous socket cleanly before re-opening.
+    releaseSocket();
 
     setState(QStringLiteral("connecting"));
     m_phase = Phase::Connecting;
@@ -240,67 +320,66 @@ void LxcTerminal::openSocket()
                    QString::fromLatin1(m_ticket.toPercentEncoding()));
     url.setQuery(q);
 
-    m_ws = new QWebSocket(QString(), QWebSocketProtocol::VersionLatest, this);
-
-    if (m_ignoreSsl) {
-        QSslConfiguration cfg = m_ws->sslConfiguration();
-        cfg.setPeerVerifyMode(QSslSocket::VerifyNone);
-        m_ws->setSslConfiguration(cfg);
-        QObject::connect(m_ws, &QWebSocket::sslErrors, this,
-            [this](const QList<QSslError> &) {
-                if (m_ws) m_ws->ignoreSslErrors();
-            });
-    }
+    auto *socket = new LxcTerminalSocket;
+    socket->moveToThread(consoleIoThread());
+    m_socket = socket;
 
-    QObject::connect(m_ws, &QWebSocket::connected, this, [this]() {
-        // Upgrade complete — burn auth header, send user:ticket\n, burn ticket.
-        m_authHeader.fill(0);
-        m_authHeader.clear();
+    QObject::connect(socket, &LxcTerminalSocket::authSent, this, [this, socket]() {
+        if (socket != m_socket) return;
         m_phase = Phase::Authenticating;
-        if (m_ws) {
-            QByteArray ba = m_user.toUtf8() + ':' + m_ticket + '\n';
-            m_ws->sendTextMessage(QString::fromUtf8(ba));
-            ba.fill(0);
-            m_ticket.fill(0);
-            m_ticket.clear();
-        }
     });
 
-    QObject::connect(m_ws, &QWebSocket::disconnected, this, [this]() {
-        if (m_phase == Phase::Errored) return;
+    QObject::connect(socket, &LxcTerminalSocket::closed, this, [this, socket]() {
+        if (socket != m_socket || m_phase == Phase::Errored) return;
         setState(QStringLiteral("disconnected"));
         m_phase = Phase::Disconnected;
     });
 
-    QObject::connect(m_ws, &QWebSocket::errorOccurred, this,
-        [this](QAbstractSocket::SocketError) {
-            if (!m_ws) return;
-            const QString msg = m_ws->errorString();
+    QObject::connect(socket, &LxcTerminalSocket::failed, this,
+        [this, socket](const QString &msg) {
+            if (socket != m_socket) return;
             m_phase = Phase::Errored;
             setState(QStringLiteral("error"));
             emit errorOccurred(msg.isEmpty() ? QStringLiteral("LXC terminal error") : msg);
         });
 
-    QObject::connect(m_ws, &QWebSocket::textMessageReceived, this,
-        &LxcTerminal::handleTextFrame);
-    QObject::connect(m_ws, &QWebSocket::binaryMessageReceived, this,
-        &LxcTerminal::handleBinaryFrame);
+    QObject::connect(socket, &LxcTerminalSocket::received, this,
+        [this, socket](const QByteArray &data) {
+            if (socket != m_socket) return;
+            handleBinaryFrame(data);
+        });
 
-    QNetworkRequest req(url);
-    if (!m_authHeader.isEmpty()) {
-        // Required — Proxmox returns 401 without it.
-        req.setRawHeader("Authorization", m_authHeader);
-    }
-    m_ws->open(req);
+    // Credentials move to the socket; the I/O thread burns them once sent.
+    LxcTerminalSocket::Session session;
+    session.url        = url;
+    session.user       = m_user;
+    session.ticket     = std::exchange(m_ticket, QByteArray());
+    session.authHeader = std::exchange(m_authHeader, QByteArray());
+    session.ignoreSsl  = m_ignoreSsl;
+    QMetaObject::invokeMethod(socket, [socket, session = std::move(session)]() mutable {
+        socket->open(session);
+    }, Qt::QueuedConnection);
 }
 
-// -------- WebSocket frame handlers --------
+void LxcTerminal::releaseSocket()
+{
+    if (!m_socket) return;
+    LxcTerminalSocket *socket = std::exchange(m_socket, nullptr);
+    socket->disconnect(this);
+    // Runs on the I/O thread; the destructor closes the WebSocket.
+    socket->deleteLater();
+}
 
-void LxcTerminal::handleTextFrame(const QString &text)
+void LxcTerminal::sendFrame(const QString &frame)
 {
-    handleBinaryFrame(text.toUtf8());
+    if (!m_socket) return;
+    LxcTerminalSocket *socket = m_socket;
+    QMetaObject::invokeMethod(socket, [socket, frame]() { socket->send(frame); },
+                              Qt::QueuedConnection);
 }
 
+// -------- WebSocket frame handlers --------
+
 void LxcTerminal::handleBinaryFrame(const QByteArray &data)
 {
     if (m_phase == Phase::Authenticating) {
@@ -354,8 +433,8 @@ void LxcTerminal::handleAuthLine(const QByteArray &line)
         m_postAuthBytes = 0;
         QTimer::singleShot(500, this, [this]() {
             const int threshold = 24;
-            if (m_phase == Phase::Connected && m_ws && m_postAuthBytes < threshold) {
-                m_ws->sendTextMessage(QStringLiteral("0:1:\r"));
+            if (m_phase == Phase::Connected && m_postAuthBytes < threshold) {
+                sendFrame(QStringLiteral("0:1:\r"));
             }
         });
         return;
@@ -376,10 +455,10 @@ void LxcTerminal::handleAuthLine(const QByteArray &line)
 
 void LxcTerminal::onTerminalSendDataRaw(const char *s, int len)
 {
-    if (!m_ws || m_phase != Phase::Connected || !s || len <= 0) return;
+    if (m_phase != Phase::Connected || !s || len <= 0) return;
     const QByteArray frame = QByteArrayLiteral("0:") + QByteArray::number(len)
                              + QByteArrayLiteral(":") + QByteArray(s, len);
-    m_ws->sendTextMessage(QString::fromUtf8(frame));
+    sendFrame(QString::fromUtf8(frame));
 }
 
 void LxcTerminal::sendCurrentResize()
@@ -403,9 +482,9 @@ void LxcTerminal::sendCurrentResize()
     }
 
     // Notify the remote side so its apps get SIGWINCH.
-    if (m_ws && m_phase == Phase::Connected) {
+    if (m_phase == Phase::Connected) {
         const QString frame = QStringLiteral("1:%1:%2:").arg(columns).arg(lines);
-        m_ws->sendTextMessage(frame);
+        sendFrame(frame);
     }
 }
 
@@ -5,13 +5,15 @@
 #include <QPointer>
 #include <QString>
 
-class QWebSocket;
 class QMainWindow;
 class QTermWidget;
+class LxcTerminalSocket;
 
 // Protocol layer + window manager for Proxmox LXC console sessions.
 // Owns a QMainWindow+QTermWidget (QWidget can't embed in QML).
 // Credentials delivered via setAuthHeaderSecure / setTicketSecure.
+// The WebSocket itself lives on consoleIoThread() (LxcTerminalSocket); this
+// object keeps the protocol state and the widgets on the GUI thread.
 // See docs/ARCHITECTURE.md for protocol and design rationale.
 class LxcTerminal : public QObject {
     Q_OBJECT
@@ -77,10 +79,11 @@ private:
     void ensureWindow(const QString &vmName, const QString &nodeName);
     void destroyWindow();
     void openSocket();
+    void releaseSocket();
+    void sendFrame(const QString &frame);
     void deliverToTerminal(const QByteArray &data);
 
     // WebSocket frame handlers
-    void handleTextFrame(const QString &text);
     void handleBinaryFrame(const QByteArray &data);
     void handleAuthLine(const QByteArray &line);
 
@@ -107,7 +110,9 @@ protected:
 
     QPointer<QMainWindow> m_window;
     QPointer<QTermWidget> m_term;
-    QWebSocket *m_ws = nullptr;
+    // A fresh socket per openSocket(); signals from a released one are
+    // ignored even if they were already queued.
+    LxcTerminalSocket *m_socket = nullptr;
     // Bytes received post-auth before our wake-CR timer expires. Used to
     // decide whether to send a wake CR — boolean isn't enough because some
     // containers emit a 6-byte clear-screen sequence on attach and then go
@@ -1,46 +1,330 @@
 #include "notifier.h"
 
-#include <QDBusConnection>
-#include <QDBusInterface>
+#include <algorithm>
+#include <utility>
+
 #include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
 #include <QDBusPendingReply>
+#include <QRegularExpression>
+#include <QSet>
 #include <QVariantList>
 
+namespace {
+const QString kService = QStringLiteral("org.freedesktop.Notifications");
+const QString kPath = QStringLiteral("/org/freedesktop/Notifications");
+const QString kInterface = QStringLiteral("org.freedesktop.Notifications");
+const QString kDefaultIcon = QStringLiteral("proxmox-monitor");
+constexpr int kBatchWindowMs = 250;
+constexpr int kTimeoutMs = 5000;
+} // namespace
+
 Notifier::Notifier(QObject *parent)
-    : QObject(parent) {}
+    : QObject(parent)
+    , m_bus(QDBusConnection::sessionBus()) {
+    m_clock.start();
+
+    m_batchTimer.setSingleShot(true);
+    m_batchTimer.setInterval(kBatchWindowMs);
+    connect(&m_batchTimer, &QTimer::timeout, this, &Notifier::flushTransitions);
+
+    if (!m_bus.isConnected()) {
+        return;
+    }
+
+    m_bus.connect(kService, kPath, kInterface, QStringLiteral("NotificationClosed"),
+                  this, SLOT(onNotificationClosed(uint,uint)));
+
+    // Resolved once; until it answers, notifications are sent as if the
+    // server supports a plain-text body (which every server does in practice).
+    const QDBusMessage caps = QDBusMessage::createMethodCall(kService, kPath, kInterface, QStringLiteral("GetCapabilities"));
+    auto *watcher = new QDBusPendingCallWatcher(m_bus.asyncCall(caps), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this](QDBusPendingCallWatcher *w) {
+        const QDBusPendingReply<QStringList> reply = *w;
+        if (!reply.isError()) {
+            m_capabilities = reply.value();
+            m_capabilitiesKnown = true;
+        }
+        w->deleteLater();
+    });
+}
+
+void Notifier::setEnabled(bool v) {
+    if (m_enabled == v) return;
+    m_enabled = v;
+    if (!m_enabled) {
+        m_batchTimer.stop();
+        m_pendingTransitions.clear();
+    }
+    emit enabledChanged();
+}
+
+void Notifier::setRateLimitEnabled(bool v) {
+    if (m_rateLimitEnabled == v) return;
+    m_rateLimitEnabled = v;
+    emit rateLimitEnabledChanged();
+}
+
+void Notifier::setRateLimitSeconds(int v) {
+    if (m_rateLimitSeconds == v) return;
+    m_rateLimitSeconds = v;
+    emit rateLimitSecondsChanged();
+}
+
+void Notifier::setRedactIdentities(bool v) {
+    if (m_redactIdentities == v) return;
+    m_redactIdentities = v;
+    emit redactIdentitiesChanged();
+}
 
 bool Notifier::notify(const QString &title,
                       const QString &message,
                       const QString &iconName,
                       int timeoutMs) {
-    const QString service = QStringLiteral("org.freedesktop.Notifications");
-    const QString path = QStringLiteral("/org/freedesktop/Notifications");
-    const QString iface = QStringLiteral("org.freedesktop.Notifications");
-
-    if (!QDBusConnection::sessionBus().isConnected()) {
+    if (!m_bus.isConnected()) {
         return false;
     }
+    deliver(QString(), title, message, iconName, timeoutMs);
+    return true;
+}
+
+void Notifier::send(const QString &title,
+                    const QString &message,
+                    const QString &iconName,
+                    const QString &rateLimitKey) {
+    if (!m_enabled) return;
+    if (isRateLimited(rateLimitKey)) return;
+    // Node notifications share one slot per node so "back online" replaces
+    // "offline" on screen. Everything else is a one-off.
+    QString category;
+    if (rateLimitKey.startsWith(QStringLiteral("node:"))) {
+        category = rateLimitKey.left(rateLimitKey.lastIndexOf(QLatin1Char(':')));
+    }
+    const QString safeTitle = sanitize(title);
+    const QString safeMessage = sanitize(message);
+    emit sent(safeTitle, safeMessage);
+    deliver(category, safeTitle, safeMessage, iconName, kTimeoutMs);
+    markSent(rateLimitKey);
+}
 
-    QDBusInterface i(service, path, iface, QDBusConnection::sessionBus());
-    if (!i.isValid()) {
-        return false;
+void Notifier::queueTransitions(const QVariantList &transitions) {
+    if (!m_enabled) return;
+    for (const QVariant &value : transitions) {
+        if (value.toMap().value(QStringLiteral("notify")).toBool()) {
+            m_pendingTransitions.push_back(value);
+        }
+    }
+    if (!m_pendingTransitions.isEmpty() && !m_batchTimer.isActive()) {
+        m_batchTimer.start();
+    }
+}
+
+void Notifier::flushTransitions() {
+    const QVariantList pending = std::exchange(m_pendingTransitions, {});
+
+    // scope ("single" | "multi") -> entries, in arrival order.
+    QHash<QString, QList<Entry>> started;
+    QHash<QString, QList<Entry>> stopped;
+    QStringList scopes;
+
+    for (const QVariant &value : pending) {
+        const QVariantMap t = value.toMap();
+        const QString type = t.value(QStringLiteral("type")).toString();
+        const QString sessionKey = t.value(QStringLiteral("sessionKey")).toString();
+        const QString node = t.value(QStringLiteral("node")).toString();
+        const QString current = t.value(QStringLiteral("current")).toString();
+
+        if (type == QStringLiteral("node")) {
+            const QString prefix = QStringLiteral("node:") + (sessionKey.isEmpty() ? QString() : sessionKey + QLatin1Char(':')) + node;
+            if (current == QStringLiteral("online")) {
+                send(QStringLiteral("Node Online"), node + QStringLiteral(" is back online"),
+                     QStringLiteral("dialog-information"), prefix + QStringLiteral(":online"));
+            } else {
+                send(QStringLiteral("Node Offline"), node + QStringLiteral(" is now ") + current,
+                     QStringLiteral("dialog-error"), prefix + QStringLiteral(":offline"));
+            }
+            continue;
+        }
+
+        const QString scope = sessionKey.isEmpty() ? QStringLiteral("single") : QStringLiteral("multi");
+        if (!scopes.contains(scope)) scopes.push_back(scope);
+        Entry entry;
+        entry.kind = type == QStringLiteral("lxc") ? QStringLiteral("CT") : QStringLiteral("VM");
+        entry.vmid = t.value(QStringLiteral("vmid")).toInt();
+        entry.name = t.value(QStringLiteral("name")).toString();
+        (current == QStringLiteral("running") ? started : stopped)[scope].push_back(entry);
+    }
+
+    for (const QString &scope : std::as_const(scopes)) {
+        sendGrouped(scope, QStringLiteral("started"), started.value(scope));
+        sendGrouped(scope, QStringLiteral("stopped"), stopped.value(scope));
+    }
+}
+
+void Notifier::sendGrouped(const QString &scope, const QString &verb, const QList<Entry> &entries) {
+    if (entries.isEmpty() || !m_enabled) return;
+
+    const bool isStart = verb == QStringLiteral("started");
+    auto entryId = [](const Entry &e) { return e.kind + QLatin1Char(':') + QString::number(e.vmid); };
+
+    // Rate limit on the set of guests in this batch, as before.
+    QStringList ids;
+    for (const Entry &e : entries) ids.push_back(entryId(e));
+    ids.sort();
+    const QString rateLimitKey = QStringLiteral("grouped:%1:%2:%3")
+        .arg(scope, isStart ? QStringLiteral("running") : QStringLiteral("stopped"), ids.join(QLatin1Char(',')));
+    if (isRateLimited(rateLimitKey)) return;
+
+    // While an earlier notification of this category is still on screen,
+    // fold the new guests into it.
+    const QString category = QStringLiteral("grouped:%1:%2").arg(scope, verb);
+    QList<Entry> merged = m_shown.value(category).entries;
+    QSet<QString> seen;
+    for (const Entry &e : std::as_const(merged)) seen.insert(entryId(e));
+    for (const Entry &e : entries) {
+        if (!seen.contains(entryId(e))) {
+            seen.insert(entryId(e));
+            merged.push_back(e);
+        }
+    }
+
+    QStringList sections;
+    bool hasVm = false;
+    bool hasCt = false;
+    for (const QString &kind : {QStringLiteral("VM"), QStringLiteral("CT")}) {
+        QStringList vmids;
+        QStringList names;
+        for (const Entry &e : std::as_const(merged)) {
+            if (e.kind != kind) continue;
+            vmids.push_back(QString::number(e.vmid));
+            names.push_back(e.name.isEmpty() ? QString::number(e.vmid) : e.name);
+        }
+        if (vmids.isEmpty()) continue;
+        (kind == QStringLiteral("VM") ? hasVm : hasCt) = true;
+        const QString label = kind == QStringLiteral("CT") ? QStringLiteral("LXCs") : QStringLiteral("VMs");
+        sections.push_back(label + QStringLiteral(": ") + vmids.join(QStringLiteral(", ")) + QStringLiteral("  ") + names.join(QStringLiteral(", ")));
+    }
+
+    const QString noun = hasVm && !hasCt ? QStringLiteral("VMs") : hasCt && !hasVm ? QStringLiteral("LXCs") : QStringLiteral("Workloads");
+    const QString title = noun + (isStart ? QStringLiteral(" Started") : QStringLiteral(" Stopped"));
+    const QString safeTitle = sanitize(title);
+    const QString safeMessage = sanitize(sections.join(QStringLiteral("; ")));
+    emit sent(safeTitle, safeMessage);
+    deliver(category,
+            safeTitle,
+            safeMessage,
+            isStart ? QStringLiteral("dialog-information") : QStringLiteral("dialog-warning"),
+            kTimeoutMs,
+            merged);
+    markSent(rateLimitKey);
+}
+
+void Notifier::deliver(const QString &category,
+                       const QString &title,
+                       const QString &message,
+                       const QString &iconName,
+                       int timeoutMs,
+                       const QList<Entry> &entries) {
+    const QString icon = iconName.isEmpty() ? kDefaultIcon : iconName;
+    if (!m_bus.isConnected()) {
+        emit fallbackRequested(title, message, icon);
+        return;
+    }
+
+    QString summary = title;
+    QString body = message;
+    if (m_capabilitiesKnown) {
+        if (!m_capabilities.contains(QStringLiteral("body"))) {
+            summary = body.isEmpty() ? title : title + QStringLiteral(": ") + body;
+            body.clear();
+        } else if (m_capabilities.contains(QStringLiteral("body-markup"))) {
+            body = body.toHtmlEscaped();
+        }
+    }
+
+    uint replacesId = 0;
+    if (!category.isEmpty()) {
+        Shown &shown = m_shown[category];
+        replacesId = shown.id;
+        shown.entries = entries;
     }
 
     // Notify(app_name, replaces_id, app_icon, summary, body, actions, hints, expire_timeout)
     QVariantList args;
     args << QStringLiteral("Proxmox Monitor");  // app_name
-    args << uint(0);                            // replaces_id
-    args << iconName;                           // app_icon
-    args << title;                              // summary
-    args << message;                            // body
+    args << replacesId;                         // replaces_id
+    args << icon;                               // app_icon
+    args << summary;                            // summary
+    args << body;                               // body
     args << QStringList();                      // actions
     args << QVariantMap();                      // hints
-    args << int(timeoutMs);                     // expire_timeout (ms)
+    args << int(timeoutMs);
 
-    QDBusMessage m = QDBusMessage::createMethodCall(service, path, iface, QStringLiteral("Notify"));
+    QDBusMessage m = QDBusMessage::createMethodCall(kService, kPath, kInterface, QStringLiteral("Notify"));
     m.setArguments(args);
 
-    // Best-effort: fire-and-forget. Don't block the UI thread waiting on D-Bus.
-    QDBusConnection::sessionBus().asyncCall(m);
-    return true;
+    auto *watcher = new QDBusPendingCallWatcher(m_bus.asyncCall(m), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, category, title, message, icon](QDBusPendingCallWatcher *w) {
+        const QDBusPendingReply<uint> reply = *w;
+        w->deleteLater();
+        if (reply.isError()) {
+            if (!category.isEmpty()) m_shown.remove(category);
+            emit fallbackRequested(title, message, icon);
+            return;
+        }
+        if (!category.isEmpty()) {
+            auto it = m_shown.find(category);
+            if (it != m_shown.end()) it->id = reply.value();
+        }
+    });
+}
+
+void Notifier::onNotificationClosed(uint id, uint reason) {
+    Q_UNUSED(reason)
+    for (auto it = m_shown.begin(); it != m_shown.end();) {
+        if (it->id == id) {
+            it = m_shown.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool Notifier::isRateLimited(const QString &key) const {
+    if (!m_rateLimitEnabled || m_rateLimitSeconds <= 0 || key.isEmpty()) return false;
+    const auto it = m_lastSent.constFind(key);
+    if (it == m_lastSent.constEnd()) return false;
+    return m_clock.elapsed() - it.value() < qint64(m_rateLimitSeconds) * 1000;
+}
+
+void Notifier::markSent(const QString &key) {
+    if (key.isEmpty()) return;
+    const qint64 now = m_clock.elapsed();
+    // Keys embed guest sets, so prune expired ones to keep the map bounded.
+    if (m_lastSent.size() > 256) {
+        const qint64 windowMs = qint64(std::max(0, m_rateLimitSeconds)) * 1000;
+        for (auto it = m_lastSent.begin(); it != m_lastSent.end();) {
+            if (now - it.value() >= windowMs) {
+                it = m_lastSent.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    m_lastSent.insert(key, now);
+}
+
+QString Notifier::sanitize(const QString &text) const {
+    static const QRegularExpression newlines(QStringLiteral("[\\r\\n]+"));
+    // "user@realm" -> "REDACTED@realm", "!tokenid" -> "!REDACTED"
+    static const QRegularExpression userAtRealm(QStringLiteral("([A-Za-z0-9._-]+)@([A-Za-z0-9._-]+)"));
+    static const QRegularExpression tokenId(QStringLiteral("!([A-Za-z0-9._:-]+)"));
+
+    QString out = text;
+    out.replace(newlines, QStringLiteral(" "));
+    if (m_redactIdentities) {
+        out.replace(userAtRealm, QStringLiteral("REDACTED@\\2"));
+        out.replace(tokenId, QStringLiteral("!REDACTED"));
+    }
+    return out;
 }
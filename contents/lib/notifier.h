@@ -1,20 +1,118 @@
 #pragma once
+#include <QDBusConnection>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QObject>
 #include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <QVariant>
 
 /*
  * System-agnostic notifications via org.freedesktop.Notifications (D-Bus).
- * Works on KDE, GNOME, etc. Falls back to notify-send in QML if this fails.
+ * Works on KDE, GNOME, etc.
+ *
+ * Long-lived service: the session bus connection and the server
+ * capabilities are resolved once, every call is async, and state
+ * transitions are batched for a short window so a node reboot that flips
+ * dozens of guests produces one "started"/"stopped" notification each.
+ * Each notification category remembers the id the server assigned
+ * (replaces_id), so a newer batch updates the notification on screen
+ * instead of stacking a new one. Rate limiting is keyed like the QML code
+ * it replaced ("grouped:…", "node:…"). When D-Bus is unavailable,
+ * fallbackRequested() lets QML fall back to notify-send.
  */
 class Notifier : public QObject {
     Q_OBJECT
+    Q_PROPERTY(bool enabled READ enabled WRITE setEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(bool rateLimitEnabled READ rateLimitEnabled WRITE setRateLimitEnabled NOTIFY rateLimitEnabledChanged)
+    Q_PROPERTY(int rateLimitSeconds READ rateLimitSeconds WRITE setRateLimitSeconds NOTIFY rateLimitSecondsChanged)
+    Q_PROPERTY(bool redactIdentities READ redactIdentities WRITE setRedactIdentities NOTIFY redactIdentitiesChanged)
 
 public:
     explicit Notifier(QObject *parent = nullptr);
 
-    // Returns true if the D-Bus Notify call was sent successfully.
+    bool enabled() const { return m_enabled; }
+    void setEnabled(bool v);
+    bool rateLimitEnabled() const { return m_rateLimitEnabled; }
+    void setRateLimitEnabled(bool v);
+    int rateLimitSeconds() const { return m_rateLimitSeconds; }
+    void setRateLimitSeconds(int v);
+    bool redactIdentities() const { return m_redactIdentities; }
+    void setRedactIdentities(bool v);
+
+    // Unconditional send (no enable/rate-limit/redaction). Returns false if
+    // the session bus is not connected.
     Q_INVOKABLE bool notify(const QString &title,
                             const QString &message,
                             const QString &iconName = QStringLiteral("proxmox-monitor"),
                             int timeoutMs = 5000);
+
+    // Gated send: honours enabled, rate limiting (when rateLimitKey is set)
+    // and identity redaction.
+    Q_INVOKABLE void send(const QString &title,
+                          const QString &message,
+                          const QString &iconName = QString(),
+                          const QString &rateLimitKey = QString());
+
+    // Entries as emitted by ProxmoxController::stateTransitions(). Only
+    // entries with notify == true are shown; they are grouped after a short
+    // batching window.
+    Q_INVOKABLE void queueTransitions(const QVariantList &transitions);
+
+signals:
+    void enabledChanged();
+    void rateLimitEnabledChanged();
+    void rateLimitSecondsChanged();
+    void redactIdentitiesChanged();
+    // D-Bus delivery failed or is unavailable; title/message are already
+    // sanitized and redacted.
+    void fallbackRequested(const QString &title, const QString &message, const QString &iconName);
+    // A gated notification passed the checks and is being delivered. The
+    // text is sanitized and redacted like the notification itself, so it
+    // is safe for the debug log.
+    void sent(const QString &title, const QString &message);
+
+private slots:
+    void onNotificationClosed(uint id, uint reason);
+
+private:
+    struct Entry {
+        QString kind; // "VM" | "CT"
+        int vmid = 0;
+        QString name;
+    };
+    // A notification currently on screen for one category.
+    struct Shown {
+        uint id = 0;
+        QList<Entry> entries;
+    };
+
+    void flushTransitions();
+    void sendGrouped(const QString &scope, const QString &verb, const QList<Entry> &entries);
+    void deliver(const QString &category,
+                 const QString &title,
+                 const QString &message,
+                 const QString &iconName,
+                 int timeoutMs,
+                 const QList<Entry> &entries = {});
+    bool isRateLimited(const QString &key) const;
+    void markSent(const QString &key);
+    QString sanitize(const QString &text) const;
+
+    QDBusConnection m_bus;
+    QStringList m_capabilities;
+    bool m_capabilitiesKnown = false;
+
+    bool m_enabled = true;
+    bool m_rateLimitEnabled = true;
+    int m_rateLimitSeconds = 120;
+    bool m_redactIdentities = true;
+
+    QTimer m_batchTimer;
+    QVariantList m_pendingTransitions;
+
+    QHash<QString, Shown> m_shown; // category -> notification on screen
+    QElapsedTimer m_clock;
+    QHash<QString, qint64> m_lastSent; // rate-limit key -> m_clock ms
 };
@@ -0,0 +1,282 @@
+#include "pbssnapshotreducer.h"
+
+#include <QHash>
+
+namespace {
+
+constexpr int MaxNestingDepth = 64;
+
+// Minimal pull scanner over a JSON byte buffer. It only understands what the
+// PBS snapshot listing needs: walk objects/arrays, read strings and integers,
+// and skip everything else without materialising it.
+class JsonScanner {
+public:
+    explicit JsonScanner(const QByteArray &data)
+        : m_begin(data.constData()), m_p(data.constData()), m_end(data.constData() + data.size()) {}
+
+    const QString &error() const { return m_error; }
+
+    bool atNull() {
+        skipWhitespace();
+        return m_p < m_end && *m_p == 'n';
+    }
+
+    template <typename OnMember>
+    bool forEachMember(OnMember &&onMember) {
+        if (!consume('{')) return false;
+        if (tryConsume('}')) return true;
+        QByteArray key;
+        for (;;) {
+            if (!readString(&key) || !consume(':')) return false;
+            if (!onMember(key)) return false;
+            if (tryConsume(',')) continue;
+            return consume('}');
+        }
+    }
+
+    template <typename OnElement>
+    bool forEachElement(OnElement &&onElement) {
+        if (!consume('[')) return false;
+        if (tryConsume(']')) return true;
+        for (;;) {
+            if (!onElement()) return false;
+            if (tryConsume(',')) continue;
+            return consume(']');
+        }
+    }
+
+    bool readString(QByteArray *out) {
+        if (out) out->resize(0);
+        if (!consume('"')) return false;
+        while (m_p < m_end) {
+            const char c = *m_p++;
+            if (c == '"') return true;
+            if (c != '\\') {
+                if (out) out->append(c);
+                continue;
+            }
+            if (m_p >= m_end) break;
+            const char esc = *m_p++;
+            char decoded = 0;
+            switch (esc) {
+            case '"': case '\\': case '/': decoded = esc; break;
+            case 'b': decoded = '\b'; break;
+            case 'f': decoded = '\f'; break;
+            case 'n': decoded = '\n'; break;
+            case 'r': decoded = '\r'; break;
+            case 't': decoded = '\t'; break;
+            case 'u': {
+                if (m_end - m_p < 4) return fail(QStringLiteral("truncated \\u escape"));
+                char16_t unit = 0;
+                for (int i = 0; i < 4; ++i) {
+                    const char h = *m_p++;
+                    unit <<= 4;
+                    if (h >= '0' && h <= '9') unit |= char16_t(h - '0');
+                    else if (h >= 'a' && h <= 'f') unit |= char16_t(h - 'a' + 10);
+                    else if (h >= 'A' && h <= 'F') unit |= char16_t(h - 'A' + 10);
+                    else return fail(QStringLiteral("invalid \\u escape"));
+                }
+                // Fields we keep are plain ASCII; anything else only needs
+                // to round-trip well enough to be skipped or compared.
+                if (out) out->append(QString(QChar(unit)).toUtf8());
+                continue;
+            }
+            default:
+                return fail(QStringLiteral("invalid escape"));
+            }
+            if (out) out->append(decoded);
+        }
+        return fail(QStringLiteral("unterminated string"));
+    }
+
+    // Integers only; a fractional part or exponent is skipped (truncating).
+    // null reads as 0 so optional numeric fields don't abort the scan.
+    bool readInteger(qint64 *out) {
+        skipWhitespace();
+        if (atNull()) {
+            *out = 0;
+            return skipValue();
+        }
+        bool negative = false;
+        if (m_p < m_end && *m_p == '-') {
+            negative = true;
+            ++m_p;
+        }
+        const char *digits = m_p;
+        qint64 value = 0;
+        while (m_p < m_end && *m_p >= '0' && *m_p <= '9') {
+            value = value * 10 + (*m_p - '0');
+            ++m_p;
+        }
+        if (m_p == digits) return fail(QStringLiteral("expected number"));
+        while (m_p < m_end && (*m_p == '.' || *m_p == 'e' || *m_p == 'E' || *m_p == '+' || *m_p == '-'
+                               || (*m_p >= '0' && *m_p <= '9'))) {
+            ++m_p;
+        }
+        *out = negative ? -value : value;
+        return true;
+    }
+
+    bool skipValue(int depth = 0) {
+        if (depth > MaxNestingDepth) return fail(QStringLiteral("nesting too deep"));
+        skipWhitespace();
+        if (m_p >= m_end) return fail(QStringLiteral("unexpected end of input"));
+        switch (*m_p) {
+        case '"':
+            return readString(nullptr);
+        case '{':
+            return forEachMember([&](const QByteArray &) { return skipValue(depth + 1); });
+        case '[':
+            return forEachElement([&]() { return skipValue(depth + 1); });
+        case 't':
+            return literal("true");
+        case 'f':
+            return literal("false");
+        case 'n':
+            return literal("null");
+        default: {
+            qint64 ignored = 0;
+            return readInteger(&ignored);
+        }
+        }
+    }
+
+private:
+    void skipWhitespace() {
+        while (m_p < m_end && (*m_p == ' ' || *m_p == '\n' || *m_p == '\r' || *m_p == '\t')) ++m_p;
+    }
+
+    bool tryConsume(char c) {
+        skipWhitespace();
+        if (m_p < m_end && *m_p == c) {
+            ++m_p;
+            return true;
+        }
+        return false;
+    }
+
+    bool consume(char c) {
+        if (tryConsume(c)) return true;
+        return fail(QStringLiteral("expected '%1'").arg(QLatin1Char(c)));
+    }
+
+    bool literal(const char *word) {
+        for (const char *w = word; *w; ++w, ++m_p) {
+            if (m_p >= m_end || *m_p != *w) return fail(QStringLiteral("invalid literal"));
+        }
+        return true;
+    }
+
+    bool fail(const QString &why) {
+        if (m_error.isEmpty()) {
+            m_error = QStringLiteral("%1 at offset %2").arg(why).arg(m_p - m_begin);
+        }
+        return false;
+    }
+
+    const char *m_begin;
+    const char *m_p;
+    const char *m_end;
+    QString m_error;
+};
+
+// Shared literals so the common values cost no allocation per snapshot.
+QString internBackupType(const QByteArray &type) {
+    if (type == "vm") return QStringLiteral("vm");
+    if (type == "ct") return QStringLiteral("ct");
+    if (type == "host") return QStringLiteral("host");
+    return QString::fromUtf8(type);
+}
+
+QString internVerifyState(const QByteArray &state) {
+    if (state.isEmpty()) return QString();
+    if (state == "ok") return QStringLiteral("ok");
+    if (state == "failed") return QStringLiteral("failed");
+    return QString::fromUtf8(state);
+}
+
+} // namespace
+
+PBSSnapshotReduction reducePBSSnapshots(const QByteArray &body) {
+    PBSSnapshotReduction result;
+    JsonScanner scanner(body);
+
+    // (type code << 32 | vmid) -> index into result.latest
+    QHash<quint64, qsizetype> indexByGuest;
+    QHash<QByteArray, quint32> typeCodes;
+    QList<QString> typeNames;
+
+    QByteArray type;
+    QByteArray id;
+    QByteArray state;
+
+    auto readRow = [&]() -> bool {
+        if (scanner.atNull()) return scanner.skipValue();
+        ++result.scannedRows;
+
+        type.resize(0);
+        id.resize(0);
+        state.resize(0);
+        qint64 backupTime = 0;
+        qint64 size = 0;
+
+        const bool rowOk = scanner.forEachMember([&](const QByteArray &field) {
+            if (field == "backup-type") return scanner.readString(&type);
+            if (field == "backup-id") return scanner.readString(&id);
+            if (field == "backup-time") return scanner.readInteger(&backupTime);
+            if (field == "size") return scanner.readInteger(&size);
+            if (field == "verification" && !scanner.atNull()) {
+                return scanner.forEachMember([&](const QByteArray &verifyField) {
+                    return verifyField == "state" ? scanner.readString(&state) : scanner.skipValue();
+                });
+            }
+            return scanner.skipValue();
+        });
+        if (!rowOk) return false;
+
+        bool vmidOk = false;
+        const int vmid = id.toInt(&vmidOk);
+        if (!vmidOk) {
+            return true;
+        }
+
+        quint32 typeCode = typeCodes.value(type, 0);
+        if (typeCode == 0) {
+            typeNames.push_back(internBackupType(type));
+            typeCode = quint32(typeNames.size());
+            typeCodes.insert(type, typeCode);
+        }
+
+        const quint64 guestKey = (quint64(typeCode) << 32) | quint32(vmid);
+        const auto it = indexByGuest.constFind(guestKey);
+        if (it == indexByGuest.constEnd()) {
+            PBSSnapshot snapshot;
+            snapshot.vmid = vmid;
+            snapshot.backupType = typeNames.at(typeCode - 1);
+            snapshot.backupTime = backupTime;
+            snapshot.size = size;
+            snapshot.verifyState = internVerifyState(state);
+            indexByGuest.insert(guestKey, result.latest.size());
+            result.latest.push_back(snapshot);
+        } else {
+            PBSSnapshot &current = result.latest[it.value()];
+            if (backupTime > current.backupTime) {
+                current.backupTime = backupTime;
+                current.size = size;
+                current.verifyState = internVerifyState(state);
+            }
+        }
+        return true;
+    };
+
+    const bool ok = scanner.forEachMember([&](const QByteArray &key) {
+        if (key != "data" || scanner.atNull()) return scanner.skipValue();
+        return scanner.forEachElement(readRow);
+    });
+
+    if (!ok) {
+        result.latest.clear();
+        result.error = scanner.error();
+    }
+    return result;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+#include "pbstypes.h"
+
+// Result of reducing one /admin/datastore/<store>/snapshots payload down to
+// the newest snapshot per (backup-type, backup-id).
+struct PBSSnapshotReduction {
+    QList<PBSSnapshot> latest;
+    int scannedRows = 0;
+    QString error;
+};
+
+// Single forward scan over the raw JSON body. No QJsonDocument / QVariant tree
+// is built; state grows with the number of distinct guests, not with the
+// number of snapshots in the datastore. Safe to call from any thread.
+PBSSnapshotReduction reducePBSSnapshots(const QByteArray &body);
@@ -1,17 +1,44 @@
 #pragma once
 
+#include <QHashFunctions>
 #include <QString>
 
+// Newest snapshot for one guest on one datastore. Host and datastore travel
+// with the pbsSnapshotsReceived signal rather than being copied per row.
 struct PBSSnapshot {
     int vmid = 0;
     QString backupType;
     qint64 backupTime = 0;
     qint64 size = 0;
     QString verifyState;
-    QString datastoreName;
+
+    bool operator==(const PBSSnapshot &other) const {
+        return vmid == other.vmid
+            && backupTime == other.backupTime
+            && size == other.size
+            && backupType == other.backupType
+            && verifyState == other.verifyState;
+    }
+    bool operator!=(const PBSSnapshot &other) const { return !(*this == other); }
+};
+
+// Identifies the latest-backup slot for one guest on one PBS server.
+// pbsHost is always stored normalized (trimmed, lower case).
+struct BackupKey {
     QString pbsHost;
+    QString backupType;
+    int vmid = 0;
+
+    bool operator==(const BackupKey &other) const {
+        return vmid == other.vmid && backupType == other.backupType && pbsHost == other.pbsHost;
+    }
+    bool operator!=(const BackupKey &other) const { return !(*this == other); }
 };
 
+inline size_t qHash(const BackupKey &key, size_t seed = 0) {
+    return qHashMulti(seed, key.pbsHost, key.backupType, key.vmid);
+}
+
 enum class BackupStatus {
     Unknown,
     Current,
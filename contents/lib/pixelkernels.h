@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Per-row pixel kernels for the VNC path: a scalar table, and AVX2 and NEON
+// tables that use the scalar function wherever it measured as fast.
+// pixelKernels() picks the widest table the CPU supports the first time it
+// is called; every implementation produces bit-identical output to the
+// scalar one. 32-bit pixels are 0xAARRGGBB words, i.e.
+// QImage::Format_RGB32 / ARGB32 on little-endian hosts. All functions
+// accept unaligned pointers and any n >= 0; dst must not overlap a source.
+struct PixelKernels {
+    // dst[i] = src[i] | 0xff000000: VNC framebuffer (padding byte 0) to an
+    // opaque RGB32 image.
+    void (*copyOpaque)(uint32_t *dst, const uint32_t *src, int n);
+    // RGB565 (little-endian words) to opaque 0xffRRGGBB. Each channel is
+    // widened by bit replication, so 0x1f maps to 0xff.
+    void (*expand565)(uint32_t *dst, const uint16_t *src, int n);
+    // Swaps the R and B bytes: B,G,R,A in memory becomes R,G,B,A
+    // (QImage::Format_RGBX8888 / RGBA8 textures). Alpha is kept.
+    void (*swizzleRB)(uint32_t *dst, const uint32_t *src, int n);
+    // 2x2 box filter. Reads 2n pixels from each of two source rows and
+    // writes n. Per channel: avg(avg(r0[2i], r1[2i]), avg(r0[2i+1], r1[2i+1]))
+    // with avg(a, b) = (a + b + 1) >> 1, which maps onto pavgb / vrhadd.
+    void (*downscale2x)(uint32_t *dst, const uint32_t *row0, const uint32_t *row1, int n);
+    // "scalar", "avx2" or "neon".
+    const char *isa;
+};
+
+const PixelKernels &pixelKernels();
+// The reference implementation, regardless of CPU.
+const PixelKernels &scalarPixelKernels();
+// Every implementation this CPU can run, scalar first. For tests and
+// benchmarks; production code calls pixelKernels().
+std::vector<const PixelKernels *> supportedPixelKernels();
@@ -1,3 +1,4 @@
+#include <QQmlEngine>
 #include <QQmlExtensionPlugin>
 #include <qqml.h>
 #include "proxmoxclient.h"
@@ -6,6 +7,7 @@
 #include "notifier.h"
 #include "vncclient.h"
 #include "vncframeview.h"
+#include "vncthumbnailservice.h"
 #include "vncwsproxy.h"
 #include "lxcterminal.h"
 
@@ -24,5 +26,10 @@ public:
         qmlRegisterType<VncWsProxy>(uri, 1, 0, "VncWsProxy");
         qmlRegisterType<LxcTerminal>(uri, 1, 0, "LxcTerminal");
     }
+    void initializeEngine(QQmlEngine *engine, const char *uri) override {
+        Q_UNUSED(uri)
+        // The engine takes ownership of the provider.
+        engine->addImageProvider(QLatin1String(VncThumbnailProvider::kId), new VncThumbnailProvider);
+    }
 };
 #include "plugin.moc"
\ No newline at end of file
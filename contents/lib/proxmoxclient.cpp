@@ -1,13 +1,20 @@
 #include "proxmoxclient.h"
+#include "pbssnapshotreducer.h"
 #include "proxmoxconsts.h"
 
+#include <algorithm>
+#include <memory>
+
 #include <QFile>
+#include <QFutureWatcher>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QNetworkReply>
+#include <QPromise>
 #include <QSslCertificate>
 #include <QSslConfiguration>
+#include <QThreadPool>
 #include <QUrl>
 
 ProxmoxClient::ProxmoxClient(QObject *parent)
@@ -26,6 +33,10 @@ void ProxmoxClient::cancelAll() {
     m_pbsInFlight.clear();
     const auto replies = m_inFlight.values();
     m_inFlight.clear();
+    // Forget crawls before aborting so the finished() handlers see them gone
+    // instead of counting the abort as a failed task.
+    m_pbsCrawls.clear();
+    m_pbsHostInFlight.clear();
 
     for (QNetworkReply *r : replies) {
         if (r) r->abort();
@@ -33,6 +44,7 @@ void ProxmoxClient::cancelAll() {
     for (QNetworkReply *r : pbsReplies) {
         if (r) r->abort();
     }
+    dropPendingReductions();
 }
 
 void ProxmoxClient::cancelPVE() {
@@ -47,9 +59,23 @@ void ProxmoxClient::cancelPBS() {
     const auto pbsReplies = m_pbsInFlight.values();
     m_nam.clearConnectionCache();
     m_pbsInFlight.clear();
+    // Forget crawls before aborting so the finished() handlers see them gone.
+    m_pbsCrawls.clear();
+    m_pbsHostInFlight.clear();
     for (QNetworkReply *r : pbsReplies) {
         if (r) r->abort();
     }
+    dropPendingReductions();
+}
+
+void ProxmoxClient::dropPendingReductions() {
+    // Reductions already running finish on the pool; deleting the watchers
+    // just discards their results.
+    const auto watchers = m_pbsReductions.values();
+    m_pbsReductions.clear();
+    for (QObject *w : watchers) {
+        delete w;
+    }
 }
 
 void ProxmoxClient::setHost(const QString &v) {
@@ -328,14 +354,10 @@ bool taskStillRunning(const QVariant &data) {
 }
 
 
-template <typename EmitErr, typename EmitOk>
-void handleFinishedReply(QNetworkReply *r,
-                         int seq,
-                         const QString &kind,
-                         const QString &node,
-                         const QString &sessionKey,
-                         EmitErr emitErr,
-                         EmitOk emitOk) {
+// Transport/HTTP status checks shared by every reply. On success the raw body
+// is handed to emitBody; parsing is left to the caller.
+template <typename EmitErr, typename EmitBody>
+void handleFinishedBody(QNetworkReply *r, EmitErr emitErr, EmitBody emitBody) {
     const QVariant httpAttr = r->attribute(QNetworkRequest::HttpStatusCodeAttribute);
     const int httpStatus = httpAttr.isValid() ? httpAttr.toInt() : 0;
     const QByteArray body = r->readAll();
@@ -380,18 +402,29 @@ void handleFinishedReply(QNetworkReply *r,
         return;
     }
 
-    QJsonParseError pe;
-    const QJsonDocument doc = QJsonDocument::fromJson(body, &pe);
-    if (pe.error != QJsonParseError::NoError || doc.isNull()) {
-        emitErr(QStringLiteral("JSON parse error: %1").arg(pe.errorString()));
-        r->deleteLater();
-        return;
-    }
-
-    emitOk(doc.toVariant());
+    emitBody(body);
     r->deleteLater();
 }
 
+template <typename EmitErr, typename EmitOk>
+void handleFinishedReply(QNetworkReply *r,
+                         int seq,
+                         const QString &kind,
+                         const QString &node,
+                         const QString &sessionKey,
+                         EmitErr emitErr,
+                         EmitOk emitOk) {
+    handleFinishedBody(r, emitErr, [&](const QByteArray &body) {
+        QJsonParseError pe;
+        const QJsonDocument doc = QJsonDocument::fromJson(body, &pe);
+        if (pe.error != QJsonParseError::NoError || doc.isNull()) {
+            emitErr(QStringLiteral("JSON parse error: %1").arg(pe.errorString()));
+            return;
+        }
+        emitOk(doc.toVariant());
+    });
+}
+
 } // namespace
 
 void ProxmoxClient::request(const QString &path, int seq, const QString &kind, const QString &node) {
@@ -608,125 +641,293 @@ void ProxmoxClient::postFor(const QString &sessionKey,
     });
 }
 
-void ProxmoxClient::fetchPBSDatastores(const QString &pbsHost,
-                                      int port,
-                                      const QString &tokenId,
-                                      const QString &tokenSecret,
-                                      bool ignoreSslErrors,
-                                      const QByteArray &trustedCertPem,
-                                      const QString &trustedCertPath) {
+int ProxmoxClient::fetchPBSDatastores(const QString &pbsHost,
+                                     int port,
+                                     const QString &tokenId,
+                                     const QString &tokenSecret,
+                                     bool ignoreSslErrors,
+                                     const QByteArray &trustedCertPem,
+                                     const QString &trustedCertPath,
+                                     int maxConcurrent) {
+    const int crawlId = ++m_nextPbsCrawlId;
     if (m_debugEnabled) {
         qDebug().noquote()
-            << QStringLiteral("[ProxmoxClient] fetchPBSDatastores host=%1 port=%2 tokenIdEmpty=%3 secretEmpty=%4 ignoreSsl=%5")
-               .arg(pbsHost,
+            << QStringLiteral("[ProxmoxClient] fetchPBSDatastores crawl=%1 host=%2 port=%3 tokenIdEmpty=%4 secretEmpty=%5 ignoreSsl=%6 maxConcurrent=%7")
+               .arg(QString::number(crawlId),
+                    pbsHost,
                     QString::number(port),
                     tokenId.isEmpty()     ? QStringLiteral("true") : QStringLiteral("false"),
                     tokenSecret.isEmpty() ? QStringLiteral("true") : QStringLiteral("false"),
-                    ignoreSslErrors       ? QStringLiteral("true") : QStringLiteral("false"));
+                    ignoreSslErrors       ? QStringLiteral("true") : QStringLiteral("false"),
+                    QString::number(maxConcurrent));
     }
     if (pbsHost.isEmpty() || tokenId.isEmpty() || tokenSecret.isEmpty()) {
-        emit pbsError(pbsHost, QStringLiteral("Not configured"));
-        return;
+        // Queued so the caller has recorded the returned id before it
+        // hears about the crawl.
+        QMetaObject::invokeMethod(this, [this, crawlId, pbsHost]() {
+            emit pbsError(pbsHost, QStringLiteral("Not configured"));
+            emit pbsCrawlFinished(crawlId, pbsHost, 1);
+        }, Qt::QueuedConnection);
+        return crawlId;
     }
 
-    // Resolve the cert once here; all per-datastore snapshot requests reuse
-    // the same bytes so loadTrustedCertificates doesn't re-read the file for
-    // each datastore.
-    const QByteArray resolvedCertPem = trustedCertPem.isEmpty() && !trustedCertPath.trimmed().isEmpty()
+    PbsCrawl crawl;
+    crawl.host = pbsHost;
+    crawl.port = port;
+    crawl.hostKey = pbsHost.trimmed().toLower() + QLatin1Char(':') + QString::number(port);
+    crawl.tokenId = tokenId;
+    crawl.tokenSecret = tokenSecret;
+    crawl.ignoreSslErrors = ignoreSslErrors;
+    // Resolve the cert once here; every request of the crawl reuses the same
+    // bytes so loadTrustedCertificates doesn't re-read the file per request.
+    crawl.certPem = trustedCertPem.isEmpty() && !trustedCertPath.trimmed().isEmpty()
         ? [&]() -> QByteArray {
               QFile f(trustedCertPath.trimmed());
               return f.open(QIODevice::ReadOnly) ? f.readAll() : QByteArray();
           }()
         : trustedCertPem;
+    crawl.maxConcurrent = std::max(1, maxConcurrent);
+    m_pbsCrawls.insert(crawlId, crawl);
+
+    enqueuePbsTask(crawlId, PbsCrawlTask{PbsCrawlTask::Kind::Datastores, QString(), QString()});
+    pumpPbsCrawl(crawlId);
+    return crawlId;
+}
 
-    QNetworkRequest req = buildRequest(pbsHost, port, QStringLiteral("/admin/datastore"),
-                                       tokenId, tokenSecret, resolvedCertPem, QString(),
+void ProxmoxClient::enqueuePbsTask(int crawlId, const PbsCrawlTask &task) {
+    auto it = m_pbsCrawls.find(crawlId);
+    if (it == m_pbsCrawls.end()) return;
+    it->queue.enqueue(task);
+    it->total += 1;
+}
+
+void ProxmoxClient::pumpPbsCrawl(int crawlId) {
+    auto it = m_pbsCrawls.find(crawlId);
+    if (it == m_pbsCrawls.end()) return;
+
+    // The window is per host: requests of other crawls to the same server
+    // count against it. A crawl with a smaller window than its neighbours
+    // waits until the host total is below its own.
+    while (m_pbsHostInFlight.value(it->hostKey) < it->maxConcurrent && !it->queue.isEmpty()) {
+        const PbsCrawlTask task = it->queue.dequeue();
+        it->inFlight += 1;
+        m_pbsHostInFlight[it->hostKey] += 1;
+        startPbsTask(crawlId, task);
+        // startPbsTask never finishes synchronously, but re-resolve in case
+        // the hash was touched.
+        it = m_pbsCrawls.find(crawlId);
+        if (it == m_pbsCrawls.end()) return;
+    }
+
+    if (it->queue.isEmpty() && it->inFlight == 0 && it->reducing == 0) {
+        const QString host = it->host;
+        const int failed = it->failed;
+        if (m_debugEnabled) {
+            qDebug().noquote() << QStringLiteral("[ProxmoxClient] pbs crawl=%1 host=%2 finished tasks=%3 failed=%4")
+                                      .arg(crawlId).arg(host).arg(it->total).arg(failed);
+        }
+        m_pbsCrawls.erase(it);
+        emit pbsCrawlFinished(crawlId, host, failed);
+    }
+}
+
+void ProxmoxClient::completePbsTask(int crawlId, bool ok) {
+    auto it = m_pbsCrawls.find(crawlId);
+    if (it == m_pbsCrawls.end()) return;
+    it->done += 1;
+    if (!ok) it->failed += 1;
+    emit pbsCrawlProgress(crawlId, it->host, it->done, it->total);
+    pumpPbsHost(it->hostKey, crawlId);
+}
+
+// A finished task frees a slot in its host's window; this crawl gets the
+// first chance at it, then every other crawl on the same host.
+void ProxmoxClient::pumpPbsHost(const QString &hostKey, int firstCrawlId) {
+    const QString key = hostKey;   // may belong to a crawl erased below
+    QList<int> siblings;
+    for (auto it = m_pbsCrawls.constBegin(); it != m_pbsCrawls.constEnd(); ++it) {
+        if (it.key() != firstCrawlId && it->hostKey == key) siblings.push_back(it.key());
+    }
+    pumpPbsCrawl(firstCrawlId);
+    for (int crawlId : std::as_const(siblings)) {
+        pumpPbsCrawl(crawlId);
+    }
+    const auto inFlight = m_pbsHostInFlight.constFind(key);
+    if (inFlight != m_pbsHostInFlight.constEnd() && inFlight.value() == 0) {
+        m_pbsHostInFlight.erase(inFlight);
+    }
+}
+
+void ProxmoxClient::startPbsTask(int crawlId, const PbsCrawlTask &task) {
+    const PbsCrawl &crawl = m_pbsCrawls[crawlId];
+    const QString encodedStore = QString::fromUtf8(QUrl::toPercentEncoding(task.datastore));
+
+    QString path;
+    QString label;
+    switch (task.kind) {
+    case PbsCrawlTask::Kind::Datastores:
+        path = QStringLiteral("/admin/datastore");
+        label = QStringLiteral("fetchPBSDatastores");
+        break;
+    case PbsCrawlTask::Kind::Namespaces:
+        path = QStringLiteral("/admin/datastore/%1/namespace").arg(encodedStore);
+        label = QStringLiteral("fetchPBSNamespaces");
+        break;
+    case PbsCrawlTask::Kind::Snapshots:
+        path = QStringLiteral("/admin/datastore/%1/snapshots").arg(encodedStore);
+        if (!task.ns.isEmpty()) {
+            path += QStringLiteral("?ns=") + QString::fromUtf8(QUrl::toPercentEncoding(task.ns));
+        }
+        label = QStringLiteral("fetchPBSSnapshots");
+        break;
+    }
+
+    QNetworkRequest req = buildRequest(crawl.host, crawl.port, path,
+                                       crawl.tokenId, crawl.tokenSecret, crawl.certPem, QString(),
                                        m_lowLatency ? ProxmoxConst::Defaults::LowLatencyTimeoutMs
                                                     : ProxmoxConst::Defaults::RequestTimeoutMs);
-    req.setRawHeader("Authorization", QByteArray("PBSAPIToken=") + tokenId.toUtf8() + ":" + tokenSecret.toUtf8());
+    req.setRawHeader("Authorization", QByteArray("PBSAPIToken=") + crawl.tokenId.toUtf8() + ":" + crawl.tokenSecret.toUtf8());
 
     QNetworkReply *r = m_nam.get(req);
     m_pbsInFlight.insert(r);
-
-    if (ignoreSslErrors) {
+    if (crawl.ignoreSslErrors) {
         QObject::connect(r, &QNetworkReply::sslErrors, r, [r](const QList<QSslError> &) {
             r->ignoreSslErrors();
         });
     }
 
-    QObject::connect(r, &QNetworkReply::finished, this, [this, r, pbsHost, port, tokenId, tokenSecret, ignoreSslErrors, resolvedCertPem]() {
+    const QString pbsHost = crawl.host;
+    QObject::connect(r, &QNetworkReply::finished, this, [this, r, crawlId, task, pbsHost, label]() {
         m_pbsInFlight.remove(r);
+        auto it = m_pbsCrawls.find(crawlId);
+        if (it == m_pbsCrawls.end()) {
+            // Crawl was cancelled; nothing is waiting on this task.
+            r->deleteLater();
+            return;
+        }
+        it->inFlight -= 1;
+        m_pbsHostInFlight[it->hostKey] -= 1;
 
+        bool settled = false;
         auto emitErr = [&](const QString &msg) {
-            if (m_debugEnabled) qDebug().noquote() << QStringLiteral("[ProxmoxClient] fetchPBSDatastores error host=%1 message=%2").arg(pbsHost, msg);
+            settled = true;
+            if (m_debugEnabled) {
+                qDebug().noquote() << QStringLiteral("[ProxmoxClient] %1 error crawl=%2 host=%3 datastore=%4 ns=%5 message=%6")
+                                          .arg(label).arg(crawlId).arg(pbsHost, task.datastore, task.ns, msg);
+            }
+            if (task.kind == PbsCrawlTask::Kind::Namespaces) {
+                // PBS < 2.2 has no namespaces; the root listing queued
+                // alongside this one still covers the datastore.
+                completePbsTask(crawlId, true);
+                return;
+            }
             emit pbsError(pbsHost, msg);
+            completePbsTask(crawlId, false);
         };
-        auto emitOk = [&](const QVariant &data) {
-            if (m_debugEnabled) qDebug().noquote() << QStringLiteral("[ProxmoxClient] fetchPBSDatastores ok host=%1").arg(pbsHost);
-            QStringList datastores;
-            const QVariantList rows = data.toMap().value(QStringLiteral("data")).toList();
-            for (const QVariant &rowValue : rows) {
-                const QVariantMap row = rowValue.toMap();
-                const QString store = row.value(QStringLiteral("store")).toString().trimmed();
-                if (!store.isEmpty()) {
-                    datastores.push_back(store);
-                }
+        auto emitBody = [&](const QByteArray &body) {
+            settled = true;
+            if (task.kind == PbsCrawlTask::Kind::Snapshots) {
+                // Snapshot listings grow with retention and can be large;
+                // reduce them off the GUI thread. The task completes when
+                // the reduction does.
+                reduceSnapshotsAsync(crawlId, pbsHost, task.datastore, task.ns, body);
+                return;
             }
-            emit pbsDatastoresReceived(pbsHost, datastores);
-            for (const QString &datastore : datastores) {
-                QNetworkRequest snapshotReq = buildRequest(pbsHost,
-                                                           port,
-                                                           QStringLiteral("/admin/datastore/%1/snapshots").arg(QString::fromUtf8(QUrl::toPercentEncoding(datastore))),
-                                                           tokenId,
-                                                           tokenSecret,
-                                                           resolvedCertPem,
-                                                           QString(),
-                                                           m_lowLatency ? ProxmoxConst::Defaults::LowLatencyTimeoutMs : ProxmoxConst::Defaults::RequestTimeoutMs);
-                snapshotReq.setRawHeader("Authorization", QByteArray("PBSAPIToken=") + tokenId.toUtf8() + ":" + tokenSecret.toUtf8());
-
-                QNetworkReply *snapshotReply = m_nam.get(snapshotReq);
-                m_pbsInFlight.insert(snapshotReply);
-                if (ignoreSslErrors) {
-                    QObject::connect(snapshotReply, &QNetworkReply::sslErrors, snapshotReply, [snapshotReply](const QList<QSslError> &) {
-                        snapshotReply->ignoreSslErrors();
-                    });
-                }
+            handlePbsListing(crawlId, task, body);
+        };
+        handleFinishedBody(r, emitErr, emitBody);
+
+        if (!settled) {
+            // Transfer timeouts surface as OperationCanceledError, which
+            // handleFinishedBody treats as a silent cancel. The crawl is
+            // still live, so this task did not complete.
+            emit pbsError(pbsHost, QStringLiteral("Request timed out"));
+            completePbsTask(crawlId, false);
+        }
+    });
+}
 
-                QObject::connect(snapshotReply, &QNetworkReply::finished, this, [this, snapshotReply, pbsHost, datastore]() {
-                    m_pbsInFlight.remove(snapshotReply);
-                    auto emitSnapErr = [&](const QString &msg) {
-                        if (m_debugEnabled) qDebug().noquote() << QStringLiteral("[ProxmoxClient] fetchPBSSnapshots error host=%1 datastore=%2 message=%3").arg(pbsHost, datastore, msg);
-                        emit pbsError(pbsHost, msg);
-                    };
-                    auto emitSnapOk = [&](const QVariant &snapData) {
-                        if (m_debugEnabled) qDebug().noquote() << QStringLiteral("[ProxmoxClient] fetchPBSSnapshots ok host=%1 datastore=%2").arg(pbsHost, datastore);
-                        QList<PBSSnapshot> snapshots;
-                        const QVariantList rows = snapData.toMap().value(QStringLiteral("data")).toList();
-                        for (const QVariant &rowValue : rows) {
-                            const QVariantMap row = rowValue.toMap();
-                            bool vmidOk = false;
-                            const int vmid = row.value(QStringLiteral("backup-id")).toString().toInt(&vmidOk);
-                            if (!vmidOk) {
-                                continue;
-                            }
-                            PBSSnapshot snapshot;
-                            snapshot.vmid = vmid;
-                            snapshot.backupType = row.value(QStringLiteral("backup-type")).toString();
-                            snapshot.backupTime = row.value(QStringLiteral("backup-time")).toLongLong();
-                            snapshot.size = row.value(QStringLiteral("size")).toLongLong();
-                            snapshot.verifyState = row.value(QStringLiteral("verification")).toMap().value(QStringLiteral("state")).toString();
-                            snapshot.datastoreName = datastore;
-                            snapshot.pbsHost = pbsHost;
-                            snapshots.push_back(snapshot);
-                        }
-                        emit pbsSnapshotsReceived(pbsHost, datastore, snapshots);
-                    };
-                    handleFinishedReply(snapshotReply, 0, QStringLiteral("pbs-snapshots"), datastore, QString(), emitSnapErr, emitSnapOk);
-                });
+void ProxmoxClient::handlePbsListing(int crawlId, const PbsCrawlTask &task, const QByteArray &body) {
+    QJsonParseError pe;
+    const QJsonDocument doc = QJsonDocument::fromJson(body, &pe);
+    if (pe.error != QJsonParseError::NoError || doc.isNull()) {
+        if (task.kind == PbsCrawlTask::Kind::Datastores) {
+            auto it = m_pbsCrawls.constFind(crawlId);
+            if (it != m_pbsCrawls.constEnd()) {
+                emit pbsError(it->host, QStringLiteral("JSON parse error: %1").arg(pe.errorString()));
             }
-        };
+        }
+        completePbsTask(crawlId, task.kind != PbsCrawlTask::Kind::Datastores);
+        return;
+    }
+
+    const QJsonArray rows = doc.object().value(QStringLiteral("data")).toArray();
+    if (task.kind == PbsCrawlTask::Kind::Datastores) {
+        for (const QJsonValue &row : rows) {
+            const QString store = row.toObject().value(QStringLiteral("store")).toString().trimmed();
+            if (store.isEmpty()) continue;
+            // Root listing first so the common single-namespace setup
+            // doesn't wait on the namespace request.
+            enqueuePbsTask(crawlId, PbsCrawlTask{PbsCrawlTask::Kind::Snapshots, store, QString()});
+            enqueuePbsTask(crawlId, PbsCrawlTask{PbsCrawlTask::Kind::Namespaces, store, QString()});
+        }
+    } else {
+        for (const QJsonValue &row : rows) {
+            const QString ns = row.toObject().value(QStringLiteral("ns")).toString().trimmed();
+            if (ns.isEmpty()) continue; // root, already queued
+            enqueuePbsTask(crawlId, PbsCrawlTask{PbsCrawlTask::Kind::Snapshots, task.datastore, ns});
+        }
+    }
+    completePbsTask(crawlId, true);
+}
+
+void ProxmoxClient::reduceSnapshotsAsync(int crawlId,
+                                         const QString &pbsHost,
+                                         const QString &datastore,
+                                         const QString &ns,
+                                         const QByteArray &body) {
+    auto crawlIt = m_pbsCrawls.find(crawlId);
+    if (crawlIt == m_pbsCrawls.end()) return;
+    crawlIt->reducing += 1;
+
+    auto promise = std::make_shared<QPromise<PBSSnapshotReduction>>();
+    auto *watcher = new QFutureWatcher<PBSSnapshotReduction>(this);
+    m_pbsReductions.insert(watcher);
+
+    QObject::connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, crawlId, pbsHost, datastore, ns]() {
+        m_pbsReductions.remove(watcher);
+        watcher->deleteLater();
+        auto it = m_pbsCrawls.find(crawlId);
+        if (it == m_pbsCrawls.end()) {
+            return;
+        }
+        it->reducing -= 1;
+        if (watcher->future().resultCount() == 0) {
+            completePbsTask(crawlId, false);
+            return;
+        }
+        const PBSSnapshotReduction reduction = watcher->result();
+        if (!reduction.error.isEmpty()) {
+            if (m_debugEnabled) qDebug().noquote() << QStringLiteral("[ProxmoxClient] fetchPBSSnapshots error host=%1 datastore=%2 ns=%3 message=%4").arg(pbsHost, datastore, ns, reduction.error);
+            emit pbsError(pbsHost, QStringLiteral("JSON parse error: %1").arg(reduction.error));
+            completePbsTask(crawlId, false);
+            return;
+        }
+        if (m_debugEnabled) {
+            qDebug().noquote() << QStringLiteral("[ProxmoxClient] fetchPBSSnapshots ok host=%1 datastore=%2 ns=%3 rows=%4 latest=%5")
+                                      .arg(pbsHost, datastore, ns)
+                                      .arg(reduction.scannedRows)
+                                      .arg(reduction.latest.size());
+        }
+        emit pbsSnapshotsReceived(crawlId, pbsHost, datastore, ns, reduction.latest);
+        completePbsTask(crawlId, true);
+    });
 
-        handleFinishedReply(r, 0, QStringLiteral("pbs-datastores"), QString(), QString(), emitErr, emitOk);
+    watcher->setFuture(promise->future());
+    promise->start();
+    QThreadPool::globalInstance()->start([promise, body]() {
+        promise->addResult(reducePBSSnapshots(body));
+        promise->finish();
     });
 }
 
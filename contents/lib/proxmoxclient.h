@@ -2,9 +2,11 @@
 
 #include <QObject>
 #include <QByteArray>
+#include <QHash>
 #include <QList>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
+#include <QQueue>
 #include <QSet>
 #include <QVariant>
 
@@ -134,13 +136,18 @@ public:
     Q_INVOKABLE void cancelAll();
     Q_INVOKABLE void cancelPVE();
     Q_INVOKABLE void cancelPBS();
-    Q_INVOKABLE void fetchPBSDatastores(const QString &pbsHost,
-                                        int port,
-                                        const QString &tokenId,
-                                        const QString &tokenSecret,
-                                        bool ignoreSslErrors,
-                                        const QByteArray &trustedCertPem,
-                                        const QString &trustedCertPath);
+    // Crawls every datastore and namespace on a PBS host, keeping at most
+    // maxConcurrent requests in flight to that host and port across all
+    // crawls, so two tokens on the same server share one window. Returns the crawl id carried by the
+    // pbsSnapshotsReceived / pbsCrawlProgress / pbsCrawlFinished signals.
+    Q_INVOKABLE int fetchPBSDatastores(const QString &pbsHost,
+                                       int port,
+                                       const QString &tokenId,
+                                       const QString &tokenSecret,
+                                       bool ignoreSslErrors,
+                                       const QByteArray &trustedCertPem,
+                                       const QString &trustedCertPath,
+                                       int maxConcurrent);
 
 signals:
     // user is the auth user returned by termproxy; sent over the
@@ -210,11 +217,16 @@ signals:
                         int vmid,
                         const QString &action,
                         const QString &message);
-    void pbsDatastoresReceived(const QString &pbsHost,
-                               const QList<QString> &datastores);
-    void pbsSnapshotsReceived(const QString &pbsHost,
+    // ns is empty for the datastore root namespace.
+    void pbsSnapshotsReceived(int crawlId,
+                              const QString &pbsHost,
                               const QString &datastore,
+                              const QString &ns,
                               const QList<PBSSnapshot> &snapshots);
+    // total grows as datastores and namespaces are discovered.
+    void pbsCrawlProgress(int crawlId, const QString &pbsHost, int done, int total);
+    // Emitted exactly once per crawl unless it is cancelled first.
+    void pbsCrawlFinished(int crawlId, const QString &pbsHost, int failedTasks);
     void pbsError(const QString &pbsHost, const QString &message);
 
 private:
@@ -252,6 +264,41 @@ private:
                  const QString &node,
                  int vmid,
                  const QString &action);
+    struct PbsCrawlTask {
+        enum class Kind { Datastores, Namespaces, Snapshots };
+        Kind kind = Kind::Datastores;
+        QString datastore;
+        QString ns;
+    };
+    struct PbsCrawl {
+        QString host;
+        int port = 0;
+        QString hostKey;   // pbsHostKey(): the window is shared per key
+        QString tokenId;
+        QString tokenSecret;
+        bool ignoreSslErrors = false;
+        QByteArray certPem;
+        int maxConcurrent = 1;
+        QQueue<PbsCrawlTask> queue;
+        int inFlight = 0;  // requests on the wire
+        int reducing = 0;  // snapshot bodies being reduced off-thread
+        int done = 0;
+        int total = 0;
+        int failed = 0;
+    };
+
+    void enqueuePbsTask(int crawlId, const PbsCrawlTask &task);
+    void pumpPbsCrawl(int crawlId);
+    void pumpPbsHost(const QString &hostKey, int firstCrawlId);
+    void startPbsTask(int crawlId, const PbsCrawlTask &task);
+    void completePbsTask(int crawlId, bool ok);
+    void handlePbsListing(int crawlId, const PbsCrawlTask &task, const QByteArray &body);
+    void reduceSnapshotsAsync(int crawlId,
+                              const QString &pbsHost,
+                              const QString &datastore,
+                              const QString &ns,
+                              const QByteArray &body);
+    void dropPendingReductions();
     void pollTaskStatus(const QString &sessionKey,
                         const QString &host,
                         int port,
@@ -280,4 +327,8 @@ private:
     QSet<QNetworkReply *> m_inFlight;
     QSet<QNetworkReply *> m_pbsInFlight;
     QSet<QNetworkReply *> m_taskInFlight;
+    QSet<QObject *> m_pbsReductions;
+    QHash<int, PbsCrawl> m_pbsCrawls;
+    QHash<QString, int> m_pbsHostInFlight;   // requests on the wire per host key
+    int m_nextPbsCrawlId = 0;
 };
@@ -16,6 +16,7 @@ namespace Kind {
     inline const QString Action   = QStringLiteral("action");   // internal dispatch
     inline const QString Console  = QStringLiteral("console");  // internal dispatch
     inline const QString Fetch    = QStringLiteral("fetch");    // internal dispatch
+    inline const QString Thumbnail = QStringLiteral("thumbnail"); // internal dispatch
 } // namespace Kind
 
 // VM / CT action verbs sent to the Proxmox API
@@ -36,6 +37,7 @@ namespace Defaults {
     constexpr int PvePort              = 8006;
     constexpr int PbsPort              = 8007;
     constexpr int PbsRefreshInterval   = 3600;  // seconds
+    constexpr int PbsMaxConcurrentRequests = 4; // per PBS host
     constexpr int SecondsPerHour       = 3600;
     constexpr int SecondsPerDay        = 86400;
     constexpr int RequestTimeoutMs     = 10000;
@@ -1,8 +1,10 @@
 #include "proxmoxcontroller.h"
 
+#include "backupstatuscache.h"
 #include "proxmoxclient.h"
 #include "proxmoxconsts.h"
 #include "secretstore.h"
+#include "vncthumbnailservice.h"
 
 #include <algorithm>
 
@@ -17,14 +19,39 @@
 #include <QVariantList>
 #include <QtGlobal>
 
+// One pending thumbnail vncproxy request per guest; a console opened for
+// the same guest meanwhile may get the thumbnail's ticket and vice versa,
+// which is harmless since both are for the same VM.
+static QString thumbnailTicketKey(const QString &sessionKey, const QString &node, int vmid)
+{
+    return sessionKey + QLatin1Char('/') + node + QLatin1Char('/') + QString::number(vmid);
+}
+
+static QString consoleTraceKey(const QString &sessionKey, const QString &kind, const QString &node, int vmid)
+{
+    return sessionKey + QLatin1Char('/') + kind + QLatin1Char(':') + node + QLatin1Char(':') + QString::number(vmid);
+}
+
 ProxmoxController::ProxmoxController(QObject *parent)
     : QObject(parent)
     , m_api(new ProxmoxClient(this))
     , m_singleSecretStore(new SecretStore(this))
-    , m_multiSecretStore(new SecretStore(this)) {
+    , m_multiSecretStore(new SecretStore(this))
+    , m_thumbnails(new VncThumbnailService(this)) {
     m_singleSecretStore->setService(QStringLiteral("ProxMon"));
     m_multiSecretStore->setService(QStringLiteral("ProxMon"));
 
+    connect(m_thumbnails, &VncThumbnailService::ticketRequested, this, &ProxmoxController::requestThumbnailTicket);
+    connect(m_thumbnails, &VncThumbnailService::thumbnailsChanged, this, &ProxmoxController::thumbnailsChanged);
+
+    m_consoleClock.start();
+    // consoleError doesn't carry the session; a failed open drops the trace
+    // of that guest on every endpoint, which at worst loses one timeline.
+    connect(this, &ProxmoxController::consoleError, this, [this](const QString &node, const QString &kind, int vmid, const QString &) {
+        const QString suffix = QLatin1Char('/') + kind + QLatin1Char(':') + node + QLatin1Char(':') + QString::number(vmid);
+        m_consoleTraces.removeIf([&suffix](QHash<QString, ConsoleOpenTrace>::iterator it) { return it.key().endsWith(suffix); });
+    });
+
     connect(m_api, &ProxmoxClient::reply, this, [this](int seq, const QString &kind, const QString &node, const QVariant &data) {
         handleSingleReply(seq, kind, node, data);
     });
@@ -60,14 +87,26 @@ ProxmoxController::ProxmoxController(QObject *parent)
                 resolvedIgnoreSsl  = endpoint.value(QStringLiteral("ignoreSsl"), ignoreSsl).toBool();
             }
         }
+        if (kind == ProxmoxConst::Kind::Qemu
+            && m_pendingThumbnailTickets.remove(thumbnailTicketKey(sessionKey, node, vmid))) {
+            m_thumbnails->deliverTicket(sessionKey, node, vmid, host, resolvedApiPort, vncPort,
+                                        resolvedIgnoreSsl, ticket.toUtf8(), authHeader);
+            return;
+        }
         const QString vmKey = QStringLiteral("%1:%2:%3").arg(kind, node).arg(vmid);
         const QString vmName = m_pendingConsoleNames.take(vmKey);
         m_pendingConsoleAuth[sessionKey]  = authHeader;
         m_pendingConsoleTicket[sessionKey] = ticket.toUtf8();
+        markConsoleStage(sessionKey, kind, node, vmid, QStringLiteral("ticket"));
         emit consoleReady(sessionKey, host, node, kind, vmid, vmName, vncPort,
                           resolvedApiPort, resolvedIgnoreSsl);
     });
-    connect(m_api, &ProxmoxClient::vncProxyError, this, [this](const QString &, const QString &node, const QString &kind, int vmid, const QString &message) {
+    connect(m_api, &ProxmoxClient::vncProxyError, this, [this](const QString &sessionKey, const QString &node, const QString &kind, int vmid, const QString &message) {
+        if (kind == ProxmoxConst::Kind::Qemu
+            && m_pendingThumbnailTickets.remove(thumbnailTicketKey(sessionKey, node, vmid))) {
+            m_thumbnails->ticketFailed(sessionKey, node, vmid, message);
+            return;
+        }
         m_pendingConsoleNames.remove(QStringLiteral("%1:%2:%3").arg(kind, node).arg(vmid));
         emit consoleError(node, kind, vmid, message);
     });
@@ -92,63 +131,59 @@ ProxmoxController::ProxmoxController(QObject *parent)
         m_pendingConsoleNames.remove(QStringLiteral("lxc:%1:%2").arg(node).arg(vmid));
         emit consoleError(node, ProxmoxConst::Kind::Lxc, vmid, message);
     });
-    connect(m_api, &ProxmoxClient::pbsSnapshotsReceived, this, [this](const QString &pbsHost, const QString &, const QList<PBSSnapshot> &snapshots) {
+    connect(m_api, &ProxmoxClient::pbsSnapshotsReceived, this, [this](int crawlId, const QString &pbsHost, const QString &, const QString &, const QList<PBSSnapshot> &snapshots) {
+        if (!m_pbsActiveCrawls.contains(crawlId)) return;
         if (!m_pbsRefreshError.isEmpty()) {
             m_pbsRefreshError.clear();
             emit pbsLastErrorChanged();
         }
+        // The same guest can appear in several datastores/namespaces; keep
+        // the newest snapshot across all of them.
+        const QString host = normalizedHost(pbsHost);
         for (const PBSSnapshot &snapshot : snapshots) {
-            const QString backupKey = QStringLiteral("%1|%2|%3").arg(normalizedHost(pbsHost), snapshot.backupType, QString::number(snapshot.vmid));
-            auto it = m_latestBackups.find(backupKey);
-            if (it == m_latestBackups.end() || snapshot.backupTime > it.value().backupTime) {
-                m_latestBackups.insert(backupKey, snapshot);
+            const BackupKey backupKey{host, snapshot.backupType, snapshot.vmid};
+            auto it = m_pbsRefreshBackups.find(backupKey);
+            if (it == m_pbsRefreshBackups.end() || snapshot.backupTime > it.value().backupTime) {
+                m_pbsRefreshBackups.insert(backupKey, snapshot);
             }
         }
-        if (m_pendingPbsSnapshotRequests > 0) {
-            m_pendingPbsSnapshotRequests -= 1;
-        }
-        if (m_pendingPbsEndpoints > 0) {
-            m_pendingPbsEndpoints -= 1;
-        }
-        if (m_pendingPbsSnapshotRequests <= 0 && m_pendingPbsEndpoints <= 0) {
-            m_pendingPbsSnapshotRequests = 0;
-            m_pendingPbsEndpoints = 0;
-            correlateBackups();
-        }
     });
-    connect(m_api, &ProxmoxClient::pbsDatastoresReceived, this, [this](const QString &, const QList<QString> &datastores) {
-        m_pendingPbsSnapshotRequests += datastores.size();
-        if (datastores.isEmpty()) {
-            if (m_pendingPbsEndpoints > 0) {
-                m_pendingPbsEndpoints -= 1;
-            }
-            if (m_pendingPbsSnapshotRequests <= 0 && m_pendingPbsEndpoints <= 0) {
-                m_pendingPbsSnapshotRequests = 0;
-                m_pendingPbsEndpoints = 0;
-                correlateBackups();
-            }
+    connect(m_api, &ProxmoxClient::pbsCrawlProgress, this, [this](int crawlId, const QString &, int done, int total) {
+        auto it = m_pbsActiveCrawls.find(crawlId);
+        if (it == m_pbsActiveCrawls.end()) return;
+        m_pbsProgressDone += done - it->done;
+        m_pbsProgressTotal += total - it->total;
+        it->done = done;
+        it->total = total;
+        emit pbsProgressChanged();
+    });
+    connect(m_api, &ProxmoxClient::pbsCrawlFinished, this, [this](int crawlId, const QString &pbsHost, int failedTasks) {
+        const auto it = m_pbsActiveCrawls.constFind(crawlId);
+        if (it == m_pbsActiveCrawls.constEnd()) return;
+        appendDebugLog(QStringLiteral("[ProxmoxController] pbs crawl finished host=%1 tasks=%2 failed=%3 activeCrawls=%4")
+            .arg(pbsHost)
+            .arg(it->total)
+            .arg(failedTasks)
+            .arg(m_pbsActiveCrawls.size() - 1));
+        // A host is only authoritative for pruning when every datastore and
+        // namespace listing of its crawl succeeded.
+        if (failedTasks == 0) {
+            m_pbsRefreshHostsOk.insert(it->host);
+        } else {
+            m_pbsRefreshHostsFailed.insert(it->host);
         }
+        m_pbsActiveCrawls.erase(it);
+        maybeFinishPBSRefresh();
     });
     connect(m_api, &ProxmoxClient::pbsError, this, [this](const QString &pbsHost, const QString &message) {
-        appendDebugLog(QStringLiteral("[ProxmoxController] pbs error host=%1 pendingSnapshots=%2 pendingEndpoints=%3 message=%4")
+        appendDebugLog(QStringLiteral("[ProxmoxController] pbs error host=%1 activeCrawls=%2 message=%3")
             .arg(pbsHost)
-            .arg(m_pendingPbsSnapshotRequests)
-            .arg(m_pendingPbsEndpoints)
+            .arg(m_pbsActiveCrawls.size())
             .arg(message));
         if (m_pbsRefreshError != message) {
             m_pbsRefreshError = message;
             emit pbsLastErrorChanged();
         }
-        if (m_pendingPbsSnapshotRequests > 0) {
-            m_pendingPbsSnapshotRequests -= 1;
-        } else if (m_pendingPbsEndpoints > 0) {
-            m_pendingPbsEndpoints -= 1;
-        }
-        if (m_pendingPbsSnapshotRequests <= 0 && m_pendingPbsEndpoints <= 0) {
-            m_pendingPbsSnapshotRequests = 0;
-            m_pendingPbsEndpoints = 0;
-            correlateBackups();
-        }
     });
     m_pbsTimer = new QTimer(this);
     connect(m_pbsTimer, &QTimer::timeout, this, &ProxmoxController::refreshPBSNow);
@@ -158,6 +193,20 @@ ProxmoxController::ProxmoxController(QObject *parent)
     m_pbsDebounceTimer->setInterval(500);
     connect(m_pbsDebounceTimer, &QTimer::timeout, this, &ProxmoxController::refreshPBSNow);
 
+    // Seed the backup table from the previous session. Every host in it is
+    // stale until its first successful crawl.
+    m_backupCachePath = BackupStatusCache::defaultPath();
+    qint64 cacheSavedAt = 0;
+    if (BackupStatusCache::load(m_backupCachePath, &m_latestBackups, &cacheSavedAt)) {
+        for (auto it = m_latestBackups.constBegin(); it != m_latestBackups.constEnd(); ++it) {
+            m_staleBackupHosts.insert(it.key().pbsHost);
+        }
+        m_backupStatusStale = !m_staleBackupHosts.isEmpty();
+        appendDebugLog(QStringLiteral("[ProxmoxController] backup cache loaded entries=%1 savedAt=%2")
+            .arg(m_latestBackups.size())
+            .arg(cacheSavedAt));
+    }
+
     connect(m_singleSecretStore, &SecretStore::secretReady, this, [this](const QString &secret) {
         if (!secret.isEmpty()) {
             const QString currentKey = keyFor(m_host, m_port, m_tokenId);
@@ -323,6 +372,7 @@ void ProxmoxController::setMultiHostsJson(const QString &value) {
 void ProxmoxController::setPbsEnabled(bool value) {
     if (m_pbsEnabled == value) return;
     m_pbsEnabled = value;
+    m_backupPoliciesDirty = true;
     emit pbsEnabledChanged();
     refreshPBS();
 }
@@ -330,6 +380,7 @@ void ProxmoxController::setPbsEnabled(bool value) {
 void ProxmoxController::setPbsHost(const QString &value) {
     if (m_pbsHost == value) return;
     m_pbsHost = value;
+    m_backupPoliciesDirty = true;
     emit pbsHostChanged();
     refreshPBS();
 }
@@ -359,12 +410,14 @@ void ProxmoxController::setPbsBackupWarningDays(int value) {
     if (m_pbsBackupWarningDays == value) return;
     m_pbsBackupWarningDays = value;
     emit pbsBackupWarningDaysChanged();
+    correlateBackups();
 }
 
 void ProxmoxController::setPbsBackupStaleDays(int value) {
     if (m_pbsBackupStaleDays == value) return;
     m_pbsBackupStaleDays = value;
     emit pbsBackupStaleDaysChanged();
+    correlateBackups();
 }
 
 void ProxmoxController::setPbsRefreshInterval(int value) {
@@ -376,9 +429,16 @@ void ProxmoxController::setPbsRefreshInterval(int value) {
     emit pbsRefreshIntervalChanged();
 }
 
+void ProxmoxController::setPbsMaxConcurrentRequests(int value) {
+    if (m_pbsMaxConcurrentRequests == value) return;
+    m_pbsMaxConcurrentRequests = value;
+    emit pbsMaxConcurrentRequestsChanged();
+}
+
 void ProxmoxController::setPbsExcludeTag(const QString &value) {
     if (m_pbsExcludeTag == value) return;
     m_pbsExcludeTag = value;
+    m_backupExclusionRules = FilterRules(m_pbsExcludeVmids, m_pbsExcludeTag);
     emit pbsExcludeTagChanged();
     correlateBackups();
 }
@@ -386,10 +446,56 @@ void ProxmoxController::setPbsExcludeTag(const QString &value) {
 void ProxmoxController::setPbsExcludeVmids(const QString &value) {
     if (m_pbsExcludeVmids == value) return;
     m_pbsExcludeVmids = value;
+    m_backupExclusionRules = FilterRules(m_pbsExcludeVmids, m_pbsExcludeTag);
     emit pbsExcludeVmidsChanged();
     correlateBackups();
 }
 
+void ProxmoxController::setNotifyMode(const QString &value) {
+    if (m_notifyMode == value) return;
+    m_notifyMode = value;
+    emit notifyModeChanged();
+}
+
+void ProxmoxController::setNotifyFilter(const QString &value) {
+    if (m_notifyFilter == value) return;
+    m_notifyFilter = value;
+    m_notifyRules = FilterRules(m_notifyFilter);
+    emit notifyFilterChanged();
+}
+
+void ProxmoxController::setNotifyOnStart(bool value) {
+    if (m_notifyOnStart == value) return;
+    m_notifyOnStart = value;
+    emit notifyOnStartChanged();
+}
+
+void ProxmoxController::setNotifyOnStop(bool value) {
+    if (m_notifyOnStop == value) return;
+    m_notifyOnStop = value;
+    emit notifyOnStopChanged();
+}
+
+void ProxmoxController::setNotifyOnNodeChange(bool value) {
+    if (m_notifyOnNodeChange == value) return;
+    m_notifyOnNodeChange = value;
+    emit notifyOnNodeChangeChanged();
+}
+
+bool ProxmoxController::shouldNotify(const QString &name, int vmid) const {
+    const bool whitelist = m_notifyMode == QStringLiteral("whitelist");
+    const bool blacklist = m_notifyMode == QStringLiteral("blacklist");
+    if (!whitelist && !blacklist) {
+        return true;
+    }
+    // Empty filter: a whitelist matches nothing, a blacklist excludes nothing.
+    if (m_notifyRules.isEmpty()) {
+        return blacklist;
+    }
+    const bool matched = m_notifyRules.matches(FilterRules::Row{vmid, name, QString()});
+    return whitelist ? matched : !matched;
+}
+
 void ProxmoxController::setDebugEnabled(bool value) {
     if (m_debugEnabled == value) return;
     m_debugEnabled = value;
@@ -634,29 +740,115 @@ void ProxmoxController::openConsole(const QString &sessionKey,
                                      int vmid,
                                      const QString &vmName)
 {
-    if (sessionKey.isEmpty()) {
-        readSingleSecretFor({
-            {QStringLiteral("kind"), ProxmoxConst::Kind::Console},
-            {QStringLiteral("actionKind"), kind},
-            {QStringLiteral("node"), node},
-            {QStringLiteral("vmid"), vmid},
-            {QStringLiteral("vmName"), vmName},
-        });
-        return;
-    }
-    const QVariantMap endpoint = endpointBySession(sessionKey);
-    if (endpoint.isEmpty()) {
+    const QVariantMap endpoint = sessionKey.isEmpty() ? QVariantMap() : endpointBySession(sessionKey);
+    if (!sessionKey.isEmpty() && endpoint.isEmpty()) {
         emit consoleError(node, kind, vmid, QStringLiteral("Endpoint not found"));
         return;
     }
-    readMultiSecretFor({
+
+    // VNC opens are traced from here to the first frame. The trace also
+    // tells whether the request is still alive after dispatch: anything
+    // that failed synchronously went through consoleError and dropped it.
+    const bool vnc = kind != ProxmoxConst::Kind::Lxc;
+    const QString traceKey = consoleTraceKey(sessionKey, kind, node, vmid);
+    if (vnc) {
+        ConsoleOpenTrace trace;
+        trace.startMs = m_consoleClock.elapsed();
+        m_consoleTraces.insert(traceKey, trace);
+    }
+
+    const QVariantMap request {
         {QStringLiteral("kind"), ProxmoxConst::Kind::Console},
         {QStringLiteral("sessionKey"), sessionKey},
         {QStringLiteral("actionKind"), kind},
         {QStringLiteral("node"), node},
         {QStringLiteral("vmid"), vmid},
         {QStringLiteral("vmName"), vmName},
-    });
+    };
+    if (sessionKey.isEmpty())
+        readSingleSecretFor(request);
+    else
+        readMultiSecretFor(request);
+
+    // The keyring read and/or the vncproxy POST are in flight now; let the
+    // window, VncWsProxy and VncClient be built meanwhile rather than after
+    // consoleReady.
+    if (vnc && m_consoleTraces.contains(traceKey)) {
+        if (sessionKey.isEmpty()) {
+            emit consoleOpening(sessionKey, m_host, node, kind, vmid, vmName, m_port, m_ignoreSsl);
+        } else {
+            emit consoleOpening(sessionKey,
+                                endpoint.value(QStringLiteral("host")).toString(),
+                                node, kind, vmid, vmName,
+                                endpoint.value(QStringLiteral("port"), ProxmoxConst::Defaults::PvePort).toInt(),
+                                endpoint.value(QStringLiteral("ignoreSsl")).toBool());
+        }
+    }
+}
+
+void ProxmoxController::markConsoleStage(const QString &sessionKey,
+                                         const QString &kind,
+                                         const QString &node,
+                                         int vmid,
+                                         const QString &stage)
+{
+    auto it = m_consoleTraces.find(consoleTraceKey(sessionKey, kind, node, vmid));
+    if (it == m_consoleTraces.end()) return;
+    // First mark wins: a reconnect inside the same open must not move a
+    // stage that already happened.
+    if (!it->stages.contains(stage))
+        it->stages.insert(stage, m_consoleClock.elapsed() - it->startMs);
+    if (stage != QLatin1String("firstFrame")) return;
+
+    QVariantMap timeline = it->stages;
+    timeline.insert(QStringLiteral("cachedSecret"), it->cachedSecret);
+    m_consoleTraces.erase(it);
+
+    // Stages in the order they happened; the window usually lands while
+    // the ticket is still on the way.
+    QList<QPair<qint64, QString>> ordered;
+    for (auto s = timeline.constBegin(); s != timeline.constEnd(); ++s) {
+        if (s.key() != QLatin1String("cachedSecret"))
+            ordered.append({s.value().toLongLong(), s.key()});
+    }
+    std::sort(ordered.begin(), ordered.end());
+    QStringList parts;
+    for (const auto &entry : std::as_const(ordered))
+        parts.append(QStringLiteral("%1=%2").arg(entry.second).arg(entry.first));
+    appendDebugLog(QStringLiteral("[ProxmoxController] console open %1:%2:%3 ttff=%4ms creds=%5 %6")
+        .arg(kind, node)
+        .arg(vmid)
+        .arg(timeline.value(QStringLiteral("firstFrame")).toLongLong())
+        .arg(timeline.value(QStringLiteral("cachedSecret")).toBool() ? QStringLiteral("cached") : QStringLiteral("keyring"),
+             parts.join(QLatin1Char(' '))));
+    emit consoleOpenTimed(sessionKey, kind, node, vmid, timeline);
+}
+
+void ProxmoxController::watchThumbnail(const QString &sessionKey, const QString &node, int vmid, bool watch)
+{
+    if (watch)
+        m_thumbnails->watch(sessionKey, node, vmid);
+    else
+        m_thumbnails->unwatch(sessionKey, node, vmid);
+}
+
+QString ProxmoxController::thumbnailUrl(const QString &sessionKey, const QString &node, int vmid) const
+{
+    return m_thumbnails->url(sessionKey, node, vmid);
+}
+
+void ProxmoxController::requestThumbnailTicket(const QString &sessionKey, const QString &node, int vmid)
+{
+    const QVariantMap request {
+        {QStringLiteral("kind"), ProxmoxConst::Kind::Thumbnail},
+        {QStringLiteral("sessionKey"), sessionKey},
+        {QStringLiteral("node"), node},
+        {QStringLiteral("vmid"), vmid},
+    };
+    if (sessionKey.isEmpty())
+        readSingleSecretFor(request);
+    else
+        readMultiSecretFor(request);
 }
 
 void ProxmoxController::setSecretState(const QString &value) {
@@ -723,6 +915,7 @@ void ProxmoxController::setDisplayedProxmoxData(const QVariant &value) {
 void ProxmoxController::setDisplayedVmData(const QVariantList &value) {
     if (m_displayedVmData == value) return;
     m_displayedVmData = value;
+    m_backupIndexDirty = true;
     emit displayedVmDataChanged();
     emit runningVMsChanged();
 }
@@ -730,6 +923,7 @@ void ProxmoxController::setDisplayedVmData(const QVariantList &value) {
 void ProxmoxController::setDisplayedLxcData(const QVariantList &value) {
     if (m_displayedLxcData == value) return;
     m_displayedLxcData = value;
+    m_backupIndexDirty = true;
     emit displayedLxcDataChanged();
     emit runningLXCChanged();
 }
@@ -737,6 +931,7 @@ void ProxmoxController::setDisplayedLxcData(const QVariantList &value) {
 void ProxmoxController::setDisplayedEndpoints(const QVariantList &value) {
     if (m_displayedEndpoints == value) return;
     m_displayedEndpoints = value;
+    m_backupPoliciesDirty = true;
     emit displayedEndpointsChanged();
 }
 
@@ -778,6 +973,16 @@ int ProxmoxController::runningLXC() const {
     return count;
 }
 
+bool ProxmoxController::thumbnailsActive() const {
+    return m_thumbnails->isActive();
+}
+
+void ProxmoxController::setThumbnailsActive(bool value) {
+    if (m_thumbnails->isActive() == value) return;
+    m_thumbnails->setActive(value);
+    emit thumbnailsActiveChanged();
+}
+
 void ProxmoxController::setRefreshResolvingSecrets(bool value) {
     if (m_refreshResolvingSecrets == value) return;
     m_refreshResolvingSecrets = value;
@@ -926,6 +1131,7 @@ void ProxmoxController::resetTransientStateForModeChange() {
     setDisplayedVmData({});
     setDisplayedLxcData({});
     setDisplayedProxmoxData(QVariant());
+    resetTransitionBaseline();
 }
 
 void ProxmoxController::resetMultiTempData() {
@@ -963,7 +1169,53 @@ void ProxmoxController::dispatchSingleFetchWithSecret(const QString &secret) {
                            m_refreshSeq);
 }
 
+QString ProxmoxController::cachedSingleSecret() const {
+    // The client keeps the secret of the last successful read; it is only
+    // usable while it still belongs to the configured host and token.
+    if (m_secretState != QStringLiteral("ready")) return QString();
+    if (m_api->host() != m_host || m_api->port() != m_port || m_api->tokenId() != m_tokenId) return QString();
+    return m_api->tokenSecret();
+}
+
+void ProxmoxController::dispatchSingleThumbnailWithSecret(const QString &node, int vmid, const QString &secret) {
+    if (secret.isEmpty()) {
+        m_thumbnails->ticketFailed(QString(), node, vmid, QStringLiteral("credentials unavailable"));
+        return;
+    }
+    m_pendingThumbnailTickets.insert(thumbnailTicketKey(QString(), node, vmid));
+    m_api->requestVncProxy(QString(), m_host, m_port, m_tokenId, secret,
+                           m_ignoreSsl, m_trustedCertPem.toUtf8(), m_trustedCertPath,
+                           node, ProxmoxConst::Kind::Qemu, vmid);
+}
+
 void ProxmoxController::readSingleSecretFor(const QVariantMap &request) {
+    // Consoles skip the keyring round trip when the secret is already held,
+    // so the vncproxy POST goes out straight away.
+    if (request.value(QStringLiteral("kind")).toString() == ProxmoxConst::Kind::Console) {
+        const QString cached = cachedSingleSecret();
+        if (!cached.isEmpty()) {
+            auto it = m_consoleTraces.find(consoleTraceKey(QString(),
+                                                           request.value(QStringLiteral("actionKind")).toString(),
+                                                           request.value(QStringLiteral("node")).toString(),
+                                                           request.value(QStringLiteral("vmid")).toInt()));
+            if (it != m_consoleTraces.end())
+                it->cachedSecret = true;
+            dispatchSingleConsoleWithSecret(request, cached);
+            return;
+        }
+    }
+    // Thumbnails need a ticket for every grab; a keyring read each time would
+    // cost about as much as the grab itself.
+    if (request.value(QStringLiteral("kind")).toString() == ProxmoxConst::Kind::Thumbnail) {
+        const QString cached = cachedSingleSecret();
+        if (!cached.isEmpty()) {
+            dispatchSingleThumbnailWithSecret(request.value(QStringLiteral("node")).toString(),
+                                              request.value(QStringLiteral("vmid")).toInt(),
+                                              cached);
+            return;
+        }
+    }
+
     m_singleSecretStore->setKey(keyFor(m_host, m_port, m_tokenId));
     connect(m_singleSecretStore, &SecretStore::secretReady, this, [this, request](const QString &secret) {
         const QString kind = request.value(QStringLiteral("kind")).toString();
@@ -978,31 +1230,15 @@ void ProxmoxController::readSingleSecretFor(const QVariantMap &request) {
                                            request.value(QStringLiteral("action")).toString(),
                                            secret);
         }
-        if (kind == ProxmoxConst::Kind::Console) {
-            QString actionKind = request.value(QStringLiteral("actionKind")).toString();
-            QString node = request.value(QStringLiteral("node")).toString();
-            int vmid = request.value(QStringLiteral("vmid")).toInt();
-            QString vmName = request.value(QStringLiteral("vmName")).toString();
-
-            // Stash vmName so the ttyProxyReady/vncProxyReady forwarder can
-            // attach it to consoleReady (the underlying API doesn't carry it).
-            if (!vmName.isEmpty()) {
-                m_pendingConsoleNames.insert(
-                    QStringLiteral("%1:%2:%3").arg(actionKind, node).arg(vmid), vmName);
-            }
-
-        if (actionKind == ProxmoxConst::Kind::Lxc) {
-            m_api->requestTtyProxy(QString(), m_host, m_port, m_tokenId, secret,
-                                   m_ignoreSsl, m_trustedCertPem.toUtf8(), m_trustedCertPath,
-                                   node, vmid);
-        } else {
-            m_api->requestVncProxy(QString(), m_host, m_port, m_tokenId, secret,
-                                   m_ignoreSsl, m_trustedCertPem.toUtf8(), m_trustedCertPath,
-                                   node, actionKind, vmid);
+        if (kind == ProxmoxConst::Kind::Thumbnail) {
+            dispatchSingleThumbnailWithSecret(request.value(QStringLiteral("node")).toString(),
+                                              request.value(QStringLiteral("vmid")).toInt(),
+                                              secret);
+            return;
         }
+        if (kind == ProxmoxConst::Kind::Console) {
+            dispatchSingleConsoleWithSecret(request, secret);
         }
-    
-
     }, Qt::SingleShotConnection);
     connect(m_singleSecretStore, &SecretStore::error, this, [this, request](const QString &) {
         const QString kind = request.value(QStringLiteral("kind")).toString();
@@ -1016,6 +1252,12 @@ void ProxmoxController::readSingleSecretFor(const QVariantMap &request) {
                               request.value(QStringLiteral("vmid")).toInt(),
                               QStringLiteral("credentials unavailable"));
         }
+        if (kind == ProxmoxConst::Kind::Thumbnail) {
+            m_thumbnails->ticketFailed(QString(),
+                                       request.value(QStringLiteral("node")).toString(),
+                                       request.value(QStringLiteral("vmid")).toInt(),
+                                       QStringLiteral("credentials unavailable"));
+        }
         if (kind == ProxmoxConst::Kind::Action) {
             emit actionError(QString(),
                              request.value(QStringLiteral("actionKind")).toString(),
@@ -1028,6 +1270,31 @@ void ProxmoxController::readSingleSecretFor(const QVariantMap &request) {
     m_singleSecretStore->readSecret();
 }
 
+void ProxmoxController::dispatchSingleConsoleWithSecret(const QVariantMap &request, const QString &secret) {
+    const QString actionKind = request.value(QStringLiteral("actionKind")).toString();
+    const QString node = request.value(QStringLiteral("node")).toString();
+    const int vmid = request.value(QStringLiteral("vmid")).toInt();
+    const QString vmName = request.value(QStringLiteral("vmName")).toString();
+    markConsoleStage(QString(), actionKind, node, vmid, QStringLiteral("secret"));
+
+    // Stash vmName so the ttyProxyReady/vncProxyReady forwarder can
+    // attach it to consoleReady (the underlying API doesn't carry it).
+    if (!vmName.isEmpty()) {
+        m_pendingConsoleNames.insert(
+            QStringLiteral("%1:%2:%3").arg(actionKind, node).arg(vmid), vmName);
+    }
+
+    if (actionKind == ProxmoxConst::Kind::Lxc) {
+        m_api->requestTtyProxy(QString(), m_host, m_port, m_tokenId, secret,
+                               m_ignoreSsl, m_trustedCertPem.toUtf8(), m_trustedCertPath,
+                               node, vmid);
+    } else {
+        m_api->requestVncProxy(QString(), m_host, m_port, m_tokenId, secret,
+                               m_ignoreSsl, m_trustedCertPem.toUtf8(), m_trustedCertPath,
+                               node, actionKind, vmid);
+    }
+}
+
 bool ProxmoxController::dispatchSingleActionWithSecret(const QString &kind,
                                                        const QString &node,
                                                        int vmid,
@@ -1103,6 +1370,26 @@ void ProxmoxController::readMultiSecretFor(const QVariantMap &request) {
                                           secret);
         }
 
+        if (kind == ProxmoxConst::Kind::Thumbnail) {
+            const QString node = request.value(QStringLiteral("node")).toString();
+            const int vmid     = request.value(QStringLiteral("vmid")).toInt();
+            if (endpoint.isEmpty() || secret.isEmpty()) {
+                m_thumbnails->ticketFailed(sessionKey, node, vmid, QStringLiteral("endpoint credentials unavailable"));
+                return;
+            }
+            m_pendingThumbnailTickets.insert(thumbnailTicketKey(sessionKey, node, vmid));
+            m_api->requestVncProxy(sessionKey,
+                                   endpoint.value(QStringLiteral("host")).toString(),
+                                   endpoint.value(QStringLiteral("port"), ProxmoxConst::Defaults::PvePort).toInt(),
+                                   endpoint.value(QStringLiteral("tokenId")).toString(),
+                                   secret,
+                                   endpoint.value(QStringLiteral("ignoreSsl")).toBool(),
+                                   endpoint.value(QStringLiteral("trustedCertPem")).toString().toUtf8(),
+                                   endpoint.value(QStringLiteral("trustedCertPath")).toString(),
+                                   node, ProxmoxConst::Kind::Qemu, vmid);
+            return;
+        }
+
         if (kind == ProxmoxConst::Kind::Console) {
             const QString actionKind = request.value(QStringLiteral("actionKind")).toString();
             const QString node       = request.value(QStringLiteral("node")).toString();
@@ -1113,6 +1400,7 @@ void ProxmoxController::readMultiSecretFor(const QVariantMap &request) {
                 emit consoleError(node, actionKind, vmid, QStringLiteral("endpoint credentials unavailable"));
                 return;
             }
+            markConsoleStage(sessionKey, actionKind, node, vmid, QStringLiteral("secret"));
 
             // Stash vmName so the ttyProxyReady/vncProxyReady forwarder can
             // attach it to consoleReady (the underlying API doesn't carry it).
@@ -1172,6 +1460,13 @@ void ProxmoxController::readMultiSecretFor(const QVariantMap &request) {
                               request.value(QStringLiteral("vmid")).toInt(),
                               QStringLiteral("endpoint credentials unavailable"));
         }
+
+        if (kind == ProxmoxConst::Kind::Thumbnail) {
+            m_thumbnails->ticketFailed(sessionKey,
+                                       request.value(QStringLiteral("node")).toString(),
+                                       request.value(QStringLiteral("vmid")).toInt(),
+                                       QStringLiteral("endpoint credentials unavailable"));
+        }
     }, Qt::SingleShotConnection);
     m_multiSecretStore->readSecret();
 }
@@ -1427,9 +1722,11 @@ void ProxmoxController::checkRequestsComplete() {
         .arg(QString::number(m_nodeList.size()), QString::number(m_tempVmData.size()), QString::number(m_tempLxcData.size())));
     setDisplayedProxmoxData(m_proxmoxData);
     setDisplayedNodeList(m_nodeList);
+    rebuildBackupPolicies();
+    applyBackupState(m_tempVmData, false);
+    applyBackupState(m_tempLxcData, true);
     setDisplayedVmData(m_tempVmData);
     setDisplayedLxcData(m_tempLxcData);
-    correlateBackups();
     m_vmData = m_tempVmData;
     m_lxcData = m_tempLxcData;
     m_tempVmData.clear();
@@ -1439,6 +1736,7 @@ void ProxmoxController::checkRequestsComplete() {
     if (m_partialFailure) {
         setLastUpdate(QDateTime::currentDateTime().toString(QStringLiteral("hh:mm:ss")) + QStringLiteral(" ⚠"));
     }
+    detectStateTransitions();
 }
 
 void ProxmoxController::handleMultiReply(int seq, const QString &sessionKey, const QString &kind, const QString &node, const QVariant &data) {
@@ -1546,9 +1844,11 @@ void ProxmoxController::checkMultiRequestsComplete() {
         .arg(QString::number(aggVms.size()))
         .arg(QString::number(aggLxcs.size())));
     setDisplayedNodeList(aggNodes);
+    rebuildBackupPolicies();
+    applyBackupState(aggVms, false);
+    applyBackupState(aggLxcs, true);
     setDisplayedVmData(aggVms);
     setDisplayedLxcData(aggLxcs);
-    correlateBackups();
     setDisplayedProxmoxData(QVariant());
     if (!m_displayedEndpoints.isEmpty()) {
         setErrorMessage(QString());
@@ -1557,6 +1857,102 @@ void ProxmoxController::checkMultiRequestsComplete() {
     resetRetryState();
     setIsRefreshing(false);
     setLoading(false);
+    detectStateTransitions();
+}
+
+void ProxmoxController::resetTransitionBaseline() {
+    m_previousStates.clear();
+    m_transitionBaselineRecorded = false;
+}
+
+void ProxmoxController::detectStateTransitions() {
+    const bool multi = m_connectionMode == QStringLiteral("multiHost");
+    const QString node = QStringLiteral("node");
+    const QString status = QStringLiteral("status");
+    const QString sessionKeyField = QStringLiteral("sessionKey");
+    const QString running = ProxmoxConst::Status::Running;
+    const QString online = QStringLiteral("online");
+
+    QVariantList transitions;
+    const bool baseline = !m_transitionBaselineRecorded;
+
+    auto observe = [&](const StateKey &key, const QString &current, const QString &name) {
+        auto it = m_previousStates.find(key);
+        if (it == m_previousStates.end()) {
+            m_previousStates.insert(key, current);
+            return;
+        }
+        const QString previous = it.value();
+        if (previous == current) return;
+        it.value() = current;
+        if (baseline) return;
+
+        bool notify = false;
+        if (key.kind == node) {
+            notify = m_notifyOnNodeChange && ((previous == online) != (current == online));
+        } else if (shouldNotify(name, key.vmid)) {
+            notify = (m_notifyOnStop && previous == running && current != running)
+                  || (m_notifyOnStart && previous != running && current == running);
+        }
+        QVariantMap entry;
+        entry.insert(QStringLiteral("type"), key.kind);
+        entry.insert(sessionKeyField, key.sessionKey);
+        entry.insert(node, key.node);
+        entry.insert(QStringLiteral("vmid"), key.vmid);
+        entry.insert(QStringLiteral("name"), name);
+        entry.insert(QStringLiteral("previous"), previous);
+        entry.insert(QStringLiteral("current"), current);
+        entry.insert(QStringLiteral("notify"), notify);
+        transitions.push_back(entry);
+    };
+
+    if (multi) {
+        for (const QVariant &endpointValue : std::as_const(m_displayedEndpoints)) {
+            const QVariantMap endpoint = endpointValue.toMap();
+            const QString sessionKey = endpoint.value(sessionKeyField).toString();
+            if (sessionKey.isEmpty()) continue;
+            for (const QVariant &nodeValue : endpoint.value(QStringLiteral("nodes")).toList()) {
+                const QVariantMap nodeItem = nodeValue.toMap();
+                const QString nodeName = nodeItem.value(node).toString();
+                observe(StateKey{sessionKey, nodeName, node, 0}, nodeItem.value(status).toString(), nodeName);
+            }
+        }
+    } else {
+        for (const QVariant &nodeValue : m_displayedProxmoxData.toMap().value(QStringLiteral("data")).toList()) {
+            const QVariantMap nodeItem = nodeValue.toMap();
+            const QString nodeName = nodeItem.value(node).toString();
+            observe(StateKey{QString(), nodeName, node, 0}, nodeItem.value(status).toString(), nodeName);
+        }
+    }
+
+    auto observeGuests = [&](const QVariantList &items, const QString &kind) {
+        for (const QVariant &itemValue : items) {
+            const QVariantMap item = itemValue.toMap();
+            const QString sessionKey = multi ? item.value(sessionKeyField).toString() : QString();
+            // Rows without a session key can't be attributed to an endpoint.
+            if (multi && sessionKey.isEmpty()) continue;
+            const int vmid = item.value(QStringLiteral("vmid")).toInt();
+            const QString name = item.value(QStringLiteral("name")).toString();
+            observe(StateKey{sessionKey, item.value(node).toString(), kind, vmid},
+                    item.value(status).toString(),
+                    name.isEmpty() ? QString::number(vmid) : name);
+        }
+    };
+    observeGuests(m_displayedVmData, ProxmoxConst::Kind::Qemu);
+    observeGuests(m_displayedLxcData, ProxmoxConst::Kind::Lxc);
+
+    if (baseline) {
+        // Nothing to compare against yet; this pass only records states.
+        if (!m_previousStates.isEmpty()) {
+            m_transitionBaselineRecorded = true;
+            appendDebugLog(QStringLiteral("[ProxmoxController] state baseline recorded entries=%1").arg(m_previousStates.size()));
+        }
+        return;
+    }
+    if (transitions.isEmpty()) return;
+
+    appendDebugLog(QStringLiteral("[ProxmoxController] state transitions count=%1").arg(transitions.size()));
+    emit stateTransitions(transitions);
 }
 
 QVariantList ProxmoxController::parseMultiHosts() const {
@@ -1610,9 +2006,20 @@ void ProxmoxController::refreshPBS() {
 void ProxmoxController::refreshPBSNow() {
     m_api->cancelPBS();
     appendDebugLog(QStringLiteral("[ProxmoxController] refreshPBS mode=%1").arg(m_connectionMode));
-    m_latestBackups.clear();
-    m_pendingPbsSnapshotRequests = 0;
-    m_pendingPbsEndpoints = 0;
+    // m_latestBackups is kept: rows keep showing the last known state (live
+    // or cached) until this crawl completes and is merged in.
+    m_pbsRefreshBackups.clear();
+    m_pbsRefreshHostsOk.clear();
+    m_pbsRefreshHostsFailed.clear();
+    m_pbsConfiguredHosts.clear();
+    m_pbsActiveCrawls.clear();
+    m_pendingPbsSecretReads = 0;
+    const int generation = ++m_pbsRefreshGeneration;
+    if (m_pbsProgressDone != 0 || m_pbsProgressTotal != 0) {
+        m_pbsProgressDone = 0;
+        m_pbsProgressTotal = 0;
+        emit pbsProgressChanged();
+    }
 
     m_pbsRefreshInterval = m_pbsRefreshInterval > 0 ? m_pbsRefreshInterval : ProxmoxConst::Defaults::PbsRefreshInterval;
     if (m_pbsTimer) {
@@ -1644,43 +2051,51 @@ void ProxmoxController::refreshPBSNow() {
                 .arg(pbsTokenId.isEmpty() ? QStringLiteral("true") : QStringLiteral("false"))
                 .arg(m_pbsRefreshInterval));
             if (!pbsEnabled || pbsHost.isEmpty() || pbsTokenId.isEmpty()) {
+                store->deleteLater();
+                // Nothing configured: finishing prunes every cached host.
+                finishPBSRefresh();
                 correlateBackups();
                 return;
             }
-            connect(store, &SecretStore::secretReady, this, [this, store, pbsHost, pbsPort, pbsTokenId, pbsIgnoreSsl](const QString &secret) {
+            m_pbsConfiguredHosts.insert(normalizedHost(pbsHost));
+            const int maxConcurrent = m_pbsMaxConcurrentRequests;
+            m_pendingPbsSecretReads = 1;
+            connect(store, &SecretStore::secretReady, this, [this, store, generation, pbsHost, pbsPort, pbsTokenId, pbsIgnoreSsl, maxConcurrent](const QString &secret) {
                 appendDebugLog(QStringLiteral("[ProxmoxController] refreshPBS single secretReady host=%1 secretEmpty=%2")
                     .arg(pbsHost, secret.isEmpty() ? QStringLiteral("true") : QStringLiteral("false")));
                 store->deleteLater();
-                if (secret.isEmpty()) {
-                    correlateBackups();
-                    return;
-                }
-                m_pendingPbsEndpoints = 1;
-                m_api->fetchPBSDatastores(pbsHost, pbsPort, pbsTokenId, secret, pbsIgnoreSsl, m_pbsTrustedCertPem.toUtf8(), m_pbsTrustedCertPath);
+                if (generation != m_pbsRefreshGeneration) return;
+                startPBSCrawl(pbsHost, pbsPort, pbsTokenId, secret, pbsIgnoreSsl, maxConcurrent);
             });
-            connect(store, &SecretStore::error, this, [this, store, pbsHost](const QString &message) {
+            connect(store, &SecretStore::error, this, [this, store, generation, pbsHost](const QString &message) {
                 appendDebugLog(QStringLiteral("[ProxmoxController] refreshPBS single secretError host=%1 message=%2").arg(pbsHost, message));
                 store->deleteLater();
-                if (m_pbsRefreshError != message) {
-                    m_pbsRefreshError = message;
-                    emit pbsLastErrorChanged();
-                }
-                if (m_pendingPbsEndpoints > 0) {
-                    m_pendingPbsEndpoints -= 1;
-                }
-                if (m_pendingPbsSnapshotRequests <= 0 && m_pendingPbsEndpoints <= 0) {
-                    correlateBackups();
-                }
+                if (generation != m_pbsRefreshGeneration) return;
+                failPBSSecretRead(pbsHost, message);
             });
             store->readSecret();
             return;
         }
+        finishPBSRefresh();
         correlateBackups();
         return;
     }
 
+    // Endpoints that back up to the same PBS server with the same token share
+    // one keychain read and one crawl; results are keyed by PBS host, so every
+    // endpoint referencing it correlates against the same snapshots.
+    struct PbsCrawlGroup {
+        QString pbsHost;
+        int pbsPort = ProxmoxConst::Defaults::PbsPort;
+        QString pbsTokenId;
+        bool pbsIgnoreSsl = false;
+        int maxConcurrent = ProxmoxConst::Defaults::PbsMaxConcurrentRequests;
+        int endpoints = 0;
+    };
+    QList<PbsCrawlGroup> groups;
+    QHash<QString, qsizetype> groupIndex;
+
     const QVariantList entries = parseMultiHosts();
-    bool anyConfigured = false;
     for (const QVariant &entryValue : entries) {
         const QVariantMap entry = entryValue.toMap();
         if (entry.value(QStringLiteral("enabled"), true).toBool() == false) continue;
@@ -1688,47 +2103,155 @@ void ProxmoxController::refreshPBSNow() {
         const QString pbsHost = entry.value(QStringLiteral("pbsHost")).toString().trimmed();
         const QString pbsTokenId = entry.value(QStringLiteral("pbsTokenId")).toString().trimmed();
         if (pbsHost.isEmpty() || pbsTokenId.isEmpty()) continue;
-        anyConfigured = true;
+        const int pbsPort = entry.value(QStringLiteral("pbsPort"), ProxmoxConst::Defaults::PbsPort).toInt() > 0 ? entry.value(QStringLiteral("pbsPort"), ProxmoxConst::Defaults::PbsPort).toInt() : ProxmoxConst::Defaults::PbsPort;
+        const bool pbsIgnoreSsl = entry.value(QStringLiteral("pbsIgnoreSsl"), false).toBool();
+        const int maxConcurrent = entry.value(QStringLiteral("pbsMaxConcurrent"), ProxmoxConst::Defaults::PbsMaxConcurrentRequests).toInt();
+        m_pbsConfiguredHosts.insert(normalizedHost(pbsHost));
+
+        const QString groupKey = QStringLiteral("%1|%2|%3").arg(normalizedHost(pbsHost)).arg(pbsPort).arg(pbsTokenId);
+        const auto existing = groupIndex.constFind(groupKey);
+        if (existing == groupIndex.constEnd()) {
+            groupIndex.insert(groupKey, groups.size());
+            groups.push_back(PbsCrawlGroup{pbsHost, pbsPort, pbsTokenId, pbsIgnoreSsl, maxConcurrent, 1});
+            continue;
+        }
+        // Shared crawl takes the strictest settings of the entries using it:
+        // verify TLS unless every entry opted out, and the smallest window.
+        PbsCrawlGroup &group = groups[existing.value()];
+        group.pbsIgnoreSsl = group.pbsIgnoreSsl && pbsIgnoreSsl;
+        group.maxConcurrent = std::min(group.maxConcurrent, maxConcurrent);
+        group.endpoints += 1;
+    }
+
+    for (const PbsCrawlGroup &group : std::as_const(groups)) {
+        const QString pbsHost = group.pbsHost;
+        const int pbsPort = group.pbsPort;
+        const QString pbsTokenId = group.pbsTokenId;
+        const bool pbsIgnoreSsl = group.pbsIgnoreSsl;
+        const int maxConcurrent = group.maxConcurrent;
         auto *store = new SecretStore(this);
         const QString key = pbsKeyForHost(pbsHost);
-        appendDebugLog(QStringLiteral("[ProxmoxController] refreshPBS multi readKey host=%1 key=%2").arg(pbsHost, key));
+        appendDebugLog(QStringLiteral("[ProxmoxController] refreshPBS multi readKey host=%1 key=%2 endpoints=%3").arg(pbsHost, key).arg(group.endpoints));
         store->setService(QStringLiteral("ProxMon"));
         store->setKey(key);
-        m_pendingPbsEndpoints += 1;
-        const int pbsPort = entry.value(QStringLiteral("pbsPort"), ProxmoxConst::Defaults::PbsPort).toInt() > 0 ? entry.value(QStringLiteral("pbsPort"), ProxmoxConst::Defaults::PbsPort).toInt() : ProxmoxConst::Defaults::PbsPort;
-        const bool pbsIgnoreSsl = entry.value(QStringLiteral("pbsIgnoreSsl"), false).toBool();
-        connect(store, &SecretStore::secretReady, this, [this, store, pbsHost, pbsPort, pbsTokenId, pbsIgnoreSsl](const QString &secret) {
+        m_pendingPbsSecretReads += 1;
+        connect(store, &SecretStore::secretReady, this, [this, store, generation, pbsHost, pbsPort, pbsTokenId, pbsIgnoreSsl, maxConcurrent](const QString &secret) {
             store->deleteLater();
-            if (secret.isEmpty()) {
-                if (m_pendingPbsEndpoints > 0) {
-                    m_pendingPbsEndpoints -= 1;
-                }
-                if (m_pendingPbsSnapshotRequests <= 0 && m_pendingPbsEndpoints <= 0) {
-                    correlateBackups();
-                }
-                return;
-            }
-            m_api->fetchPBSDatastores(pbsHost, pbsPort, pbsTokenId, secret, pbsIgnoreSsl, m_pbsTrustedCertPem.toUtf8(), m_pbsTrustedCertPath);
+            if (generation != m_pbsRefreshGeneration) return;
+            startPBSCrawl(pbsHost, pbsPort, pbsTokenId, secret, pbsIgnoreSsl, maxConcurrent);
         });
-        connect(store, &SecretStore::error, this, [this, store, pbsHost](const QString &message) {
+        connect(store, &SecretStore::error, this, [this, store, generation, pbsHost](const QString &message) {
             appendDebugLog(QStringLiteral("[ProxmoxController] refreshPBS multi secretError host=%1 message=%2").arg(pbsHost, message));
             store->deleteLater();
-            if (m_pbsRefreshError != message) {
-                m_pbsRefreshError = message;
-                emit pbsLastErrorChanged();
-            }
-            if (m_pendingPbsEndpoints > 0) {
-                m_pendingPbsEndpoints -= 1;
-            }
-            if (m_pendingPbsSnapshotRequests <= 0 && m_pendingPbsEndpoints <= 0) {
-                correlateBackups();
-            }
+            if (generation != m_pbsRefreshGeneration) return;
+            failPBSSecretRead(pbsHost, message);
         });
         store->readSecret();
     }
 
-    if (!anyConfigured) {
+    if (groups.isEmpty()) {
+        finishPBSRefresh();
+        correlateBackups();
+    }
+}
+
+void ProxmoxController::startPBSCrawl(const QString &pbsHost,
+                                      int pbsPort,
+                                      const QString &pbsTokenId,
+                                      const QString &secret,
+                                      bool pbsIgnoreSsl,
+                                      int maxConcurrent) {
+    m_pendingPbsSecretReads = std::max(0, m_pendingPbsSecretReads - 1);
+    if (secret.isEmpty()) {
+        m_pbsRefreshHostsFailed.insert(normalizedHost(pbsHost));
+        maybeFinishPBSRefresh();
+        return;
+    }
+    const int clamped = maxConcurrent > 0 ? std::min(maxConcurrent, 16) : ProxmoxConst::Defaults::PbsMaxConcurrentRequests;
+    const int crawlId = m_api->fetchPBSDatastores(pbsHost, pbsPort, pbsTokenId, secret, pbsIgnoreSsl,
+                                                  m_pbsTrustedCertPem.toUtf8(), m_pbsTrustedCertPath, clamped);
+    m_pbsActiveCrawls.insert(crawlId, PbsCrawlState{normalizedHost(pbsHost), 0, 0});
+}
+
+void ProxmoxController::failPBSSecretRead(const QString &pbsHost, const QString &message) {
+    if (m_pbsRefreshError != message) {
+        m_pbsRefreshError = message;
+        emit pbsLastErrorChanged();
+    }
+    m_pendingPbsSecretReads = std::max(0, m_pendingPbsSecretReads - 1);
+    m_pbsRefreshHostsFailed.insert(normalizedHost(pbsHost));
+    maybeFinishPBSRefresh();
+}
+
+void ProxmoxController::maybeFinishPBSRefresh() {
+    if (m_pendingPbsSecretReads > 0 || !m_pbsActiveCrawls.isEmpty()) return;
+    finishPBSRefresh();
+}
+
+void ProxmoxController::finishPBSRefresh() {
+    QSet<BackupKey> changedKeys;
+    const QSet<QString> staleBefore = m_staleBackupHosts;
+
+    // Hosts that listed their datastores and answered every snapshot request
+    // own their slice of the table outright: anything not seen this time was
+    // pruned on the server. Hosts with a failure keep their previous entries
+    // (merged with whatever did arrive) and stay stale. Hosts no longer
+    // configured are dropped.
+    for (auto it = m_latestBackups.begin(); it != m_latestBackups.end();) {
+        const QString &host = it.key().pbsHost;
+        const bool refreshedHost = m_pbsRefreshHostsOk.contains(host) && !m_pbsRefreshHostsFailed.contains(host);
+        if (!m_pbsConfiguredHosts.contains(host) || (refreshedHost && !m_pbsRefreshBackups.contains(it.key()))) {
+            changedKeys.insert(it.key());
+            it = m_latestBackups.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (auto it = m_pbsRefreshBackups.constBegin(); it != m_pbsRefreshBackups.constEnd(); ++it) {
+        const auto current = m_latestBackups.constFind(it.key());
+        if (current == m_latestBackups.constEnd() || current.value() != it.value()) {
+            m_latestBackups.insert(it.key(), it.value());
+            changedKeys.insert(it.key());
+        }
+    }
+
+    for (auto it = m_staleBackupHosts.begin(); it != m_staleBackupHosts.end();) {
+        const bool refreshedHost = m_pbsRefreshHostsOk.contains(*it) && !m_pbsRefreshHostsFailed.contains(*it);
+        if (refreshedHost || !m_pbsConfiguredHosts.contains(*it)) {
+            it = m_staleBackupHosts.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (const QString &host : std::as_const(m_pbsRefreshHostsFailed)) {
+        if (m_pbsConfiguredHosts.contains(host)) {
+            m_staleBackupHosts.insert(host);
+        }
+    }
+
+    m_pbsRefreshBackups.clear();
+    m_pbsRefreshHostsOk.clear();
+    m_pbsRefreshHostsFailed.clear();
+
+    if (!changedKeys.isEmpty()) {
+        const bool saved = BackupStatusCache::save(m_backupCachePath, m_latestBackups);
+        appendDebugLog(QStringLiteral("[ProxmoxController] backup cache save entries=%1 ok=%2")
+            .arg(m_latestBackups.size())
+            .arg(saved ? QStringLiteral("true") : QStringLiteral("false")));
+    }
+
+    const bool stale = !m_staleBackupHosts.isEmpty();
+    if (m_backupStatusStale != stale) {
+        m_backupStatusStale = stale;
+        emit backupStatusStaleChanged();
+    }
+
+    // Only rows for guests whose latest snapshot changed need touching,
+    // unless a host flipped between stale and fresh.
+    if (m_staleBackupHosts != staleBefore) {
         correlateBackups();
+    } else {
+        correlateBackupKeys(changedKeys);
     }
 }
 
@@ -1756,113 +2279,153 @@ QString ProxmoxController::lastBackupDisplay(qint64 backupTime) const {
 }
 
 bool ProxmoxController::isBackupExcluded(int vmid, const QString &tags) const {
-    if (!m_pbsExcludeTag.trimmed().isEmpty()) {
-        if (tags.contains(m_pbsExcludeTag.trimmed(), Qt::CaseInsensitive))
-            return true;
+    // The exclusion field lists VMIDs (wildcards like "90*" also work); names
+    // are deliberately not matched here.
+    return m_backupExclusionRules.matches(FilterRules::Row{vmid, QString(), tags});
+}
+
+void ProxmoxController::rebuildBackupPolicies() {
+    m_backupPolicies.clear();
+
+    BackupPolicy single;
+    single.enabled = m_pbsEnabled;
+    single.pbsHost = normalizedHost(m_pbsHost);
+    single.warningDays = std::max(1, m_pbsBackupWarningDays);
+    single.staleDays = std::max(single.warningDays, m_pbsBackupStaleDays);
+    m_backupPolicies.insert(QString(), single);
+
+    for (const QVariant &endpointValue : std::as_const(m_displayedEndpoints)) {
+        const QVariantMap endpoint = endpointValue.toMap();
+        BackupPolicy policy;
+        policy.enabled = endpoint.value(QStringLiteral("pbsEnabled"), false).toBool();
+        policy.pbsHost = normalizedHost(endpoint.value(QStringLiteral("pbsHost")).toString());
+        policy.warningDays = std::max(1, endpoint.value(QStringLiteral("pbsBackupWarningDays"), 7).toInt());
+        policy.staleDays = std::max(policy.warningDays, endpoint.value(QStringLiteral("pbsBackupStaleDays"), 14).toInt());
+        m_backupPolicies.insert(endpoint.value(QStringLiteral("sessionKey")).toString(), policy);
     }
-    if (!m_pbsExcludeVmids.trimmed().isEmpty()) {
-        const QStringList vmids = m_pbsExcludeVmids.split(QLatin1Char(','), Qt::SkipEmptyParts);
-        for (const QString &v : vmids) {
-            if (v.trimmed().toInt() == vmid)
-                return true;
-        }
+    m_backupPoliciesDirty = false;
+}
+
+void ProxmoxController::rebuildBackupIndex() {
+    m_backupRowsByVmid.clear();
+    m_backupRowsByVmid.reserve(m_displayedVmData.size() + m_displayedLxcData.size());
+    for (int row = 0; row < m_displayedVmData.size(); ++row) {
+        m_backupRowsByVmid.insert(m_displayedVmData.at(row).toMap().value(QStringLiteral("vmid")).toInt(), BackupRowRef{false, row});
+    }
+    for (int row = 0; row < m_displayedLxcData.size(); ++row) {
+        m_backupRowsByVmid.insert(m_displayedLxcData.at(row).toMap().value(QStringLiteral("vmid")).toInt(), BackupRowRef{true, row});
+    }
+    m_backupIndexDirty = false;
+}
+
+ProxmoxController::BackupRowState ProxmoxController::backupStateFor(const QVariantMap &item, bool isLxc) const {
+    BackupRowState state;
+    const auto policyIt = m_backupPolicies.constFind(item.value(QStringLiteral("sessionKey")).toString());
+    if (policyIt == m_backupPolicies.constEnd() || !policyIt->enabled) {
+        return state;
+    }
+
+    const int vmid = item.value(QStringLiteral("vmid")).toInt();
+    if (isBackupExcluded(vmid, item.value(QStringLiteral("tags")).toString())) {
+        state.status = BackupStatus::Excluded;
+        return state;
+    }
+
+    const BackupKey key{policyIt->pbsHost, isLxc ? QStringLiteral("ct") : QStringLiteral("vm"), vmid};
+    const auto backupIt = m_latestBackups.constFind(key);
+    if (backupIt != m_latestBackups.constEnd()) {
+        state.backupTime = backupIt->backupTime;
+        state.verifyState = backupIt->verifyState;
+    }
+    state.status = evaluateBackupStatus(state.backupTime, policyIt->warningDays, policyIt->staleDays);
+    state.display = lastBackupDisplay(state.backupTime);
+    state.stale = m_staleBackupHosts.contains(key.pbsHost);
+    return state;
+}
+
+bool ProxmoxController::writeBackupState(QVariantMap &item, const BackupRowState &state) const {
+    if (item.value(QStringLiteral("backupStatus"), int(BackupStatus::Unknown)).toInt() == int(state.status)
+        && item.value(QStringLiteral("lastBackupTime")).toLongLong() == state.backupTime
+        && item.value(QStringLiteral("lastBackupDisplay")).toString() == state.display
+        && item.value(QStringLiteral("verifyState")).toString() == state.verifyState
+        && item.value(QStringLiteral("backupStale")).toBool() == state.stale) {
+        return false;
     }
-    return false;
+    item.insert(QStringLiteral("backupStatus"), int(state.status));
+    item.insert(QStringLiteral("lastBackupTime"), state.backupTime);
+    item.insert(QStringLiteral("lastBackupDisplay"), state.display);
+    item.insert(QStringLiteral("verifyState"), state.verifyState);
+    item.insert(QStringLiteral("backupStale"), state.stale);
+    return true;
 }
 
-void ProxmoxController::applyBackupState(QVariantList &items, const QVariantMap &endpointMap, bool isLxc, bool &anyChanged) {
+void ProxmoxController::applyBackupState(QVariantList &items, bool isLxc) const {
     for (QVariant &itemValue : items) {
         QVariantMap item = itemValue.toMap();
-        const int vmid = item.value(QStringLiteral("vmid")).toInt();
-        const QString sessionKey = item.value(QStringLiteral("sessionKey")).toString();
-        const QVariantMap endpoint = sessionKey.isEmpty() ? QVariantMap() : endpointMap.value(sessionKey).toMap();
-        const bool pbsEnabled = sessionKey.isEmpty()
-            ? m_pbsEnabled
-            : endpoint.value(QStringLiteral("pbsEnabled"), false).toBool();
-        if (!pbsEnabled) {
-            const int oldStatus = item.value(QStringLiteral("backupStatus"), int(BackupStatus::Unknown)).toInt();
-            const QString oldDisplay = item.value(QStringLiteral("lastBackupDisplay")).toString();
-            const QString oldVerify = item.value(QStringLiteral("verifyState")).toString();
-            if (oldStatus != int(BackupStatus::Unknown) || !oldDisplay.isEmpty() || !oldVerify.isEmpty()) {
-                item.insert(QStringLiteral("backupStatus"), int(BackupStatus::Unknown));
-                item.insert(QStringLiteral("lastBackupTime"), 0);
-                item.insert(QStringLiteral("lastBackupDisplay"), QString());
-                item.insert(QStringLiteral("verifyState"), QString());
-                anyChanged = true;
-            }
-            itemValue = item;
-            continue;
-        }
-        // Check exclusions
-        const QString itemTags = item.value(QStringLiteral("tags")).toString();
-        if (isBackupExcluded(vmid, itemTags)) {
-            const int exOldStatus = item.value(QStringLiteral("backupStatus"), int(BackupStatus::Unknown)).toInt();
-            const QString exOldDisplay = item.value(QStringLiteral("lastBackupDisplay")).toString();
-            const QString exOldVerify = item.value(QStringLiteral("verifyState")).toString();
-            if (exOldStatus != int(BackupStatus::Excluded) || !exOldDisplay.isEmpty() || !exOldVerify.isEmpty()) {
-                item.insert(QStringLiteral("backupStatus"), int(BackupStatus::Excluded));
-                item.insert(QStringLiteral("lastBackupTime"), 0);
-                item.insert(QStringLiteral("lastBackupDisplay"), QString());
-                item.insert(QStringLiteral("verifyState"), QString());
-                anyChanged = true;
-            }
+        if (writeBackupState(item, backupStateFor(item, isLxc))) {
             itemValue = item;
-            continue;
         }
-
-        const int warningDays = sessionKey.isEmpty()
-            ? std::max(1, m_pbsBackupWarningDays)
-            : std::max(1, endpoint.value(QStringLiteral("pbsBackupWarningDays"), 7).toInt());
-        const int staleDays = sessionKey.isEmpty()
-            ? std::max(warningDays, m_pbsBackupStaleDays)
-            : std::max(warningDays, endpoint.value(QStringLiteral("pbsBackupStaleDays"), 14).toInt());
-
-        const QString expectedType = isLxc ? QStringLiteral("ct") : QStringLiteral("vm");
-        const QString pbsHost = sessionKey.isEmpty()
-            ? m_pbsHost.trimmed()
-            : endpoint.value(QStringLiteral("pbsHost")).toString().trimmed();
-        const QString backupKey = QStringLiteral("%1|%2|%3").arg(normalizedHost(pbsHost), expectedType, QString::number(vmid));
-        const auto backupIt = m_latestBackups.constFind(QStringView{backupKey});
-        const PBSSnapshot snapshot = backupIt == m_latestBackups.constEnd() ? PBSSnapshot{} : backupIt.value();
-        const bool typeMatch = snapshot.backupType.isEmpty() || snapshot.backupType == expectedType;
-        const qint64 backupTime = typeMatch ? snapshot.backupTime : 0;
-        const BackupStatus status = evaluateBackupStatus(backupTime, warningDays, staleDays);
-        const int oldStatus = item.value(QStringLiteral("backupStatus"), int(BackupStatus::Unknown)).toInt();
-        const QString oldDisplay = item.value(QStringLiteral("lastBackupDisplay")).toString();
-        const QString oldVerify = item.value(QStringLiteral("verifyState")).toString();
-        const QString newDisplay = lastBackupDisplay(backupTime);
-        const QString newVerify = typeMatch ? snapshot.verifyState : QString();
-
-        if (oldStatus != int(status) || oldDisplay != newDisplay || oldVerify != newVerify) {
-            item.insert(QStringLiteral("backupStatus"), int(status));
-            item.insert(QStringLiteral("lastBackupTime"), backupTime);
-            item.insert(QStringLiteral("lastBackupDisplay"), newDisplay);
-            item.insert(QStringLiteral("verifyState"), newVerify);
-            anyChanged = true;
-        }
-        itemValue = item;
     }
 }
 
+bool ProxmoxController::updateBackupRow(bool isLxc, int row) {
+    QVariantList &rows = isLxc ? m_displayedLxcData : m_displayedVmData;
+    if (row < 0 || row >= rows.size()) return false;
+    QVariantMap item = rows.at(row).toMap();
+    if (!writeBackupState(item, backupStateFor(item, isLxc))) return false;
+    rows[row] = item;
+    return true;
+}
+
+void ProxmoxController::publishBackupRows(const QList<int> &vmRows, const QList<int> &lxcRows) {
+    if (vmRows.isEmpty() && lxcRows.isEmpty()) return;
+    appendDebugLog(QStringLiteral("[ProxmoxController] backup rows changed vms=%1 lxcs=%2")
+        .arg(vmRows.size())
+        .arg(lxcRows.size()));
+    if (!vmRows.isEmpty()) emit displayedVmDataChanged();
+    if (!lxcRows.isEmpty()) emit displayedLxcDataChanged();
+}
+
 void ProxmoxController::correlateBackups() {
-    bool anyChanged = false;
-    QVariantMap endpointMap;
-    for (const QVariant &endpointValue : m_displayedEndpoints) {
-        const QVariantMap endpoint = endpointValue.toMap();
-        endpointMap.insert(endpoint.value(QStringLiteral("sessionKey")).toString(), endpoint);
+    // Full pass: thresholds, exclusions or stale flags may have moved for
+    // every row. Rows are rewritten in place only where something differs.
+    rebuildBackupPolicies();
+    QList<int> vmRows;
+    QList<int> lxcRows;
+    for (int row = 0; row < m_displayedVmData.size(); ++row) {
+        if (updateBackupRow(false, row)) vmRows.push_back(row);
     }
-
-    QVariantList vms = m_displayedVmData;
-    applyBackupState(vms, endpointMap, false, anyChanged);
-    if (vms != m_displayedVmData) {
-        setDisplayedVmData(vms);
+    for (int row = 0; row < m_displayedLxcData.size(); ++row) {
+        if (updateBackupRow(true, row)) lxcRows.push_back(row);
     }
+    publishBackupRows(vmRows, lxcRows);
+}
 
-    QVariantList lxcs = m_displayedLxcData;
-    applyBackupState(lxcs, endpointMap, true, anyChanged);
-    if (lxcs != m_displayedLxcData) {
-        setDisplayedLxcData(lxcs);
+void ProxmoxController::correlateBackupKeys(const QSet<BackupKey> &keys) {
+    if (keys.isEmpty()) return;
+    if (m_backupPoliciesDirty) {
+        correlateBackups();
+        return;
+    }
+    if (m_backupIndexDirty) {
+        rebuildBackupIndex();
+    }
+
+    QList<int> vmRows;
+    QList<int> lxcRows;
+    for (const BackupKey &key : keys) {
+        const bool isLxc = key.backupType == QLatin1String("ct");
+        if (!isLxc && key.backupType != QLatin1String("vm")) continue;
+        // The same vmid can exist on several clusters; backupStateFor()
+        // resolves each row's own PBS host, so foreign rows are a no-op.
+        for (auto it = m_backupRowsByVmid.constFind(key.vmid); it != m_backupRowsByVmid.constEnd() && it.key() == key.vmid; ++it) {
+            if (it->lxc != isLxc) continue;
+            if (updateBackupRow(isLxc, it->row)) {
+                (isLxc ? lxcRows : vmRows).push_back(it->row);
+            }
+        }
     }
+    publishBackupRows(vmRows, lxcRows);
 }
 
 QString ProxmoxController::normalizedHost(const QString &host) const {
@@ -1,15 +1,20 @@
 #pragma once
 
 #include <QObject>
+#include <QElapsedTimer>
 #include <QHash>
 #include <QMap>
+#include <QSet>
 #include <QTimer>
 #include <QVariant>
 
+#include "filterrules.h"
 #include "pbstypes.h"
+#include "proxmoxconsts.h"
 
 class ProxmoxClient;
 class SecretStore;
+class VncThumbnailService;
 
 class ProxmoxController : public QObject {
     Q_OBJECT
@@ -31,8 +36,15 @@ class ProxmoxController : public QObject {
     Q_PROPERTY(int pbsBackupWarningDays READ pbsBackupWarningDays WRITE setPbsBackupWarningDays NOTIFY pbsBackupWarningDaysChanged)
     Q_PROPERTY(int pbsBackupStaleDays READ pbsBackupStaleDays WRITE setPbsBackupStaleDays NOTIFY pbsBackupStaleDaysChanged)
     Q_PROPERTY(int pbsRefreshInterval READ pbsRefreshInterval WRITE setPbsRefreshInterval NOTIFY pbsRefreshIntervalChanged)
+    Q_PROPERTY(int pbsMaxConcurrentRequests READ pbsMaxConcurrentRequests WRITE setPbsMaxConcurrentRequests NOTIFY pbsMaxConcurrentRequestsChanged)
     Q_PROPERTY(QString pbsExcludeTag READ pbsExcludeTag WRITE setPbsExcludeTag NOTIFY pbsExcludeTagChanged)
     Q_PROPERTY(QString pbsExcludeVmids READ pbsExcludeVmids WRITE setPbsExcludeVmids NOTIFY pbsExcludeVmidsChanged)
+    // "all" | "whitelist" | "blacklist"
+    Q_PROPERTY(QString notifyMode READ notifyMode WRITE setNotifyMode NOTIFY notifyModeChanged)
+    Q_PROPERTY(QString notifyFilter READ notifyFilter WRITE setNotifyFilter NOTIFY notifyFilterChanged)
+    Q_PROPERTY(bool notifyOnStart READ notifyOnStart WRITE setNotifyOnStart NOTIFY notifyOnStartChanged)
+    Q_PROPERTY(bool notifyOnStop READ notifyOnStop WRITE setNotifyOnStop NOTIFY notifyOnStopChanged)
+    Q_PROPERTY(bool notifyOnNodeChange READ notifyOnNodeChange WRITE setNotifyOnNodeChange NOTIFY notifyOnNodeChangeChanged)
     Q_PROPERTY(bool debugEnabled READ debugEnabled WRITE setDebugEnabled NOTIFY debugEnabledChanged)
     Q_PROPERTY(bool ignoreSsl READ ignoreSsl WRITE setIgnoreSsl NOTIFY ignoreSslChanged)
     Q_PROPERTY(QVariantList debugLog READ debugLog NOTIFY debugLogChanged)
@@ -54,6 +66,10 @@ class ProxmoxController : public QObject {
     Q_PROPERTY(int retryNextDelayMs READ retryNextDelayMs NOTIFY retryNextDelayMsChanged)
     Q_PROPERTY(QString retryStatusText READ retryStatusText NOTIFY retryStatusTextChanged)
     Q_PROPERTY(QString pbsLastError READ pbsLastError NOTIFY pbsLastErrorChanged)
+    Q_PROPERTY(bool backupStatusStale READ backupStatusStale NOTIFY backupStatusStaleChanged)
+    // Completed / known PBS listing requests of the crawl in progress.
+    Q_PROPERTY(int pbsProgressDone READ pbsProgressDone NOTIFY pbsProgressChanged)
+    Q_PROPERTY(int pbsProgressTotal READ pbsProgressTotal NOTIFY pbsProgressChanged)
     Q_PROPERTY(QVariant displayedProxmoxData READ displayedProxmoxData NOTIFY displayedProxmoxDataChanged)
     Q_PROPERTY(QVariantList displayedVmData READ displayedVmData NOTIFY displayedVmDataChanged)
     Q_PROPERTY(QVariantList displayedLxcData READ displayedLxcData NOTIFY displayedLxcDataChanged)
@@ -61,6 +77,9 @@ class ProxmoxController : public QObject {
     Q_PROPERTY(QVariantList displayedNodeList READ displayedNodeList NOTIFY displayedNodeListChanged)
     Q_PROPERTY(int runningVMs READ runningVMs NOTIFY runningVMsChanged)
     Q_PROPERTY(int runningLXC READ runningLXC NOTIFY runningLXCChanged)
+    // Live VM screen thumbnails are only grabbed while this is set (bound
+    // to the popup being open).
+    Q_PROPERTY(bool thumbnailsActive READ thumbnailsActive WRITE setThumbnailsActive NOTIFY thumbnailsActiveChanged)
 
 public:
     explicit ProxmoxController(QObject *parent = nullptr);
@@ -119,10 +138,22 @@ public:
 
     int pbsRefreshInterval() const { return m_pbsRefreshInterval; }
     void setPbsRefreshInterval(int value);
+    int pbsMaxConcurrentRequests() const { return m_pbsMaxConcurrentRequests; }
+    void setPbsMaxConcurrentRequests(int value);
     QString pbsExcludeTag() const { return m_pbsExcludeTag; }
     void setPbsExcludeTag(const QString &value);
     QString pbsExcludeVmids() const { return m_pbsExcludeVmids; }
     void setPbsExcludeVmids(const QString &value);
+    QString notifyMode() const { return m_notifyMode; }
+    void setNotifyMode(const QString &value);
+    QString notifyFilter() const { return m_notifyFilter; }
+    void setNotifyFilter(const QString &value);
+    bool notifyOnStart() const { return m_notifyOnStart; }
+    void setNotifyOnStart(bool value);
+    bool notifyOnStop() const { return m_notifyOnStop; }
+    void setNotifyOnStop(bool value);
+    bool notifyOnNodeChange() const { return m_notifyOnNodeChange; }
+    void setNotifyOnNodeChange(bool value);
 
     bool ignoreSsl() const { return m_ignoreSsl; }
     void setIgnoreSsl(bool value);
@@ -150,6 +181,9 @@ public:
     int retryNextDelayMs() const { return m_retryNextDelayMs; }
     QString retryStatusText() const { return m_retryStatusText; }
     QString pbsLastError() const { return m_pbsRefreshError; }
+    bool backupStatusStale() const { return m_backupStatusStale; }
+    int pbsProgressDone() const { return m_pbsProgressDone; }
+    int pbsProgressTotal() const { return m_pbsProgressTotal; }
     QVariant displayedProxmoxData() const { return m_displayedProxmoxData; }
     QVariantList displayedVmData() const { return m_displayedVmData; }
     QVariantList displayedLxcData() const { return m_displayedLxcData; }
@@ -157,6 +191,8 @@ public:
     QVariantList displayedNodeList() const { return m_displayedNodeList; }
     int runningVMs() const;
     int runningLXC() const;
+    bool thumbnailsActive() const;
+    void setThumbnailsActive(bool value);
 
     Q_INVOKABLE void resolveSecretsIfNeeded();
     Q_INVOKABLE void listStoredKeys();
@@ -165,6 +201,10 @@ public:
     Q_INVOKABLE void storeMultiHostSecret(const QString &host, int port, const QString &tokenId, const QString &secret);
     Q_INVOKABLE void storeMultiHostPBSSecret(const QString &host, const QString &secret);
     Q_INVOKABLE void fetchData();
+    Q_INVOKABLE bool shouldNotify(const QString &name, int vmid) const;
+    // Forget recorded node/guest states; the next completed refresh only
+    // records a baseline and emits no transitions.
+    Q_INVOKABLE void resetTransitionBaseline();
     Q_INVOKABLE void cancelRefresh();
     Q_INVOKABLE bool runAction(const QString &sessionKey,
                                const QString &kind,
@@ -180,6 +220,20 @@ public:
                               const QString &node,
                               int vmid,
                               const QString &vmName);
+    // Console open timing. The controller records the credential and
+    // vncproxy stages itself; the console window reports "window",
+    // "websocket", "handshake" and finally "firstFrame", which logs the
+    // timeline and emits consoleOpenTimed().
+    Q_INVOKABLE void markConsoleStage(const QString &sessionKey,
+                                      const QString &kind,
+                                      const QString &node,
+                                      int vmid,
+                                      const QString &stage);
+    // Thumbnails for running qemu VMs the list shows. thumbnailUrl() is an
+    // image:// URL, or empty until the first frame arrived; it changes
+    // whenever thumbnailsChanged() is emitted.
+    Q_INVOKABLE void watchThumbnail(const QString &sessionKey, const QString &node, int vmid, bool watch);
+    Q_INVOKABLE QString thumbnailUrl(const QString &sessionKey, const QString &node, int vmid) const;
 
 signals:
     void connectionModeChanged();
@@ -200,8 +254,19 @@ signals:
     void pbsBackupWarningDaysChanged();
     void pbsBackupStaleDaysChanged();
     void pbsRefreshIntervalChanged();
+    void pbsMaxConcurrentRequestsChanged();
     void pbsExcludeTagChanged();
     void pbsExcludeVmidsChanged();
+    void notifyModeChanged();
+    void notifyFilterChanged();
+    void notifyOnStartChanged();
+    void notifyOnStopChanged();
+    void notifyOnNodeChangeChanged();
+    // One entry per node/guest whose status changed since the previous
+    // completed refresh: {type: "node"|"qemu"|"lxc", sessionKey, node, vmid,
+    // name, previous, current, notify}. notify already folds in the
+    // notifyOn* settings and the notification filter.
+    void stateTransitions(const QVariantList &transitions);
     void debugEnabledChanged();
     void ignoreSslChanged();
     void debugLogChanged();
@@ -223,6 +288,8 @@ signals:
     void retryNextDelayMsChanged();
     void retryStatusTextChanged();
     void pbsLastErrorChanged();
+    void backupStatusStaleChanged();
+    void pbsProgressChanged();
     void displayedProxmoxDataChanged();
     void displayedVmDataChanged();
     void displayedLxcDataChanged();
@@ -230,6 +297,8 @@ signals:
     void displayedNodeListChanged();
     void runningVMsChanged();
     void runningLXCChanged();
+    void thumbnailsActiveChanged();
+    void thumbnailsChanged();
     void restoreSingleConfigRequested(const QString &host, int port, const QString &tokenId);
     void restoreMultiHostConfigRequested(const QString &multiHostsJson);
     void keyListError(const QString &message);
@@ -246,6 +315,17 @@ signals:
                      const QString &action,
                      const QString &message);
 
+    // A VNC console was requested and its vncproxy ticket is on the way:
+    // the window and its transport can be built now, consoleReady() then
+    // only has to start them.
+    void consoleOpening(const QString &sessionKey,
+                        const QString &host,
+                        const QString &node,
+                        const QString &kind,
+                        int vmid,
+                        const QString &vmName,
+                        int apiPort,
+                        bool ignoreSsl);
     void consoleReady(const QString &sessionKey,
                   const QString &host,
                   const QString &node,
@@ -271,6 +351,12 @@ signals:
                   const QString &kind,
                   int vmid,
                   const QString &message);
+    // Stage name -> ms since openConsole(), plus "cachedSecret".
+    void consoleOpenTimed(const QString &sessionKey,
+                          const QString &kind,
+                          const QString &node,
+                          int vmid,
+                          const QVariantMap &timeline);
 
 private:
     void setSecretState(const QString &value);
@@ -324,6 +410,10 @@ private:
                                        const QString &secret);
     void readSingleSecretFor(const QVariantMap &request);
     void readMultiSecretFor(const QVariantMap &request);
+    void dispatchSingleConsoleWithSecret(const QVariantMap &request, const QString &secret);
+    void dispatchSingleThumbnailWithSecret(const QString &node, int vmid, const QString &secret);
+    QString cachedSingleSecret() const;
+    void requestThumbnailTicket(const QString &sessionKey, const QString &node, int vmid);
     QVariantMap ensureEndpointBucket(const QString &sessionKey);
     QVariantList bucketsToArray(const QVariantMap &map) const;
     void handleSingleReply(int seq, const QString &kind, const QString &node, const QVariant &data);
@@ -335,10 +425,60 @@ private:
     QVariantMap endpointBySession(const QString &sessionKey) const;
     void refreshPBS();
     void refreshPBSNow();
-    void applyBackupState(QVariantList &items, const QVariantMap &endpointMap, bool isLxc, bool &anyChanged);
+    // Per-session PBS settings resolved once per pass instead of per row.
+    struct BackupPolicy {
+        bool enabled = false;
+        QString pbsHost;
+        int warningDays = 7;
+        int staleDays = 14;
+    };
+    struct BackupRowState {
+        BackupStatus status = BackupStatus::Unknown;
+        qint64 backupTime = 0;
+        QString display;
+        QString verifyState;
+        bool stale = false;
+    };
+    struct BackupRowRef {
+        bool lxc = false;
+        int row = 0;
+    };
+    // Status of one node (vmid 0) or guest, namespaced by session so equal
+    // node names / vmids on different endpoints don't collide.
+    struct StateKey {
+        QString sessionKey;
+        QString node;
+        QString kind; // "node" | "qemu" | "lxc"
+        int vmid = 0;
+
+        bool operator==(const StateKey &other) const {
+            return vmid == other.vmid && kind == other.kind && node == other.node && sessionKey == other.sessionKey;
+        }
+        friend size_t qHash(const StateKey &key, size_t seed = 0) {
+            return qHashMulti(seed, key.sessionKey, key.node, key.kind, key.vmid);
+        }
+    };
+    void detectStateTransitions();
+    void rebuildBackupPolicies();
+    void rebuildBackupIndex();
+    BackupRowState backupStateFor(const QVariantMap &item, bool isLxc) const;
+    bool writeBackupState(QVariantMap &item, const BackupRowState &state) const;
+    void applyBackupState(QVariantList &items, bool isLxc) const;
+    bool updateBackupRow(bool isLxc, int row);
+    void publishBackupRows(const QList<int> &vmRows, const QList<int> &lxcRows);
+    void correlateBackupKeys(const QSet<BackupKey> &keys);
     BackupStatus evaluateBackupStatus(qint64 lastBackupTime, int warningDays, int staleDays) const;
     QString lastBackupDisplay(qint64 backupTime) const;
     void correlateBackups();
+    void startPBSCrawl(const QString &pbsHost,
+                       int pbsPort,
+                       const QString &pbsTokenId,
+                       const QString &secret,
+                       bool pbsIgnoreSsl,
+                       int maxConcurrent);
+    void failPBSSecretRead(const QString &pbsHost, const QString &message);
+    void maybeFinishPBSRefresh();
+    void finishPBSRefresh();
     QString pbsKeyForHost(const QString &host) const;
     QString normalizedHost(const QString &host) const;
     QString resolvedHostFingerprint(const QString &host) const;
@@ -366,8 +506,19 @@ private:
     int m_pbsBackupWarningDays = 7;
     int m_pbsBackupStaleDays = 14;
     int m_pbsRefreshInterval = 0;
+    int m_pbsMaxConcurrentRequests = ProxmoxConst::Defaults::PbsMaxConcurrentRequests;
     QString m_pbsExcludeTag;
     QString m_pbsExcludeVmids;
+    // Compiled from m_pbsExcludeVmids / m_pbsExcludeTag on change.
+    FilterRules m_backupExclusionRules;
+    QString m_notifyMode = QStringLiteral("all");
+    QString m_notifyFilter;
+    FilterRules m_notifyRules;
+    bool m_notifyOnStart = true;
+    bool m_notifyOnStop = true;
+    bool m_notifyOnNodeChange = true;
+    QHash<StateKey, QString> m_previousStates;
+    bool m_transitionBaselineRecorded = false;
     QString m_activeSingleSecretKey;
     bool m_debugEnabled = false;
     bool m_ignoreSsl = false;
@@ -394,7 +545,6 @@ private:
     int m_retryNextDelayMs = 0;
     QString m_retryStatusText;
     QString m_pbsRefreshError;
-    int m_pendingPbsEndpoints = 0;
     QVariant m_proxmoxData;
     QVariantList m_vmData;
     QVariantList m_lxcData;
@@ -403,6 +553,16 @@ private:
     // MultiSecretFor's "console" branches; drained in the ttyProxyReady/
     // vncProxyReady lambdas. Bounded by in-flight console requests.
     QHash<QString, QString> m_pendingConsoleNames;
+    // VNC console opens in flight, keyed "sessionKey/kind:node:vmid".
+    // Dropped on the first frame or a consoleError; a reopen replaces its
+    // entry, so this is bounded by the guests with a console window.
+    struct ConsoleOpenTrace {
+        qint64 startMs = 0;             // on m_consoleClock
+        bool cachedSecret = false;
+        QVariantMap stages;             // stage -> ms since startMs
+    };
+    QHash<QString, ConsoleOpenTrace> m_consoleTraces;
+    QElapsedTimer m_consoleClock;
     QVariant m_displayedProxmoxData;
     QVariantList m_displayedVmData;
     QVariantList m_displayedLxcData;
@@ -414,13 +574,44 @@ private:
     QVariantList m_tempLxcData;
     int m_refreshSeq = 0;
     QVariantMap m_tempEndpointsData;
-    QHash<QString, PBSSnapshot> m_latestBackups;
+    QHash<BackupKey, PBSSnapshot> m_latestBackups;
+    // Results of the crawl in progress; merged into m_latestBackups by
+    // finishPBSRefresh() so a refresh never blanks the visible state.
+    QHash<BackupKey, PBSSnapshot> m_pbsRefreshBackups;
+    QSet<QString> m_pbsRefreshHostsOk;
+    QSet<QString> m_pbsRefreshHostsFailed;
+    QSet<QString> m_pbsConfiguredHosts;
+    // Hosts whose entries came from the on-disk cache or a failed crawl.
+    QSet<QString> m_staleBackupHosts;
+    bool m_backupStatusStale = false;
+    QString m_backupCachePath;
+    QHash<QString, BackupPolicy> m_backupPolicies;
+    bool m_backupPoliciesDirty = true;
+    // vmid -> rows in m_displayedVmData / m_displayedLxcData, rebuilt lazily
+    // after the lists are replaced by a refresh.
+    QMultiHash<int, BackupRowRef> m_backupRowsByVmid;
+    bool m_backupIndexDirty = true;
     QTimer *m_pbsTimer = nullptr;
     QTimer *m_pbsDebounceTimer = nullptr;
-    int m_pendingPbsSnapshotRequests = 0;
+    struct PbsCrawlState {
+        QString host; // normalized
+        int done = 0;
+        int total = 0;
+    };
+    // crawl id (from ProxmoxClient::fetchPBSDatastores) -> progress
+    QHash<int, PbsCrawlState> m_pbsActiveCrawls;
+    int m_pendingPbsSecretReads = 0;
+    // Bumped per refreshPBSNow(); keychain replies from an older pass are ignored.
+    int m_pbsRefreshGeneration = 0;
+    int m_pbsProgressDone = 0;
+    int m_pbsProgressTotal = 0;
     QHash<QString, QByteArray> m_pendingConsoleAuth;
     QMap<QString, QByteArray>  m_pendingConsoleTicket;
+    // vncproxy requests made for thumbnails, "sessionKey/node/vmid"; their
+    // replies go to m_thumbnails instead of consoleReady.
+    QSet<QString> m_pendingThumbnailTickets;
     ProxmoxClient *m_api;
     SecretStore *m_singleSecretStore;
     SecretStore *m_multiSecretStore;
+    VncThumbnailService *m_thumbnails;
 };
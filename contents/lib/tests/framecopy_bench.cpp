@@ -0,0 +1,135 @@
+// CPU cost of getting one server update from the RFB framebuffer to the
+// memory the texture upload reads:
+//   before  before the framebuffer format matched the texture: each damaged
+//           rect became a new QImage through convertToFormat(ARGB32_
+//           Premultiplied), which from Format_RGB32 is Qt's
+//           mask_alpha_converter (dst = src | 0xff000000), and the view
+//           blitted it into its retained frame.
+//   matched the same with the alpha fix fused into the patch copy.
+//   now     the current tree: pixelKernels().copyOpaque into the frame
+//           exchange's back buffer. "best" is damage that repeats (or a
+//           full frame), where the triple buffer's stale region adds
+//           nothing; "worst" is damage that moves every update, where the
+//           back buffer also catches up on the two updates it missed.
+// The GPU transfer and the blending the opaque texture saves are not
+// measured. Usage: framecopy_bench [iterations]
+#include "pixelkernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+static constexpr int kWidth  = 1920;
+static constexpr int kHeight = 1080;
+
+struct Rect { int x, y, w, h; };
+
+using Clock = std::chrono::steady_clock;
+
+// Qt's mask_alpha_converter, compiled the way the old path ran it.
+__attribute__((noinline))
+static void maskAlpha(uint32_t *dst, const uint32_t *src, int n)
+{
+    for (int i = 0; i < n; ++i)
+        dst[i] = src[i] | 0xff000000u;
+}
+
+static uint32_t g_sink = 0;
+
+// copyFramePatch's loop once the format matched. The same instructions
+// as maskAlpha: the match removed no per-pixel work.
+__attribute__((noinline))
+static void fusedCopy(uint32_t *dst, const uint32_t *src, int n)
+{
+    for (int i = 0; i < n; ++i)
+        dst[i] = src[i] | 0xff000000u;
+}
+
+template <typename Convert>
+static void patchAndBlit(const std::vector<uint32_t> &fb, std::vector<uint32_t> &retained,
+                         const std::vector<Rect> &rects, Convert convert)
+{
+    for (const Rect &r : rects) {
+        auto *patch = static_cast<uint32_t *>(std::malloc(size_t(r.w) * r.h * 4));
+        for (int row = 0; row < r.h; ++row)
+            convert(patch + size_t(row) * r.w, fb.data() + size_t(r.y + row) * kWidth + r.x, r.w);
+        for (int row = 0; row < r.h; ++row) {
+            std::copy_n(patch + size_t(row) * r.w, r.w,
+                        retained.data() + size_t(r.y + row) * kWidth + r.x);
+        }
+        std::free(patch);
+    }
+    g_sink += retained[size_t(kWidth) * kHeight - 1];
+}
+
+static void exchangeCopy(const std::vector<uint32_t> &fb, std::vector<uint32_t> &back,
+                         const std::vector<Rect> &rects, int passes)
+{
+    const auto copyOpaque = pixelKernels().copyOpaque;
+    for (int pass = 0; pass < passes; ++pass) {
+        for (const Rect &r : rects) {
+            // Each pass shifts the rects, standing in for an earlier update.
+            const int x = (r.x + pass * 97) % (kWidth - r.w + 1);
+            const int y = (r.y + pass * 53) % (kHeight - r.h + 1);
+            for (int row = 0; row < r.h; ++row) {
+                const size_t offset = size_t(y + row) * kWidth + x;
+                copyOpaque(back.data() + offset, fb.data() + offset, r.w);
+            }
+        }
+    }
+    g_sink += back[size_t(kWidth) * kHeight - 1];
+}
+
+template <typename Fn>
+static double bestUs(int iterations, Fn &&run)
+{
+    double best = 0;
+    for (int attempt = 0; attempt < 3; ++attempt) {
+        const auto start = Clock::now();
+        for (int i = 0; i < iterations; ++i)
+            run();
+        const double us = double(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     Clock::now() - start).count()) / 1000.0 / iterations;
+        if (attempt == 0 || us < best)
+            best = us;
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    const int iterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : 200;
+
+    std::mt19937 rng(2);
+    std::vector<uint32_t> fb(size_t(kWidth) * kHeight), back(fb.size());
+    for (uint32_t &p : fb)
+        p = rng() & 0x00ffffffu;   // servers send the padding byte as 0
+
+    // Typical update shapes: a full repaint, a window-sized region, a
+    // scatter of 64x64 tiles (tight/hextile) and a text cursor blink.
+    std::vector<std::pair<const char *, std::vector<Rect>>> scenarios;
+    scenarios.push_back({ "full frame 1920x1080", { { 0, 0, kWidth, kHeight } } });
+    scenarios.push_back({ "window 800x600", { { 560, 240, 800, 600 } } });
+    std::vector<Rect> tiles;
+    for (int i = 0; i < 64; ++i)
+        tiles.push_back({ int(rng() % (kWidth - 64)), int(rng() % (kHeight - 64)), 64, 64 });
+    scenarios.push_back({ "64 tiles of 64x64", tiles });
+    scenarios.push_back({ "cursor blink 9x18", { { 700, 500, 9, 18 } } });
+
+    std::printf("%d iterations, best of 3, kernels: %s\n\n", iterations, pixelKernels().isa);
+    std::printf("%-22s %10s %10s %10s %10s\n", "update (us)", "before", "matched", "now best", "now worst");
+    for (const auto &s : scenarios) {
+        const double b = bestUs(iterations, [&]() { patchAndBlit(fb, back, s.second, maskAlpha); });
+        const double m = bestUs(iterations, [&]() { patchAndBlit(fb, back, s.second, fusedCopy); });
+        const bool fullFrame = s.second.size() == 1 && s.second.front().w == kWidth
+                               && s.second.front().h == kHeight;
+        const double nb = bestUs(iterations, [&]() { exchangeCopy(fb, back, s.second, 1); });
+        const double nw = fullFrame ? nb
+                                    : bestUs(iterations, [&]() { exchangeCopy(fb, back, s.second, 3); });
+        std::printf("%-22s %10.2f %10.2f %10.2f %10.2f\n", s.first, b, m, nb, nw);
+    }
+    return g_sink == 0x12345678u ? 2 : 0;
+}
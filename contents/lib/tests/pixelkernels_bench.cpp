@@ -0,0 +1,85 @@
+// Throughput of every supported pixel kernel on 1920x1080 frames, relative
+// to the scalar reference. Usage: pixelkernels_bench [frames]
+#include "pixelkernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+static constexpr int kWidth  = 1920;
+static constexpr int kHeight = 1080;
+
+using Clock = std::chrono::steady_clock;
+
+// Best of three runs of `frames` full frames, in ns per output pixel.
+template <typename Fn>
+static double bestNsPerPixel(int frames, int pixelsPerFrame, Fn &&run)
+{
+    double best = 0;
+    for (int attempt = 0; attempt < 3; ++attempt) {
+        const auto start = Clock::now();
+        for (int f = 0; f < frames; ++f)
+            run();
+        const double ns = double(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     Clock::now() - start).count());
+        const double perPixel = ns / (double(frames) * pixelsPerFrame);
+        if (attempt == 0 || perPixel < best)
+            best = perPixel;
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    const int frames = argc > 1 ? std::max(1, std::atoi(argv[1])) : 50;
+
+    std::mt19937 rng(1);
+    std::vector<uint32_t> src(size_t(kWidth) * kHeight), dst(src.size());
+    std::vector<uint16_t> src565(src.size());
+    for (size_t i = 0; i < src.size(); ++i) {
+        src[i] = rng();
+        src565[i] = uint16_t(rng());
+    }
+
+    const std::vector<const PixelKernels *> variants = supportedPixelKernels();
+    std::printf("%d frames of %dx%d, best of 3, ns/pixel (speedup vs scalar)\n\n",
+                frames, kWidth, kHeight);
+    std::printf("%-8s %18s %18s %18s %18s\n", "isa", "copyOpaque", "expand565", "swizzleRB", "downscale2x");
+
+    double scalar[4] = {};
+    for (const PixelKernels *k : variants) {
+        double ns[4];
+        ns[0] = bestNsPerPixel(frames, kWidth * kHeight, [&]() {
+            for (int y = 0; y < kHeight; ++y)
+                k->copyOpaque(dst.data() + size_t(y) * kWidth, src.data() + size_t(y) * kWidth, kWidth);
+        });
+        ns[1] = bestNsPerPixel(frames, kWidth * kHeight, [&]() {
+            for (int y = 0; y < kHeight; ++y)
+                k->expand565(dst.data() + size_t(y) * kWidth, src565.data() + size_t(y) * kWidth, kWidth);
+        });
+        ns[2] = bestNsPerPixel(frames, kWidth * kHeight, [&]() {
+            for (int y = 0; y < kHeight; ++y)
+                k->swizzleRB(dst.data() + size_t(y) * kWidth, src.data() + size_t(y) * kWidth, kWidth);
+        });
+        // Output is a quarter of the frame: per output pixel.
+        ns[3] = bestNsPerPixel(frames, (kWidth / 2) * (kHeight / 2), [&]() {
+            for (int y = 0; y + 1 < kHeight; y += 2) {
+                k->downscale2x(dst.data() + size_t(y / 2) * (kWidth / 2),
+                               src.data() + size_t(y) * kWidth,
+                               src.data() + size_t(y + 1) * kWidth, kWidth / 2);
+            }
+        });
+        if (k == variants.front()) {
+            for (int i = 0; i < 4; ++i) scalar[i] = ns[i];
+        }
+        std::printf("%-8s", k->isa);
+        for (int i = 0; i < 4; ++i)
+            std::printf("   %7.3f (%5.1fx)", ns[i], scalar[i] / ns[i]);
+        std::printf("\n");
+    }
+    // Keep the stores observable.
+    return dst[size_t(rng()) % dst.size()] == 0x12345678u ? 2 : 0;
+}
@@ -0,0 +1,120 @@
+// Checks every pixel kernel the CPU supports against the scalar reference:
+// all widths up to a few vector lengths (odd widths and partial tails),
+// source and destination offset off vector alignment, and no write past n.
+#include "pixelkernels.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+static constexpr int      kMaxWidth  = 131;   // > 4 AVX2 vectors plus a tail
+static constexpr int      kMaxOffset = 7;     // element offsets off 32-byte alignment
+static constexpr int      kGuard     = 8;     // canary pixels after dst[n - 1]
+static constexpr uint32_t kCanary    = 0xdeadbeefu;
+
+static int g_failures = 0;
+
+static void fail(const char *isa, const char *kernel, int n, int offset, int index,
+                 uint32_t got, uint32_t want)
+{
+    if (++g_failures <= 20) {
+        std::fprintf(stderr, "FAIL %s %s n=%d offset=%d [%d]: got %08x want %08x\n",
+                     isa, kernel, n, offset, index, got, want);
+    }
+}
+
+// Compares dst[offset, offset + n) with the reference and checks the guard.
+static void compare(const char *isa, const char *kernel, int n, int offset,
+                    const std::vector<uint32_t> &got, const std::vector<uint32_t> &want)
+{
+    for (int i = 0; i < n; ++i) {
+        if (got[offset + i] != want[i])
+            fail(isa, kernel, n, offset, i, got[offset + i], want[i]);
+    }
+    for (int i = 0; i < kGuard; ++i) {
+        if (got[offset + n + i] != kCanary)
+            fail(isa, kernel, n, offset, n + i, got[offset + n + i], kCanary);
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(0x50524f58u);   // fixed seed: failures reproduce
+    const size_t span = size_t(kMaxOffset + 2 * kMaxWidth + kGuard);
+    std::vector<uint32_t> row0(span), row1(span);
+    std::vector<uint16_t> row565(span);
+    for (size_t i = 0; i < span; ++i) {
+        row0[i] = rng();
+        row1[i] = rng();
+        row565[i] = uint16_t(rng());
+    }
+    // Channel extremes, where rounding and bit replication go wrong first.
+    row0[kMaxOffset] = 0x00000000u;
+    row0[kMaxOffset + 1] = 0xffffffffu;
+    row1[kMaxOffset] = 0xffffffffu;
+    row1[kMaxOffset + 1] = 0x01010101u;
+    row565[kMaxOffset] = 0xffff;
+    row565[kMaxOffset + 1] = 0x0000;
+
+    const PixelKernels &ref = scalarPixelKernels();
+    const std::vector<const PixelKernels *> variants = supportedPixelKernels();
+
+    std::vector<uint32_t> want(static_cast<size_t>(kMaxWidth));
+    std::vector<uint32_t> got(span);
+    int checked = 0;
+    for (const PixelKernels *k : variants) {
+        std::printf("checking %s\n", k->isa);
+        for (int offset = 0; offset <= kMaxOffset; ++offset) {
+            for (int n = 0; n <= kMaxWidth; ++n) {
+                // Sources start at a different misalignment than dst.
+                const int srcOffset = kMaxOffset - offset;
+                const uint32_t *src   = row0.data() + srcOffset;
+                const uint32_t *src1  = row1.data() + srcOffset;
+                const uint16_t *src16 = row565.data() + srcOffset;
+                uint32_t *dst = got.data() + offset;
+
+                std::fill(got.begin(), got.end(), kCanary);
+                ref.copyOpaque(want.data(), src, n);
+                k->copyOpaque(dst, src, n);
+                compare(k->isa, "copyOpaque", n, offset, got, want);
+
+                std::fill(got.begin(), got.end(), kCanary);
+                ref.expand565(want.data(), src16, n);
+                k->expand565(dst, src16, n);
+                compare(k->isa, "expand565", n, offset, got, want);
+
+                std::fill(got.begin(), got.end(), kCanary);
+                ref.swizzleRB(want.data(), src, n);
+                k->swizzleRB(dst, src, n);
+                compare(k->isa, "swizzleRB", n, offset, got, want);
+
+                // 2n source pixels per row; the span covers kMaxWidth.
+                std::fill(got.begin(), got.end(), kCanary);
+                ref.downscale2x(want.data(), src, src1, n);
+                k->downscale2x(dst, src, src1, n);
+                compare(k->isa, "downscale2x", n, offset, got, want);
+                checked += 4;
+            }
+        }
+    }
+
+    // A few fixed points of the reference itself, so a wrong scalar kernel
+    // can't make everything agree.
+    uint32_t out = 0;
+    const uint16_t white565 = 0xffff;
+    ref.expand565(&out, &white565, 1);
+    if (out != 0xffffffffu) fail("scalar", "expand565 white", 1, 0, 0, out, 0xffffffffu);
+    const uint32_t bgra = 0x11223344u;
+    ref.swizzleRB(&out, &bgra, 1);
+    if (out != 0x11443322u) fail("scalar", "swizzleRB", 1, 0, 0, out, 0x11443322u);
+    const uint32_t box0[2] = { 0x00000000u, 0x00000001u };
+    const uint32_t box1[2] = { 0x00000001u, 0x00000001u };
+    ref.downscale2x(&out, box0, box1, 1);
+    if (out != 0x00000001u) fail("scalar", "downscale2x rounding", 1, 0, 0, out, 0x00000001u);
+
+    std::printf("%d kernel runs across %zu variants, %d failures\n",
+                checked, variants.size(), g_failures);
+    return g_failures == 0 ? 0 : 1;
+}
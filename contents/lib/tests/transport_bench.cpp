@@ -0,0 +1,189 @@
+// The local hop between VncWsProxy and libvncclient, old bridge vs new:
+//   tcp         the old bridge: a listening socket on 127.0.0.1, connect,
+//               accept, TCP_NODELAY on both ends (as QTcpServer/QTcpSocket
+//               and libvncclient did).
+//   socketpair  AF_UNIX SOCK_STREAM socketpair, as VncWsProxy::start() now
+//               creates it.
+// Reported per transport: setup time up to a connected pair, round trip of
+// a small message (an input event and its reply), one-way time of a 64 KiB
+// update, and bulk throughput. Threads stand in for the I/O thread and the
+// session thread. Usage: transport_bench [round trips]
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double usSince(Clock::time_point start)
+{
+    return double(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count()) / 1000.0;
+}
+
+static bool writeAll(int fd, const char *data, size_t n)
+{
+    while (n > 0) {
+        const ssize_t w = ::write(fd, data, n);
+        if (w <= 0) return false;
+        data += w;
+        n -= size_t(w);
+    }
+    return true;
+}
+
+static bool readAll(int fd, char *data, size_t n)
+{
+    while (n > 0) {
+        const ssize_t r = ::read(fd, data, n);
+        if (r <= 0) return false;
+        data += r;
+        n -= size_t(r);
+    }
+    return true;
+}
+
+static bool tcpPair(int fds[2])
+{
+    const int listener = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (listener < 0
+        || ::bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0
+        || ::listen(listener, 1) != 0
+        || ::getsockname(listener, reinterpret_cast<sockaddr *>(&addr), &len) != 0) {
+        if (listener >= 0) ::close(listener);
+        return false;
+    }
+    fds[1] = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fds[1] < 0 || ::connect(fds[1], reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+        ::close(listener);
+        return false;
+    }
+    fds[0] = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+    ::close(listener);
+    const int one = 1;
+    ::setsockopt(fds[0], IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    ::setsockopt(fds[1], IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fds[0] >= 0;
+}
+
+static bool unixPair(int fds[2])
+{
+    return ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == 0;
+}
+
+struct Result {
+    double setupUs;
+    double smallRttUs;
+    double updateUs;
+    double mbPerSec;
+};
+
+static double median(std::vector<double> v)
+{
+    std::sort(v.begin(), v.end());
+    return v[v.size() / 2];
+}
+
+static Result measure(bool (*makePair)(int[2]), int roundTrips)
+{
+    Result result {};
+
+    std::vector<double> setups;
+    for (int i = 0; i < 200; ++i) {
+        int fds[2];
+        const auto start = Clock::now();
+        if (!makePair(fds)) {
+            std::fprintf(stderr, "pair setup failed: %s\n", std::strerror(errno));
+            std::exit(1);
+        }
+        setups.push_back(usSince(start));
+        ::close(fds[0]);
+        ::close(fds[1]);
+    }
+    result.setupUs = median(setups);
+
+    int fds[2];
+    makePair(fds);
+    // fds[0]: proxy end, fds[1]: libvncclient end.
+    static constexpr size_t kSmall  = 10;          // a pointer event
+    static constexpr size_t kUpdate = 64 * 1024;   // a tight-encoded update
+    static constexpr size_t kBulk   = 256u << 20;
+
+    // Echo peer: answers each small message, acknowledges each update with
+    // one byte, then drains the bulk transfer.
+    std::thread peer([&]() {
+        std::vector<char> buf(kUpdate);
+        for (int i = 0; i < roundTrips; ++i) {
+            readAll(fds[1], buf.data(), kSmall);
+            writeAll(fds[1], buf.data(), kSmall);
+        }
+        for (int i = 0; i < roundTrips; ++i) {
+            readAll(fds[1], buf.data(), kUpdate);
+            writeAll(fds[1], buf.data(), 1);
+        }
+        for (size_t left = kBulk; left > 0;) {
+            const size_t n = std::min(left, buf.size());
+            readAll(fds[1], buf.data(), n);
+            left -= n;
+        }
+        writeAll(fds[1], buf.data(), 1);
+    });
+
+    std::vector<char> buf(kUpdate, 'x');
+    std::vector<double> rtts;
+    for (int i = 0; i < roundTrips; ++i) {
+        const auto start = Clock::now();
+        writeAll(fds[0], buf.data(), kSmall);
+        readAll(fds[0], buf.data(), kSmall);
+        rtts.push_back(usSince(start));
+    }
+    result.smallRttUs = median(rtts);
+
+    std::vector<double> updates;
+    for (int i = 0; i < roundTrips; ++i) {
+        const auto start = Clock::now();
+        writeAll(fds[0], buf.data(), kUpdate);
+        readAll(fds[0], buf.data(), 1);
+        updates.push_back(usSince(start));
+    }
+    result.updateUs = median(updates);
+
+    const auto start = Clock::now();
+    for (size_t left = kBulk; left > 0;) {
+        const size_t n = std::min(left, buf.size());
+        writeAll(fds[0], buf.data(), n);
+        left -= n;
+    }
+    readAll(fds[0], buf.data(), 1);
+    result.mbPerSec = double(kBulk) / (1024.0 * 1024.0) / (usSince(start) / 1e6);
+
+    peer.join();
+    ::close(fds[0]);
+    ::close(fds[1]);
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    const int roundTrips = argc > 1 ? std::max(1, std::atoi(argv[1])) : 5000;
+    std::printf("%d round trips per row, medians\n\n", roundTrips);
+    std::printf("%-12s %10s %14s %16s %12s\n", "transport", "setup us", "10 B rtt us", "64 KiB+ack us", "bulk MiB/s");
+    const Result tcp = measure(tcpPair, roundTrips);
+    std::printf("%-12s %10.1f %14.1f %16.1f %12.0f\n", "tcp", tcp.setupUs, tcp.smallRttUs, tcp.updateUs, tcp.mbPerSec);
+    const Result unx = measure(unixPair, roundTrips);
+    std::printf("%-12s %10.1f %14.1f %16.1f %12.0f\n", "socketpair", unx.setupUs, unx.smallRttUs, unx.updateUs, unx.mbPerSec);
+    return 0;
+}
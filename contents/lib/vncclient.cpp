@@ -3,8 +3,56 @@
 
 #include <rfb/rfbclient.h>
 #include <string.h> // explicit_bzero
+#include <cerrno>
+#include <iterator>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 #include <QCoreApplication>
 #include <QDebug>
+#include <QtEndian>
+#include <mutex>
+
+// Encoding profiles. lan trades bandwidth for CPU (no JPEG, light zlib);
+// wan is the previous fixed setup with explicit tight levels; slow squeezes
+// harder and drops JPEG quality for VPNs and long-haul links.
+struct EncodingProfile {
+    const char *name;
+    const char *encodings;
+    int compressLevel;
+    int qualityLevel;
+};
+static constexpr EncodingProfile kEncodingProfiles[] = {
+    { "lan",  "hextile zrle raw",       1, 9 },
+    { "wan",  "tight zrle hextile raw", 6, 6 },
+    { "slow", "tight zrle hextile raw", 9, 3 },
+};
+static constexpr int kProfileLan  = 0;
+static constexpr int kProfileWan  = 1;
+static constexpr int kProfileSlow = 2;
+
+// Link thresholds for "auto". Throughput is demand-limited: it shows the
+// link carries at least that much, never that it can't carry more, so it
+// only holds back lan. Slow is decided by RTT, which also rises when a
+// saturated link queues the ping behind updates.
+static constexpr int kLanMaxRttMs      = 5;
+static constexpr int kLanMinKbps       = 50'000;
+static constexpr int kSlowMinRttMs     = 150;
+// Server messages handled per turn once libvncclient's own buffer is
+// empty, so queued input is forwarded between messages of a busy stream.
+static constexpr int kMaxMessagesPerTurn = 8;
+// Consecutive agreeing samples before auto switches, so one slow ping
+// doesn't flip the encoding back and forth.
+static constexpr int kProfileSwitchVotes = 3;
+
+static int profileIndex(const QString &name)
+{
+    for (int i = 0; i < int(std::size(kEncodingProfiles)); ++i) {
+        if (name == QLatin1String(kEncodingProfiles[i].name))
+            return i;
+    }
+    return -1;
+}
 
 // Called by libvncclient when the server advertises a new framebuffer size.
 static rfbBool resizeCallback(rfbClient *client)
@@ -15,9 +63,16 @@ static rfbBool resizeCallback(rfbClient *client)
     int w = client->width;
     int h = client->height;
 
+    // 0x00RRGGBB little-endian words are B,G,R,X in memory: the byte order
+    // of QImage::Format_RGB32 and of a BGRA8 texture, so pixels go from
+    // here to the GPU without a format conversion. Only the padding byte
+    // differs (servers send 0) and is set by the frame exchange's copy.
     delete[] client->frameBuffer;
     client->frameBuffer = new uint8_t[w * h * 4];
     client->format.bitsPerPixel = 32;
+    client->format.depth        = 24;
+    client->format.trueColour   = TRUE;
+    client->format.bigEndian    = FALSE;
     client->format.redShift     = 16;
     client->format.greenShift   = 8;
     client->format.blueShift    = 0;
@@ -28,6 +83,8 @@ static rfbBool resizeCallback(rfbClient *client)
     // Request a full frame at the new dimensions immediately — without this
     // the server waits for the client to ask before sending any pixels.
     SendFramebufferUpdateRequest(client, 0, 0, w, h, FALSE);
+    self->updateContinuousUpdatesArea(client);
+    self->frameExchange().reset(QSize(w, h));
 
     QMetaObject::invokeMethod(self, [self, w, h]() {
         self->setFrameSize(w, h);
@@ -37,19 +94,127 @@ static rfbBool resizeCallback(rfbClient *client)
 }
 
 // Called when a dirty rect is received. A single HandleRFBServerMessage call
-// may fire this many times (once per tile). We just mark the frame dirty here;
-// the poll loop emits one coalesced signal after the full message is processed.
+// may fire this many times (once per tile). We just record the rect here;
+// serviceSession publishes the accumulated region after the full message is
+// processed.
 static void updateCallback(rfbClient *client, int x, int y, int w, int h)
 {
-    Q_UNUSED(x) Q_UNUSED(y) Q_UNUSED(w) Q_UNUSED(h)
     VncClient *self = static_cast<VncClient *>(rfbClientGetClientData(client, nullptr));
-    if (!self || !client->frameBuffer) return;
-    self->markFrameDirty();
+    if (!self || !client->frameBuffer || w <= 0 || h <= 0) return;
+    self->markFrameDirty(x, y, w, h);
+}
+
+// Cursor pseudo-encoding (RichCursor/XCursor). libvncclient decodes the
+// shape into rcSource (pixels in our 32bpp format) and rcMask (one byte per
+// pixel, non-zero = opaque). Shapes are rare, so the image is built here on
+// the worker and handed to the GUI thread whole.
+static void cursorShapeCallback(rfbClient *client, int xhot, int yhot, int width, int height, int bytesPerPixel)
+{
+    VncClient *self = static_cast<VncClient *>(rfbClientGetClientData(client, nullptr));
+    if (!self || !client->rcSource || !client->rcMask || bytesPerPixel != 4
+            || width <= 0 || height <= 0)
+        return;
+
+    QImage image(width, height, QImage::Format_ARGB32_Premultiplied);
+    const auto *src  = reinterpret_cast<const quint32 *>(client->rcSource);
+    const uint8_t *mask = client->rcMask;
+    for (int y = 0; y < height; ++y) {
+        auto *dst = reinterpret_cast<quint32 *>(image.scanLine(y));
+        for (int x = 0; x < width; ++x) {
+            const int i = y * width + x;
+            dst[x] = mask[i] ? (src[i] | 0xff000000u) : 0u;
+        }
+    }
+
+    QMetaObject::invokeMethod(self, [self, image, hot = QPoint(xhot, yhot)]() {
+        self->setCursorShape(image, hot);
+    }, Qt::QueuedConnection);
+}
+
+// PointerPos pseudo-encoding: the server moved the pointer itself (e.g. a
+// guest warping it). Keeps the local overlay where the guest thinks it is.
+static rfbBool cursorPosCallback(rfbClient *client, int x, int y)
+{
+    VncClient *self = static_cast<VncClient *>(rfbClientGetClientData(client, nullptr));
+    if (!self) return TRUE;
+    QMetaObject::invokeMethod(self, [self, x, y]() {
+        self->setCursorPosition(QPoint(x, y));
+    }, Qt::QueuedConnection);
+    return TRUE;
+}
+
+// ContinuousUpdates and Fence (RFB community extensions). libvncclient
+// has no built-in support, so they are registered as a protocol extension:
+// the pseudo-encodings are appended to SetEncodings, and the two server
+// messages are routed to handleServerMessage. Servers that don't know them
+// ignore the encodings and we stay on request/response updates.
+static constexpr int     kEncodingContinuousUpdates = -313;
+static constexpr int     kEncodingFence             = -312;
+static constexpr uint8_t kMsgEndOfContinuousUpdates = 150;  // S→C; C→S is EnableContinuousUpdates
+static constexpr uint8_t kMsgFence                  = 248;
+static constexpr quint32 kFenceBlockBefore = 1u << 0;
+static constexpr quint32 kFenceBlockAfter  = 1u << 1;
+static constexpr quint32 kFenceSyncNext    = 1u << 2;
+static constexpr quint32 kFenceRequest     = 1u << 31;
+
+static int s_extensionEncodings[] = { kEncodingContinuousUpdates, kEncodingFence, 0 };
+
+static rfbBool extensionHandleEncoding(rfbClient *, rfbFramebufferUpdateRectHeader *)
+{
+    return FALSE; // pseudo-encodings only; never carried by a rect
+}
+
+static rfbBool extensionHandleMessage(rfbClient *client, rfbServerToClientMsg *message)
+{
+    VncClient *self = static_cast<VncClient *>(rfbClientGetClientData(client, nullptr));
+    if (!self) {
+        // Not a console (a VncThumbnailService grab): the encodings were
+        // still advertised, so accept the payload-free end marker.
+        return message->type == kMsgEndOfContinuousUpdates ? TRUE : FALSE;
+    }
+    switch (message->type) {
+    case kMsgEndOfContinuousUpdates:
+        self->handleEndOfContinuousUpdates(client);
+        return TRUE;
+    case kMsgFence:
+        // FALSE on a short read or oversized payload: the stream is out of
+        // sync and HandleRFBServerMessage must fail.
+        return self->handleServerFence(client) ? TRUE : FALSE;
+    default:
+        return FALSE;
+    }
+}
+
+// The extension list is process-global in libvncclient; register once.
+static void registerRfbExtensions()
+{
+    static rfbClientProtocolExtension ext = [] {
+        rfbClientProtocolExtension e {};
+        e.encodings      = s_extensionEncodings;
+        e.handleEncoding = extensionHandleEncoding;
+        e.handleMessage  = extensionHandleMessage;
+        return e;
+    }();
+    static std::once_flag once;
+    std::call_once(once, [] { rfbClientRegisterExtension(&ext); });
+}
+
+static bool sendEnableContinuousUpdates(rfbClient *rfb, bool enable)
+{
+    char msg[10];
+    msg[0] = char(kMsgEndOfContinuousUpdates);
+    msg[1] = enable ? 1 : 0;
+    qToBigEndian<quint16>(0, msg + 2);
+    qToBigEndian<quint16>(0, msg + 4);
+    qToBigEndian<quint16>(quint16(rfb->width), msg + 6);
+    qToBigEndian<quint16>(quint16(rfb->height), msg + 8);
+    return WriteToRFBServer(rfb, msg, sizeof(msg));
 }
 
 VncClient::VncClient(QObject *parent)
     : QObject(parent)
 {
+    m_clock.start();
 }
 
 void VncClient::setTicketSecure(const QByteArray &ticket)
@@ -63,22 +228,46 @@ VncClient::~VncClient()
 }
 
 void VncClient::connectToVnc(const QString &host, int port)
+{
+    startSession(host, port, -1);
+}
+
+void VncClient::connectToSocket(int fd)
+{
+    if (fd < 0) return;
+    startSession(QStringLiteral("socketpair"), 0, fd);
+}
+
+// fd >= 0: a connected socket to use as rfb->sock. rfbInitClient skips its
+// own connect when sock is preset (libvncclient >= 0.9.12), and
+// rfbClientCleanup closes it with the session.
+void VncClient::startSession(const QString &host, int port, int fd)
 {
     if (m_rfb || m_thread)
         disconnect();
 
     setState(QStringLiteral("connecting"));
 
+    registerRfbExtensions();
+    m_continuousUpdates.store(false);
+    m_continuousUpdatesEnded = false;
+    m_inputPendingSinceNs = -1;
+    m_inputLatencyLastNs.store(-1, std::memory_order_relaxed);
+
     m_rfb = rfbGetClient(8, 3, 4); // 8 bits/sample, 3 samples/pixel, 4 bytes/pixel
     rfbClientSetClientData(m_rfb, nullptr, this);
 
     m_rfb->MallocFrameBuffer    = resizeCallback;
     m_rfb->GotFrameBufferUpdate = updateCallback;
+    m_rfb->GotCursorShape       = cursorShapeCallback;
+    m_rfb->HandleCursorPos      = cursorPosCallback;
     m_rfb->serverHost           = strdup(host.toUtf8().constData());
     m_rfb->serverPort           = port;
+    if (fd >= 0)
+        m_rfb->sock = fd;
 
     // Ticket stored in client-data slot 1; burned here after strdup.
-    // C-side copy is zeroed by the worker thread after handshake.
+    // C-side copy is zeroed by the handshake thread once rfbInitClient returns.
     m_rfb->GetPassword = [](rfbClient *client) -> char* {
         char *t = static_cast<char *>(rfbClientGetClientData(client, (void*)1));
         return t ? strdup(t) : strdup("");
@@ -87,10 +276,39 @@ void VncClient::connectToVnc(const QString &host, int port)
     m_ticket.fill(0);
     m_ticket.clear();
 
-    m_rfb->appData.encodingsString = "tight zrle hextile raw";
+    // Initial encodings go out with the handshake; later profile changes are
+    // re-sent by serviceSession.
+    m_appliedProfile = m_requestedProfile.load();
+    {
+        const EncodingProfile &p = kEncodingProfiles[m_appliedProfile];
+        m_rfb->appData.encodingsString = p.encodings;
+        m_rfb->appData.compressLevel   = p.compressLevel;
+        m_rfb->appData.qualityLevel    = p.qualityLevel;
+        m_rfb->appData.enableJPEG      = TRUE;
+    }
+    // Ask for the cursor pseudo-encodings so the server stops painting the
+    // pointer into the framebuffer; VncFrameView draws it as an overlay.
+    m_rfb->appData.useRemoteCursor = TRUE;
+
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeFd < 0) {
+        if (char *slot = static_cast<char *>(rfbClientGetClientData(m_rfb, (void*)1))) {
+            rfbClientSetClientData(m_rfb, (void*)1, nullptr);
+            explicit_bzero(slot, strlen(slot) + 1);
+            free(slot);
+        }
+        rfbClientCleanup(m_rfb);
+        m_rfb = nullptr;
+        setState(QStringLiteral("error"));
+        emit errorOccurred(QStringLiteral("Failed to create VNC worker wake-up descriptor"));
+        return;
+    }
 
-    // RFB session runs on a worker thread — rfbInitClient blocks on I/O.
-    // Qt-facing work is marshalled back via QueuedConnection. See docs/ARCHITECTURE.md.
+    // The session gets a thread of its own: rfbInitClient and
+    // HandleRFBServerMessage block on I/O until a whole message is in, and
+    // on a shared thread one slow server would stall every other console.
+    // Qt-facing work is marshalled back via QueuedConnection. See
+    // docs/ARCHITECTURE.md.
     m_running.store(true);
     m_thread = QThread::create([this]() {
         rfbClient *rfb = m_rfb;
@@ -130,85 +348,127 @@ void VncClient::connectToVnc(const QString &host, int port)
             setState(QStringLiteral("connected"));
         }, Qt::QueuedConnection);
 
-        // Release any modifier keys the server may think are held.
-        // Posted via the command queue so the writes stay on this thread
-        // alongside the poll loop — not on the main thread.
-        postCmd([](rfbClient *rfb) {
-            SendKeyEvent(rfb, 0xFFE1, FALSE); // Shift
-            SendKeyEvent(rfb, 0xFFE3, FALSE); // Ctrl
-            SendKeyEvent(rfb, 0xFFE9, FALSE); // Alt
-            SendKeyEvent(rfb, 0xFFE5, FALSE); // CapsLock
-        });
-
-        // Poll loop. WaitForMessage timeout is 16 ms so disconnect() is
-        // noticed within one interval.
-        while (m_running.load()) {
-            // Drain pending commands (key/pointer/resize) before waiting for
-            // server data. All rfbClient writes stay on this thread.
-            {
-                QQueue<std::function<void(rfbClient*)>> pending;
-                {
-                    QMutexLocker lk(&m_cmdMutex);
-                    pending.swap(m_cmdQueue);
-                }
-                for (auto &cmd : pending)
-                    cmd(rfb);
-            }
-
-            int result = WaitForMessage(rfb, 5'000); // µs — 5 ms keeps disconnect detection fast while reducing post-resize lag
-            if (!m_running.load()) break;
-            if (result < 0) {
-                QMetaObject::invokeMethod(this, [this]() {
-                    if (m_state != QStringLiteral("disconnected")) {
-                        setState(QStringLiteral("error"));
-                        emit errorOccurred(QStringLiteral("VNC connection error"));
-                    }
-                }, Qt::QueuedConnection);
+        // Release any modifier keys the server may think are held. We are
+        // already on the session thread, so write directly.
+        SendKeyEvent(rfb, 0xFFE1, FALSE); // Shift
+        SendKeyEvent(rfb, 0xFFE3, FALSE); // Ctrl
+        SendKeyEvent(rfb, 0xFFE9, FALSE); // Alt
+        SendKeyEvent(rfb, 0xFFE5, FALSE); // CapsLock
+
+        // Event loop. The thread blocks in poll() on the RFB socket and the
+        // wake eventfd, so an idle console costs no wakeups; postInput(),
+        // profile changes and disconnect() signal the eventfd.
+        while (serviceSession()) {
+            pollfd fds[2] = {
+                { rfb->sock, POLLIN, 0 },
+                { m_wakeFd,  POLLIN, 0 },
+            };
+            if (::poll(fds, 2, -1) < 0 && errno != EINTR) {
+                sessionFailed(QStringLiteral("VNC connection error"));
                 break;
             }
-            if (result > 0) {
-                if (!HandleRFBServerMessage(rfb)) {
-                    QMetaObject::invokeMethod(this, [this]() {
-                        if (m_state != QStringLiteral("disconnected")) {
-                            setState(QStringLiteral("error"));
-                            emit errorOccurred(QStringLiteral("Lost connection to VNC server"));
-                        }
-                    }, Qt::QueuedConnection);
-                    break;
-                }
-                // One coalesced frame signal per server message.
-                if (m_frameDirty.exchange(false, std::memory_order_relaxed)
-                        && rfb->frameBuffer) {
-                    QImage frame(rfb->frameBuffer,
-                                 rfb->width, rfb->height,
-                                 rfb->width * 4,
-                                 QImage::Format_RGB32);
-                    QMetaObject::invokeMethod(this,
-                        [this, img = frame.convertToFormat(QImage::Format_ARGB32_Premultiplied)]() {
-                            emit frameUpdated(img, 0, 0, img.width(), img.height());
-                        }, Qt::QueuedConnection);
-                }
-            }
+            // Socket readiness (or HUP/ERR) is picked up by WaitForMessage
+            // in the next turn, after input is drained.
         }
-
-        rfbClientCleanup(rfb);
-        m_rfb = nullptr;
     });
+    m_thread->setObjectName(QStringLiteral("VncClient session"));
     m_thread->start();
 }
 
+// Session thread. One turn: forward queued input, apply a pending profile
+// change, then handle the server messages that are ready. A message that
+// has only partly arrived blocks here until the rest does, which holds up
+// this console alone.
+bool VncClient::serviceSession()
+{
+    rfbClient *rfb = m_rfb;
+    if (!m_running.load() || !rfb) return false;
+
+    quint64 counter = 0;
+    ssize_t n = ::read(m_wakeFd, &counter, sizeof(counter));
+    Q_UNUSED(n)
+
+    // All rfbClient writes stay on this thread.
+    drainInput(rfb);
+
+    const int profile = m_requestedProfile.load();
+    if (profile != m_appliedProfile)
+        applyEncodingProfile(rfb, profile);
+
+    for (int handled = 0; m_running.load(); ++handled) {
+        // Bytes already in libvncclient's read buffer are invisible to
+        // poll(), so they are always handled. Fresh socket data yields
+        // after a few messages to forward input; the socket is still
+        // readable, so poll() returns at once.
+        int result = rfb->buffered > 0 ? 1
+                   : handled < kMaxMessagesPerTurn ? WaitForMessage(rfb, 0)
+                   : 0;
+        if (result == 0) break;
+        if (result < 0) {
+            sessionFailed(QStringLiteral("VNC connection error"));
+            return false;
+        }
+        // Includes waiting for the rest of a message that has only partly
+        // arrived: libvncclient reads as it parses.
+        const qint64 handleStart = m_clock.nsecsElapsed();
+        if (!HandleRFBServerMessage(rfb)) {
+            sessionFailed(QStringLiteral("Lost connection to VNC server"));
+            return false;
+        }
+        const qint64 handleEnd = m_clock.nsecsElapsed();
+        m_serverMessages.fetch_add(1, std::memory_order_relaxed);
+        m_handleNs.fetch_add(quint64(handleEnd - handleStart), std::memory_order_relaxed);
+        // Publish this server message's damage into the triple buffer.
+        // Only the first frame since the GUI last acquired posts a
+        // notification; later ones just replace it.
+        if (!m_pendingDamage.isEmpty() && rfb->frameBuffer) {
+            if (m_inputPendingSinceNs >= 0) {
+                const qint64 latency = handleEnd - m_inputPendingSinceNs;
+                m_inputLatencySamples.fetch_add(1, std::memory_order_relaxed);
+                m_inputLatencyNs.fetch_add(quint64(latency), std::memory_order_relaxed);
+                m_inputLatencyLastNs.store(latency, std::memory_order_relaxed);
+                m_inputPendingSinceNs = -1;
+            }
+            const bool notify = m_frames.publish(rfb->frameBuffer,
+                                                 qsizetype(rfb->width) * 4,
+                                                 m_pendingDamage);
+            m_pendingDamage = QRegion();
+            if (notify)
+                QMetaObject::invokeMethod(this, &VncClient::frameReady, Qt::QueuedConnection);
+        }
+    }
+    return true;
+}
+
+// Session thread. The session stays allocated until disconnect().
+void VncClient::sessionFailed(const QString &message)
+{
+    QMetaObject::invokeMethod(this, [this, message]() {
+        if (m_state != QStringLiteral("disconnected")) {
+            setState(QStringLiteral("error"));
+            emit errorOccurred(message);
+        }
+    }, Qt::QueuedConnection);
+}
+
 void VncClient::disconnect()
 {
-    // Signal the poll loop to stop; wait for the thread to exit before
-    // touching rfb — the thread owns it and frees it at the end of the lambda.
+    // Signal the session thread to stop; wait for it to exit before
+    // touching rfb.
     m_running.store(false);
+    wakeWorker();
 
     if (m_thread) {
         m_thread->wait();
-        m_thread->deleteLater();
+        delete m_thread;
         m_thread = nullptr;
     }
 
+    if (m_wakeFd >= 0) {
+        ::close(m_wakeFd);
+        m_wakeFd = -1;
+    }
+
     /* Purge any QueuedConnection invokeMethod calls the worker thread posted
        before it exited. If left in the queue they would fire after this object
        is destroyed (use-after-free → crash when closing the window during
@@ -221,10 +481,12 @@ void VncClient::disconnect()
         m_rfb = nullptr;
     }
 
-    {
-        QMutexLocker lk(&m_cmdMutex);
-        m_cmdQueue.clear();
-    }
+    m_input.clear();
+    m_inputWakePending.store(false);
+
+    // The next server may not support the cursor pseudo-encoding.
+    if (!m_cursorImage.isNull())
+        setCursorShape(QImage(), QPoint());
 
     setState(QStringLiteral("disconnected"));
 }
@@ -241,9 +503,11 @@ void VncClient::sendKeyEvent(int qtKey, const QString &text, int location, bool
         if (!m_keyDownList.contains(trackKey)) return;
         keysym = m_keyDownList.take(trackKey);
     }
-    postCmd([keysym, pressed](rfbClient *rfb) {
-        SendKeyEvent(rfb, keysym, pressed ? TRUE : FALSE);
-    });
+    VncInputEvent ev;
+    ev.type   = VncInputEvent::Key;
+    ev.keysym = keysym;
+    ev.down   = pressed;
+    postInput(ev);
 }
 
 void VncClient::allKeysUp()
@@ -251,10 +515,13 @@ void VncClient::allKeysUp()
     if (!m_rfb) return;
     const QList<quint32> keysyms = m_keyDownList.values();
     m_keyDownList.clear();
-    postCmd([keysyms](rfbClient *rfb) {
-        for (auto keysym : keysyms)
-            SendKeyEvent(rfb, keysym, FALSE);
-    });
+    for (auto keysym : keysyms) {
+        VncInputEvent ev;
+        ev.type   = VncInputEvent::Key;
+        ev.keysym = keysym;
+        ev.down   = false;
+        postInput(ev);
+    }
 }
 
 void VncClient::sendPointerEvent(int x, int y, int qtButtons)
@@ -268,9 +535,13 @@ void VncClient::sendPointerEvent(int x, int y, int qtButtons)
     if (qtButtons & 0x04) vncMask |= (1 << 1);
     if (qtButtons & 0x08) vncMask |= (1 << 7);
     if (qtButtons & 0x10) vncMask |= (1 << 8);
-    postCmd([x, y, vncMask](rfbClient *rfb) {
-        SendPointerEvent(rfb, x, y, vncMask);
-    });
+    setCursorPosition(QPoint(x, y));
+    VncInputEvent ev;
+    ev.type    = VncInputEvent::Pointer;
+    ev.x       = x;
+    ev.y       = y;
+    ev.buttons = quint16(vncMask);
+    postInput(ev);
 }
 
 void VncClient::sendWheelEvent(int x, int y, int steps, bool up, bool horizontal)
@@ -279,12 +550,13 @@ void VncClient::sendWheelEvent(int x, int y, int steps, bool up, bool horizontal
     // VNC scroll: up=bit3, down=bit4, left=bit5, right=bit6
     int btn = horizontal ? (up ? (1 << 5) : (1 << 6))
                          : (up ? (1 << 3) : (1 << 4));
-    postCmd([x, y, steps, btn](rfbClient *rfb) {
-        for (int i = 0; i < steps; i++) {
-            SendPointerEvent(rfb, x, y, btn);
-            SendPointerEvent(rfb, x, y, 0);
-        }
-    });
+    VncInputEvent ev;
+    ev.type    = VncInputEvent::Wheel;
+    ev.x       = x;
+    ev.y       = y;
+    ev.buttons = quint16(btn);
+    ev.steps   = steps;
+    postInput(ev);
 }
 
 void VncClient::setState(const QString &state)
@@ -294,10 +566,226 @@ void VncClient::setState(const QString &state)
     emit stateChanged();
 }
 
-void VncClient::postCmd(std::function<void(rfbClient*)> fn)
+// GUI thread. Only the first push after the worker last drained costs a
+// syscall; the worker clears m_inputWakePending before each drain, so a
+// push that sees it still set is guaranteed to be picked up.
+void VncClient::postInput(const VncInputEvent &ev)
+{
+    if (!m_input.push(ev)) {
+        m_inputDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    m_inputReceived.fetch_add(1, std::memory_order_relaxed);
+    if (!m_inputWakePending.exchange(true))
+        wakeWorker();
+}
+
+// Worker thread. Consecutive pointer moves with the same button mask only
+// matter for their final position, so all but the last are skipped; a
+// press, release or key event in between ends the run.
+void VncClient::drainInput(rfbClient *rfb)
+{
+    m_inputWakePending.store(false);
+
+    VncInputEvent ev;
+    if (m_inputPendingSinceNs < 0 && m_input.peek(&ev))
+        m_inputPendingSinceNs = m_clock.nsecsElapsed();
+    while (m_input.pop(&ev)) {
+        switch (ev.type) {
+        case VncInputEvent::Key:
+            SendKeyEvent(rfb, ev.keysym, ev.down ? TRUE : FALSE);
+            m_inputSent.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case VncInputEvent::Pointer: {
+            VncInputEvent next;
+            while (m_input.peek(&next) && next.type == VncInputEvent::Pointer
+                   && next.buttons == ev.buttons) {
+                m_input.pop(&ev);
+                m_inputCoalesced.fetch_add(1, std::memory_order_relaxed);
+            }
+            SendPointerEvent(rfb, ev.x, ev.y, ev.buttons);
+            m_inputSent.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+        case VncInputEvent::Wheel:
+            // RFB has no wheel delta: each step is a press + release.
+            for (int i = 0; i < ev.steps; i++) {
+                SendPointerEvent(rfb, ev.x, ev.y, ev.buttons);
+                SendPointerEvent(rfb, ev.x, ev.y, 0);
+            }
+            m_inputSent.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+    }
+}
+
+// Worker thread. A server that supports ContinuousUpdates answers the
+// pseudo-encoding with EndOfContinuousUpdates; that is our cue to enable
+// them. A second one while enabled means the server stopped pushing — stay
+// on request/response rather than re-enabling in a loop.
+void VncClient::handleEndOfContinuousUpdates(rfbClient *rfb)
+{
+    if (m_continuousUpdates.load()) {
+        m_continuousUpdates.store(false);
+        m_continuousUpdatesEnded = true;
+        SendIncrementalFramebufferUpdateRequest(rfb);
+        return;
+    }
+    if (m_continuousUpdatesEnded)
+        return;
+    if (sendEnableContinuousUpdates(rfb, true))
+        m_continuousUpdates.store(true);
+}
+
+// The enabled area has to follow the framebuffer size.
+void VncClient::updateContinuousUpdatesArea(rfbClient *rfb)
+{
+    if (m_continuousUpdates.load())
+        sendEnableContinuousUpdates(rfb, true);
+}
+
+// Fence: the server uses these to measure the pipeline when continuous
+// updates are on. We process messages strictly in order on one thread, so
+// the blocking flags are already honoured; echo the payload with the
+// request bit cleared.
+bool VncClient::handleServerFence(rfbClient *rfb)
+{
+    char header[8]; // 3 padding, u32 flags, u8 length
+    if (!ReadFromRFBServer(rfb, header, sizeof(header)))
+        return false;
+    const quint32 flags = qFromBigEndian<quint32>(header + 3);
+    const quint8 length = quint8(header[7]);
+    char payload[64];
+    if (length > sizeof(payload) || (length > 0 && !ReadFromRFBServer(rfb, payload, length)))
+        return false;
+    if (!(flags & kFenceRequest))
+        return true;
+
+    // type, 3 padding, u32 flags, u8 length, payload
+    char reply[9 + sizeof(payload)] = {};
+    reply[0] = char(kMsgFence);
+    qToBigEndian<quint32>(flags & (kFenceBlockBefore | kFenceBlockAfter | kFenceSyncNext), reply + 4);
+    reply[8] = char(length);
+    memcpy(reply + 9, payload, length);
+    return WriteToRFBServer(rfb, reply, 9 + length);
+}
+
+// Worker thread. SetFormatAndEncodings re-sends both messages; the server
+// uses the new encodings from its next framebuffer update.
+void VncClient::applyEncodingProfile(rfbClient *rfb, int profile)
+{
+    const EncodingProfile &p = kEncodingProfiles[profile];
+    rfb->appData.encodingsString = p.encodings;
+    rfb->appData.compressLevel   = p.compressLevel;
+    rfb->appData.qualityLevel    = p.qualityLevel;
+    SetFormatAndEncodings(rfb);
+    m_appliedProfile = profile;
+}
+
+QString VncClient::activeEncodingProfile() const
+{
+    return QLatin1String(kEncodingProfiles[m_activeProfile].name);
+}
+
+void VncClient::setEncodingProfile(const QString &profile)
+{
+    const QString normalized = profileIndex(profile) >= 0 ? profile : QStringLiteral("auto");
+    if (m_encodingProfile == normalized) return;
+    m_encodingProfile = normalized;
+    m_autoCandidate = -1;
+    m_autoVotes = 0;
+    const int pinned = profileIndex(normalized);
+    if (pinned >= 0)
+        setActiveProfile(pinned);
+    emit encodingProfileChanged();
+}
+
+void VncClient::updateLinkEstimate(int rttMs, int throughputKbps)
+{
+    if (m_encodingProfile != QStringLiteral("auto") || rttMs < 0)
+        return;
+
+    const bool measured = throughputKbps >= 0;
+    int candidate = kProfileWan;
+    if (rttMs >= kSlowMinRttMs)
+        candidate = kProfileSlow;
+    else if (rttMs <= kLanMaxRttMs && (!measured || throughputKbps >= kLanMinKbps))
+        candidate = kProfileLan;
+    // Profiles are ordered best link first. An idle interval is no evidence
+    // against the link, so it may confirm or upgrade but never downgrade.
+    if (!measured && candidate > m_activeProfile)
+        candidate = m_activeProfile;
+
+    if (candidate == m_activeProfile) {
+        m_autoCandidate = -1;
+        m_autoVotes = 0;
+        return;
+    }
+    if (candidate != m_autoCandidate) {
+        m_autoCandidate = candidate;
+        m_autoVotes = 0;
+    }
+    if (++m_autoVotes >= kProfileSwitchVotes) {
+        m_autoCandidate = -1;
+        m_autoVotes = 0;
+        setActiveProfile(candidate);
+        emit encodingProfileChanged();
+    }
+}
+
+void VncClient::setActiveProfile(int profile)
+{
+    if (m_activeProfile == profile) return;
+    m_activeProfile = profile;
+    m_requestedProfile.store(profile);
+    wakeWorker();
+}
+
+QVariantMap VncClient::stats() const
+{
+    const qint64 lastLatencyNs = m_inputLatencyLastNs.load(std::memory_order_relaxed);
+    return {
+        { QStringLiteral("inputReceived"),  QVariant::fromValue(m_inputReceived.load(std::memory_order_relaxed)) },
+        { QStringLiteral("inputSent"),      QVariant::fromValue(m_inputSent.load(std::memory_order_relaxed)) },
+        { QStringLiteral("inputCoalesced"), QVariant::fromValue(m_inputCoalesced.load(std::memory_order_relaxed)) },
+        { QStringLiteral("inputDropped"),   QVariant::fromValue(m_inputDropped.load(std::memory_order_relaxed)) },
+        { QStringLiteral("encodingProfile"), activeEncodingProfile() },
+        { QStringLiteral("continuousUpdates"), m_continuousUpdates.load() },
+        { QStringLiteral("framesPublished"),  QVariant::fromValue(m_frames.publishedCount()) },
+        { QStringLiteral("framesDisplayed"),  QVariant::fromValue(m_frames.acquiredCount()) },
+        { QStringLiteral("framesDropped"),    QVariant::fromValue(m_frames.supersededCount()) },
+        { QStringLiteral("serverMessages"),   QVariant::fromValue(m_serverMessages.load(std::memory_order_relaxed)) },
+        { QStringLiteral("handleUs"),         QVariant::fromValue(m_handleNs.load(std::memory_order_relaxed) / 1000) },
+        { QStringLiteral("inputLatencySamples"), QVariant::fromValue(m_inputLatencySamples.load(std::memory_order_relaxed)) },
+        { QStringLiteral("inputLatencyUs"),      QVariant::fromValue(m_inputLatencyNs.load(std::memory_order_relaxed) / 1000) },
+        { QStringLiteral("inputLatencyLastUs"),  lastLatencyNs < 0 ? qint64(-1) : lastLatencyNs / 1000 },
+    };
+}
+
+// Bumps the eventfd counter; the session thread's poll() returns and it
+// runs serviceSession, which drains the input ring (or notices m_running
+// went false). Safe from any thread.
+void VncClient::wakeWorker()
+{
+    if (m_wakeFd < 0) return;
+    const quint64 one = 1;
+    ssize_t n = ::write(m_wakeFd, &one, sizeof(one));
+    Q_UNUSED(n) // EAGAIN means the counter is already non-zero: still awake
+}
+
+void VncClient::setCursorShape(const QImage &image, const QPoint &hotspot)
+{
+    m_cursorImage = image;
+    m_cursorHotspot = hotspot;
+    ++m_cursorSerial;
+    emit cursorShapeChanged();
+}
+
+void VncClient::setCursorPosition(const QPoint &pos)
 {
-    QMutexLocker lk(&m_cmdMutex);
-    m_cmdQueue.enqueue(std::move(fn));
+    if (m_cursorPos == pos) return;
+    m_cursorPos = pos;
+    emit cursorMoved();
 }
 
 void VncClient::setFrameSize(int w, int h)
@@ -1,13 +1,16 @@
 #pragma once
 
 #include <QObject>
+#include <QElapsedTimer>
 #include <QImage>
 #include <QHash>
-#include <QMutex>
-#include <QQueue>
+#include <QRegion>
 #include <QThread>
+#include <QVariantMap>
 #include <atomic>
-#include <functional>
+
+#include "vncframeexchange.h"
+#include "vncinputring.h"
 
 struct _rfbClient;
 typedef struct _rfbClient rfbClient;
@@ -18,6 +21,13 @@ class VncClient : public QObject {
     Q_PROPERTY(QString state READ state NOTIFY stateChanged)
     Q_PROPERTY(int frameWidth READ frameWidth NOTIFY frameSizeChanged)
     Q_PROPERTY(int frameHeight READ frameHeight NOTIFY frameSizeChanged)
+    // "auto" (pick from measured link conditions), or a pinned "lan",
+    // "wan" or "slow" profile. activeEncodingProfile is what is in effect.
+    Q_PROPERTY(QString encodingProfile READ encodingProfile WRITE setEncodingProfile NOTIFY encodingProfileChanged)
+    Q_PROPERTY(QString activeEncodingProfile READ activeEncodingProfile NOTIFY encodingProfileChanged)
+    // True once the server sent a cursor shape: the pointer is drawn locally
+    // by VncFrameView and the OS cursor should be hidden over the frame.
+    Q_PROPERTY(bool hasCursorShape READ hasCursorShape NOTIFY cursorShapeChanged)
 
 public:
     void setFrameSize(int w, int h);
@@ -27,40 +37,139 @@ public:
     QString state() const { return m_state; }
     int frameWidth() const { return m_frameWidth; }
     int frameHeight() const { return m_frameHeight; }
+    QString encodingProfile() const { return m_encodingProfile; }
+    QString activeEncodingProfile() const;
+    void setEncodingProfile(const QString &profile);
+
+    // Local cursor, GUI thread. Position is in framebuffer coordinates: the
+    // last pointer event we sent, or where the server moved the pointer.
+    bool   hasCursorShape() const { return !m_cursorImage.isNull(); }
+    QImage cursorImage()    const { return m_cursorImage; }
+    QPoint cursorHotspot()  const { return m_cursorHotspot; }
+    QPoint cursorPosition() const { return m_cursorPos; }
+    quint64 cursorSerial()  const { return m_cursorSerial; }
+    void setCursorShape(const QImage &image, const QPoint &hotspot);
+    void setCursorPosition(const QPoint &pos);
 
     Q_INVOKABLE void connectToVnc(const QString &host, int port);
+    // Runs the session over an already connected stream socket (the
+    // VncWsProxy socketpair end). Takes ownership of fd.
+    Q_INVOKABLE void connectToSocket(int fd);
     Q_INVOKABLE void setTicketSecure(const QByteArray &ticket);
     Q_INVOKABLE void disconnect();
     Q_INVOKABLE void sendKeyEvent(int qtKey, const QString &text, int location, bool pressed);
     Q_INVOKABLE void sendPointerEvent(int x, int y, int qtButtons);
     Q_INVOKABLE void sendWheelEvent(int x, int y, int steps, bool up, bool horizontal = false);
     Q_INVOKABLE void allKeysUp();
+    // Feeds one VncWsProxy::linkSampled interval into the "auto" profile
+    // choice. rttMs < 0 means not measured yet; throughputKbps < 0 means the
+    // interval was too quiet to measure, and then RTT decides alone.
+    // Throughput only ever keeps the profile off lan.
+    Q_INVOKABLE void updateLinkEstimate(int rttMs, int throughputKbps);
+    // Pipeline counters. Input: events accepted from QML, written to the
+    // server, merged into a later pointer move, rejected by a full ring.
+    // Frames: published by the worker, displayed (one per scene graph
+    // frame at most), dropped as superseded. Timing: server messages
+    // handled and the time spent decoding them, input-to-update latency.
+    // Plus the active encoding profile and whether continuous updates are
+    // on. Counters are totals; the HUD diffs two snapshots for rates.
+    Q_INVOKABLE QVariantMap stats() const;
 
-    /*  Called from the worker-thread updateCallback to mark that new pixel data
-        arrived. The poll loop copies + emits once after HandleRFBServerMessage
-        so all dirty-rect tiles in one server message are coalesced into a single
-        frameUpdated signal instead of N separate copies and paints.
+    /*  Called from the worker-thread updateCallback with each dirty rect.
+        Once HandleRFBServerMessage returns, serviceSession publishes the
+        accumulated region into the frame exchange, so the tiles of one
+        server message cost one copy of their own pixels.
     */
-    void markFrameDirty() noexcept { m_frameDirty.store(true, std::memory_order_relaxed); }
+    void markFrameDirty(int x, int y, int w, int h) { m_pendingDamage += QRect(x, y, w, h); }
+
+    // Worker thread, from the ContinuousUpdates/Fence protocol extension.
+    void handleEndOfContinuousUpdates(rfbClient *rfb);
+    bool handleServerFence(rfbClient *rfb);
+    void updateContinuousUpdatesArea(rfbClient *rfb);
+
+    // Latest-frame slot shared with VncFrameView. reset()/publish() on the
+    // worker thread, acquire() on the render thread.
+    VncFrameExchange &frameExchange() noexcept { return m_frames; }
 
 signals:
     void stateChanged();
     void frameSizeChanged();
-    void frameUpdated(const QImage &image, int x, int y, int w, int h);
+    void encodingProfileChanged();
+    void cursorShapeChanged();
+    void cursorMoved();
+    // A new frame is waiting in frameExchange(). Never more than one of
+    // these is queued; the reader acquires whatever is newest.
+    void frameReady();
     void errorOccurred(const QString &message);
 
 private:
     QHash<quint32, quint32> m_keyDownList;
     void setState(const QString &state);
-    void postCmd(std::function<void(rfbClient*)> fn);
+    void startSession(const QString &host, int port, int fd);
+    void postInput(const VncInputEvent &ev);
+    void drainInput(rfbClient *rfb);
+    void wakeWorker();
+    void applyEncodingProfile(rfbClient *rfb, int profile);
+    void setActiveProfile(int profile);
+    // Session thread. serviceSession() forwards queued input and handles
+    // every server message that is ready; false means the session is over
+    // (stopped, or dead and reported to the GUI).
+    bool serviceSession();
+    void sessionFailed(const QString &message);
 
     rfbClient        *m_rfb     = nullptr;
     QThread          *m_thread  = nullptr;  // owns rfbInitClient + poll loop
     std::atomic<bool> m_running  { false };
-    std::atomic<bool> m_frameDirty { false };
+    int               m_wakeFd  = -1;       // eventfd: postInput/profile/disconnect → poll loop
+    // Worker-thread only: touched by the libvncclient callbacks and
+    // serviceSession(), never from the GUI thread.
+    QRegion m_pendingDamage;
+    VncFrameExchange m_frames;
+
+    // GUI thread → worker. 1024 events is seconds of fast mouse motion; the
+    // worker is woken on the first push after it last drained.
+    VncInputRing<1024> m_input;
+    std::atomic<bool>  m_inputWakePending { false };
+    std::atomic<quint64> m_inputReceived  { 0 };
+    std::atomic<quint64> m_inputSent      { 0 };
+    std::atomic<quint64> m_inputCoalesced { 0 };
+    std::atomic<quint64> m_inputDropped   { 0 };
+
+    // Timing for stats(). m_clock is started in the constructor and only
+    // read afterwards, so any thread may use it. Handling time is
+    // HandleRFBServerMessage per server message: decoding, plus any wait
+    // for the rest of a message that arrived in pieces. Input latency runs from
+    // the first input event sent since the last update to the next
+    // framebuffer update; under continuous updates that update may not be
+    // the server's answer to the input, so read it as a lower bound.
+    QElapsedTimer        m_clock;
+    std::atomic<quint64> m_serverMessages      { 0 };
+    std::atomic<quint64> m_handleNs            { 0 };
+    std::atomic<quint64> m_inputLatencySamples { 0 };
+    std::atomic<quint64> m_inputLatencyNs      { 0 };
+    std::atomic<qint64>  m_inputLatencyLastNs  { -1 };
+    qint64               m_inputPendingSinceNs = -1;   // worker thread only
+
+    // Encoding profile: index into the profile table in vncclient.cpp.
+    // m_requestedProfile is written by the GUI thread and picked up by the
+    // worker, which re-sends SetPixelFormat/SetEncodings when it changes.
+    QString m_encodingProfile = QStringLiteral("auto");
+    int     m_activeProfile   = 1;          // wan until measured
+    int     m_autoCandidate   = -1;
+    int     m_autoVotes       = 0;
+    std::atomic<int> m_requestedProfile { 1 };
+    int     m_appliedProfile  = -1;         // worker thread only
+
+    // ContinuousUpdates: the server pushes updates without a
+    // FramebufferUpdateRequest round trip per frame. Written by the worker,
+    // read by stats().
+    std::atomic<bool> m_continuousUpdates { false };
+    bool              m_continuousUpdatesEnded = false;  // worker thread only
 
-    QMutex m_cmdMutex;
-    QQueue<std::function<void(rfbClient*)>> m_cmdQueue;
+    QImage  m_cursorImage;    // ARGB32_Premultiplied, built on the worker
+    QPoint  m_cursorHotspot;
+    QPoint  m_cursorPos;
+    quint64 m_cursorSerial = 0;
 
     QByteArray m_ticket;
     QString m_state       = QStringLiteral("disconnected");
@@ -0,0 +1,92 @@
+#include "vncframeexchange.h"
+
+#include "pixelkernels.h"
+
+#include <QMutexLocker>
+#include <utility>
+
+// Past this many disjoint rects one copy of the bounding box is cheaper
+// than the per-rect overhead.
+static constexpr int kMaxCopyRects = 16;
+
+// Copies r of the 32bpp framebuffer into dst. The padding byte is forced to
+// 0xff in the same pass — Format_RGB32 requires it, and it becomes the
+// texture alpha — so no separate conversion runs.
+static void copyFrameRect(const uint8_t *frameBuffer, qsizetype stride, QImage &dst, const QRect &r)
+{
+    const auto copyOpaque = pixelKernels().copyOpaque;
+    const int w = r.width();
+    for (int row = r.top(); row <= r.bottom(); ++row) {
+        const auto *src = reinterpret_cast<const uint32_t *>(
+            frameBuffer + row * stride + qsizetype(r.x()) * 4);
+        auto *out = reinterpret_cast<uint32_t *>(dst.scanLine(row)) + r.x();
+        copyOpaque(out, src, w);
+    }
+}
+
+void VncFrameExchange::reset(const QSize &size)
+{
+    QMutexLocker lk(&m_mutex);
+    m_size = size;
+    const QRect all(QPoint(0, 0), size);
+    for (int i = 0; i < 3; ++i) {
+        m_buffers[i] = QImage(size, QImage::Format_RGB32);
+        m_stale[i] = all;
+    }
+    m_unread = all;
+    m_fresh.store(false, std::memory_order_release);
+}
+
+bool VncFrameExchange::publish(const uint8_t *frameBuffer, qsizetype stride, const QRegion &damage)
+{
+    const QRect bounds(QPoint(0, 0), m_size);
+    const QRegion clipped = damage & bounds;
+    if (clipped.isEmpty() || !frameBuffer)
+        return false;
+
+    QRegion copy;
+    {
+        QMutexLocker lk(&m_mutex);
+        copy = m_stale[m_back] + clipped;
+        m_stale[m_back] = QRegion();
+        for (int i = 0; i < 3; ++i) {
+            if (i != m_back)
+                m_stale[i] += clipped;
+        }
+    }
+
+    // The back buffer is worker-owned, so the copy runs unlocked. scanLine()
+    // only detaches if a stale reference from the reader is still alive.
+    QImage &back = m_buffers[m_back];
+    if (copy.rectCount() > kMaxCopyRects) {
+        copyFrameRect(frameBuffer, stride, back, copy.boundingRect());
+    } else {
+        for (const QRect &r : copy)
+            copyFrameRect(frameBuffer, stride, back, r);
+    }
+
+    QMutexLocker lk(&m_mutex);
+    std::swap(m_back, m_middle);
+    m_unread += clipped;
+    m_published.fetch_add(1, std::memory_order_relaxed);
+    if (m_fresh.exchange(true, std::memory_order_acq_rel)) {
+        m_superseded.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+bool VncFrameExchange::acquire(QImage *frame, QRegion *damage)
+{
+    if (!m_fresh.load(std::memory_order_acquire))
+        return false;
+
+    QMutexLocker lk(&m_mutex);
+    if (!m_fresh.exchange(false, std::memory_order_acq_rel))
+        return false;
+    std::swap(m_front, m_middle);
+    *frame = m_buffers[m_front];
+    *damage = std::exchange(m_unread, QRegion());
+    m_acquired.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QImage>
+#include <QMutex>
+#include <QRegion>
+#include <QSize>
+#include <atomic>
+#include <cstdint>
+
+/*  Triple-buffered frame handoff between VncClient's worker thread and the
+    scene graph.
+
+    Three Format_RGB32 buffers are allocated once per framebuffer size. The
+    worker owns the back buffer and the reader owns the front; the middle
+    one is the latest published frame. publish() swaps back and middle,
+    acquire() swaps middle and front, so a frame the reader never picked up
+    is simply overwritten — memory stays at three framebuffers however far
+    the reader lags.
+
+    Each buffer carries the region it is missing relative to the newest
+    frame. Before publishing, the worker brings the back buffer up to date
+    from rfb->frameBuffer (that stale region plus the new damage), so a
+    buffer is never fully copied except after a resize. The reader gets the
+    union of all damage published since its previous acquire.
+*/
+class VncFrameExchange {
+public:
+    // Worker thread. Reallocates all three buffers; the next publish copies
+    // the whole framebuffer and the reader sees full damage.
+    void reset(const QSize &size);
+
+    // Worker thread. Copies damage (plus whatever the back buffer is missing)
+    // from frameBuffer and makes it the latest frame. Returns true when the
+    // reader has to be told a frame is waiting — i.e. the slot was not
+    // already fresh, so at most one notification is in flight.
+    bool publish(const uint8_t *frameBuffer, qsizetype stride, const QRegion &damage);
+
+    // Reader thread. Takes the latest frame if one was published since the
+    // last call. *frame is replaced under the lock, so the reader's hold on
+    // its previous front buffer is dropped before the worker can reuse it;
+    // the new one stays unchanged until the next acquire().
+    bool acquire(QImage *frame, QRegion *damage);
+
+    bool hasFreshFrame() const noexcept { return m_fresh.load(std::memory_order_acquire); }
+
+    // Pacing counters: frames published by the worker, frames the reader
+    // took, and frames overwritten before the reader got to them.
+    quint64 publishedCount()  const noexcept { return m_published.load(std::memory_order_relaxed); }
+    quint64 acquiredCount()   const noexcept { return m_acquired.load(std::memory_order_relaxed); }
+    quint64 supersededCount() const noexcept { return m_superseded.load(std::memory_order_relaxed); }
+
+private:
+    QMutex  m_mutex;
+    QImage  m_buffers[3];
+    QRegion m_stale[3];     // per buffer: area older than the newest frame
+    QRegion m_unread;       // damage published since the reader's last acquire
+    QSize   m_size;
+    int     m_back   = 0;   // worker-owned
+    int     m_middle = 1;   // latest published
+    int     m_front  = 2;   // reader-owned
+    std::atomic<bool> m_fresh { false };
+    std::atomic<quint64> m_published  { 0 };
+    std::atomic<quint64> m_acquired   { 0 };
+    std::atomic<quint64> m_superseded { 0 };
+};
@@ -0,0 +1,121 @@
+#include "vncframetexture.h"
+
+#include "pixelkernels.h"
+
+#include <QElapsedTimer>
+#include <QVarLengthArray>
+#include <rhi/qrhi.h>
+#include <utility>
+
+// Past this many disjoint rects one upload of the bounding box is cheaper
+// than the per-entry overhead.
+static constexpr int kMaxUploadRects = 16;
+
+VncFrameTexture::VncFrameTexture(const QSize &size, std::shared_ptr<VncFrameUploadStats> stats)
+    : m_size(size)
+    , m_stats(std::move(stats))
+{
+}
+
+VncFrameTexture::~VncFrameTexture()
+{
+    // Runs on the render thread (the node owns us). deleteLater lets any
+    // frame still in flight finish with the texture first.
+    if (m_texture)
+        m_texture->deleteLater();
+}
+
+qint64 VncFrameTexture::comparisonKey() const
+{
+    return qint64(quintptr(this));
+}
+
+QRhiTexture *VncFrameTexture::rhiTexture() const
+{
+    return m_texture;
+}
+
+void VncFrameTexture::stage(const QImage &frame, const QRegion &damage)
+{
+    if (frame.size() != m_size || damage.isEmpty())
+        return;
+
+    m_hasAlpha = frame.hasAlphaChannel();
+
+    const QRect bounds = frame.rect();
+    // A whole-frame upload supersedes anything staged before it.
+    if (damage.boundingRect().contains(bounds) && damage.rectCount() == 1) {
+        m_pending.clear();
+        m_pending.push_back({ frame, bounds });
+        return;
+    }
+
+    if (damage.rectCount() > kMaxUploadRects) {
+        m_pending.push_back({ frame, damage.boundingRect() & bounds });
+        return;
+    }
+    for (const QRect &rect : damage) {
+        const QRect r = rect & bounds;
+        if (!r.isEmpty())
+            m_pending.push_back({ frame, r });
+    }
+}
+
+void VncFrameTexture::commitTextureOperations(QRhi *rhi, QRhiResourceUpdateBatch *resourceUpdates)
+{
+    if (!m_texture) {
+        // QImage::Format_RGB32 is B,G,R,0xff in memory on little-endian
+        // hosts, so BGRA8 takes the VNC patches byte for byte.
+        m_swizzle = !rhi->isTextureFormatSupported(QRhiTexture::BGRA8);
+        m_texture = rhi->newTexture(m_swizzle ? QRhiTexture::RGBA8 : QRhiTexture::BGRA8, m_size);
+        if (!m_texture->create()) {
+            qWarning("[VncFrameTexture] failed to create %dx%d texture", m_size.width(), m_size.height());
+            delete m_texture;
+            m_texture = nullptr;
+            m_pending.clear();
+            return;
+        }
+    }
+
+    if (m_pending.isEmpty())
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+    quint64 bytes = 0;
+    QVarLengthArray<QRhiTextureUploadEntry, kMaxUploadRects> entries;
+    for (const Patch &patch : std::as_const(m_pending)) {
+        bytes += quint64(patch.rect.width()) * quint64(patch.rect.height()) * 4;
+        if (m_swizzle) {
+            // The exchange already made alpha 0xff, so swapping R and B
+            // is the whole RGB32 → RGBX8888 conversion.
+            QImage rgbx(patch.rect.size(), QImage::Format_RGBX8888);
+            const auto swizzleRB = pixelKernels().swizzleRB;
+            for (int y = 0; y < patch.rect.height(); ++y) {
+                const auto *src = reinterpret_cast<const uint32_t *>(
+                    patch.frame.constScanLine(patch.rect.top() + y)) + patch.rect.left();
+                swizzleRB(reinterpret_cast<uint32_t *>(rgbx.scanLine(y)), src, patch.rect.width());
+            }
+            QRhiTextureSubresourceUploadDescription desc(rgbx);
+            desc.setDestinationTopLeft(patch.rect.topLeft());
+            entries.append(QRhiTextureUploadEntry(0, 0, desc));
+            continue;
+        }
+        // Upload straight out of the front buffer; QRhi copies the source
+        // rect into its staging memory.
+        QRhiTextureSubresourceUploadDescription desc(patch.frame);
+        desc.setSourceTopLeft(patch.rect.topLeft());
+        desc.setSourceSize(patch.rect.size());
+        desc.setDestinationTopLeft(patch.rect.topLeft());
+        entries.append(QRhiTextureUploadEntry(0, 0, desc));
+    }
+    QRhiTextureUploadDescription upload;
+    upload.setEntries(entries.cbegin(), entries.cend());
+    resourceUpdates->uploadTexture(m_texture, upload);
+    m_pending.clear();
+    if (m_stats) {
+        m_stats->uploads.fetch_add(1, std::memory_order_relaxed);
+        m_stats->bytes.fetch_add(bytes, std::memory_order_relaxed);
+        m_stats->ns.fetch_add(quint64(timer.nsecsElapsed()), std::memory_order_relaxed);
+    }
+}
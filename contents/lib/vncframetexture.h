@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QImage>
+#include <QList>
+#include <QPoint>
+#include <QRegion>
+#include <QSGTexture>
+#include <QSize>
+#include <atomic>
+#include <memory>
+
+class QRhiTexture;
+
+// Upload counters a VncFrameView shares with the textures it creates:
+// written on the render thread, read by VncFrameView::stats() on the GUI
+// thread. ns is the CPU time commitTextureOperations() spends queueing the
+// patches (swizzle and QRhi staging copy); the GPU transfer itself is not
+// visible from here.
+struct VncFrameUploadStats {
+    std::atomic<quint64> uploads { 0 };
+    std::atomic<quint64> bytes   { 0 };
+    std::atomic<quint64> ns      { 0 };
+};
+
+/*  Persistent scene-graph texture for VncFrameView.
+
+    The QRhiTexture is created once for a given framebuffer size; a resize
+    means a new VncFrameTexture. During the sync phase the view stages the
+    damaged rects of the exchange's front buffer, and
+    commitTextureOperations() uploads only those sub-rects into the
+    existing texture on the render thread. Staging keeps a shared reference
+    to the front buffer rather than copying: the worker never writes it
+    until the view acquires again at the next sync, after this commit.
+*/
+class VncFrameTexture : public QSGTexture {
+    Q_OBJECT
+
+public:
+    explicit VncFrameTexture(const QSize &size,
+                             std::shared_ptr<VncFrameUploadStats> stats = {});
+    ~VncFrameTexture() override;
+
+    // Sync phase only. frame must have the size passed to the constructor.
+    void stage(const QImage &frame, const QRegion &damage);
+
+    qint64 comparisonKey() const override;
+    QRhiTexture *rhiTexture() const override;
+    QSize textureSize() const override { return m_size; }
+    bool hasAlphaChannel() const override { return m_hasAlpha; }
+    bool hasMipmaps() const override { return false; }
+    void commitTextureOperations(QRhi *rhi, QRhiResourceUpdateBatch *resourceUpdates) override;
+
+private:
+    struct Patch {
+        QImage frame;   // shared with the exchange's front buffer
+        QRect  rect;
+    };
+
+    QSize        m_size;
+    bool         m_hasAlpha = false;   // VNC frames are opaque RGB32
+    bool         m_swizzle  = false;   // backend lacks BGRA8; convert patches to RGBA8
+    QRhiTexture *m_texture  = nullptr;
+    QList<Patch> m_pending;
+    std::shared_ptr<VncFrameUploadStats> m_stats;
+};
@@ -1,10 +1,27 @@
 #include "vncframeview.h"
+#include "vncclient.h"
+#include "vncframetexture.h"
 
 #include <QSGImageNode>
 #include <QQuickWindow>
 
+namespace {
+
+// Root of the view's subtree: the frame, with the locally drawn cursor
+// stacked on top as a separate node so pointer motion never touches the
+// frame texture.
+class FrameRootNode : public QSGNode {
+public:
+    QSGImageNode *frame  = nullptr;
+    QSGImageNode *cursor = nullptr;
+    quint64       cursorSerial = 0;
+};
+
+} // namespace
+
 VncFrameView::VncFrameView(QQuickItem *parent)
     : QQuickItem(parent)
+    , m_uploadStats(std::make_shared<VncFrameUploadStats>())
 {
     setFlag(QQuickItem::ItemHasContents, true);
     setAcceptedMouseButtons(Qt::AllButtons);
@@ -30,6 +47,14 @@ static QRectF fitRect(qreal viewW, qreal viewH, qreal imgW, qreal imgH)
 // Called on the render thread during the sync phase (main thread blocked).
 QSGNode *VncFrameView::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
 {
+    // Take the newest published frame, if any. Damage accumulates across
+    // frames the exchange dropped, so nothing is lost by skipping them.
+    if (m_client) {
+        QRegion damage;
+        if (m_client->frameExchange().acquire(&m_frame, &damage))
+            m_damage += damage;
+    }
+
     if (m_frame.isNull()) {
         delete oldNode;
         return nullptr;
@@ -38,20 +63,71 @@ QSGNode *VncFrameView::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
     // createImageNode() returns the backend-native node (OpenGL/Vulkan/Metal).
     // setOwnsTexture(true): setTexture() automatically frees the previous
     // texture — do not delete it manually.
-    auto *node = static_cast<QSGImageNode *>(oldNode);
-    if (!node) {
-        node = window()->createImageNode();
-        node->setFiltering(QSGTexture::Linear);
-        node->setOwnsTexture(true);
+    auto *root = static_cast<FrameRootNode *>(oldNode);
+    if (!root) {
+        root = new FrameRootNode;
+        root->frame = window()->createImageNode();
+        root->frame->setFiltering(QSGTexture::Linear);
+        root->frame->setOwnsTexture(true);
+        root->appendChildNode(root->frame);
     }
+    QSGImageNode *node = root->frame;
 
-    if (m_dirty) {
-        node->setTexture(window()->createTextureFromImage(m_frame));
-        m_dirty = false;
+    // One persistent texture per framebuffer size. A new texture (first
+    // frame, resize, or a scene graph rebuilt after releaseResources) needs
+    // the whole frame; otherwise only the damaged rects are uploaded.
+    auto *texture = static_cast<VncFrameTexture *>(node->texture());
+    if (!texture || texture->textureSize() != m_frame.size()) {
+        texture = new VncFrameTexture(m_frame.size(), m_uploadStats);
+        node->setTexture(texture);
+        m_damage = m_frame.rect();
     }
 
-    node->setRect(fitRect(width(), height(), m_frame.width(), m_frame.height()));
-    return node;
+    if (!m_damage.isEmpty()) {
+        texture->stage(m_frame, m_damage);
+        m_damage = QRegion();
+        node->markDirty(QSGNode::DirtyMaterial);
+    }
+
+    const QRectF fit = fitRect(width(), height(), m_frame.width(), m_frame.height());
+    node->setRect(fit);
+    updateCursorNode(root, fit);
+    return root;
+}
+
+// Cursor overlay. The texture is rebuilt only when the shape changes;
+// motion just moves the node. Scaled with the frame so the pointer keeps
+// its size relative to the remote desktop.
+void VncFrameView::updateCursorNode(QSGNode *rootNode, const QRectF &fit)
+{
+    auto *root = static_cast<FrameRootNode *>(rootNode);
+    const bool show = m_client && m_client->hasCursorShape() && !fit.isEmpty();
+    if (!show) {
+        if (root->cursor) {
+            root->removeChildNode(root->cursor);
+            delete root->cursor;
+            root->cursor = nullptr;
+        }
+        return;
+    }
+
+    if (!root->cursor) {
+        root->cursor = window()->createImageNode();
+        root->cursor->setFiltering(QSGTexture::Linear);
+        root->cursor->setOwnsTexture(true);
+        root->appendChildNode(root->cursor);
+        root->cursorSerial = 0;
+    }
+    if (root->cursorSerial != m_client->cursorSerial()) {
+        root->cursor->setTexture(window()->createTextureFromImage(
+            m_client->cursorImage(), QQuickWindow::TextureHasAlphaChannel));
+        root->cursorSerial = m_client->cursorSerial();
+    }
+
+    const qreal scale = fit.width() / m_frame.width();
+    const QPointF topLeft = m_client->cursorPosition() - m_client->cursorHotspot();
+    const QSizeF size = QSizeF(m_client->cursorImage().size()) * scale;
+    root->cursor->setRect(QRectF(fit.topLeft() + topLeft * scale, size));
 }
 
 void VncFrameView::geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry)
@@ -66,10 +142,26 @@ void VncFrameView::releaseResources()
     QQuickItem::releaseResources();
 }
 
-void VncFrameView::updateFrame(const QImage &image, int x, int y, int w, int h)
+QVariantMap VncFrameView::stats() const
 {
-    Q_UNUSED(x) Q_UNUSED(y) Q_UNUSED(w) Q_UNUSED(h)
-    m_frame = image;
-    m_dirty = true;
+    return {
+        { QStringLiteral("uploads"),     QVariant::fromValue(m_uploadStats->uploads.load(std::memory_order_relaxed)) },
+        { QStringLiteral("uploadBytes"), QVariant::fromValue(m_uploadStats->bytes.load(std::memory_order_relaxed)) },
+        { QStringLiteral("uploadUs"),    QVariant::fromValue(m_uploadStats->ns.load(std::memory_order_relaxed) / 1000) },
+    };
+}
+
+void VncFrameView::setClient(VncClient *client)
+{
+    if (m_client == client) return;
+    if (m_client)
+        QObject::disconnect(m_client, nullptr, this, nullptr);
+    m_client = client;
+    if (m_client) {
+        connect(m_client, &VncClient::frameReady,         this, &QQuickItem::update);
+        connect(m_client, &VncClient::cursorShapeChanged, this, &QQuickItem::update);
+        connect(m_client, &VncClient::cursorMoved,        this, &QQuickItem::update);
+    }
+    emit clientChanged();
     update();
 }
@@ -2,16 +2,34 @@
 
 #include <QQuickItem>
 #include <QImage>
+#include <QPointer>
+#include <QRegion>
+#include <QVariantMap>
+#include <memory>
+
+class VncClient;
+struct VncFrameUploadStats;
 
 class VncFrameView : public QQuickItem {
     Q_OBJECT
     QML_ELEMENT
 
+    // Source of frames. The view acquires the latest frame from the client's
+    // frame exchange during the scene graph sync; frameReady only schedules it.
+    Q_PROPERTY(VncClient *client READ client WRITE setClient NOTIFY clientChanged)
+
 public:
     explicit VncFrameView(QQuickItem *parent = nullptr);
 
-public slots:
-    void updateFrame(const QImage &image, int x, int y, int w, int h);
+    VncClient *client() const { return m_client; }
+    void setClient(VncClient *client);
+
+    // Texture upload counters: uploads committed, bytes and CPU time spent
+    // queueing them (totals; the HUD diffs two snapshots).
+    Q_INVOKABLE QVariantMap stats() const;
+
+signals:
+    void clientChanged();
 
 protected:
     QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *) override;
@@ -19,7 +37,13 @@ protected:
     void releaseResources() override;
 
 private:
-    QImage m_frame;  // written in updateFrame (main thread),
-                     // read in updatePaintNode (render thread sync — main blocked)
-    bool   m_dirty = false;
+    void updateCursorNode(QSGNode *root, const QRectF &fit);
+
+    QPointer<VncClient> m_client;
+    QImage  m_frame;   // front buffer of the exchange; only touched during
+                       // updatePaintNode (render thread sync — main blocked)
+    QRegion m_damage;  // rects of m_frame not yet staged for upload
+    // Shared with every texture this view creates, so it outlives the view
+    // if the render thread still holds one.
+    std::shared_ptr<VncFrameUploadStats> m_uploadStats;
 };
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <QtGlobal>
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// One input event from the GUI thread to the VNC worker. Plain data so the
+// ring never allocates.
+struct VncInputEvent {
+    enum Type : quint8 { Key, Pointer, Wheel };
+
+    Type    type    = Pointer;
+    bool    down    = false;  // Key: pressed
+    quint16 buttons = 0;      // Pointer: VNC button mask; Wheel: scroll button bit
+    qint32  x       = 0;
+    qint32  y       = 0;
+    quint32 keysym  = 0;      // Key
+    qint32  steps   = 0;      // Wheel
+};
+
+/*  Fixed-size lock-free single-producer/single-consumer ring.
+
+    The GUI thread is the only producer and the VNC worker the only
+    consumer. head is written only by push(), tail only by pop(), so each
+    side needs a single atomic store per event and nothing ever blocks.
+    A full ring rejects the push; the caller counts it as dropped.
+*/
+template <std::size_t Capacity>
+class VncInputRing {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    bool push(const VncInputEvent &ev) noexcept
+    {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == Capacity)
+            return false;
+        m_slots[head & (Capacity - 1)] = ev;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Looks at the oldest event without removing it.
+    bool peek(VncInputEvent *ev) const noexcept
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire))
+            return false;
+        *ev = m_slots[tail & (Capacity - 1)];
+        return true;
+    }
+
+    bool pop(VncInputEvent *ev) noexcept
+    {
+        if (!peek(ev))
+            return false;
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Only while no consumer is running (the worker has been joined).
+    void clear() noexcept { m_tail.store(m_head.load(std::memory_order_relaxed), std::memory_order_relaxed); }
+
+private:
+    std::array<VncInputEvent, Capacity> m_slots {};
+    // Separate cache lines so producer and consumer don't false-share.
+    alignas(64) std::atomic<std::size_t> m_head { 0 };
+    alignas(64) std::atomic<std::size_t> m_tail { 0 };
+};
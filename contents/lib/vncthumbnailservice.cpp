@@ -0,0 +1,536 @@
+#include "vncthumbnailservice.h"
+
+#include "pixelkernels.h"
+#include "proxmoxconsts.h"
+#include "vncwsproxy.h"
+
+#include <rfb/rfbclient.h>
+#include <string.h> // explicit_bzero
+#include <cstdlib>
+#include <ctime>
+#include <utility>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <QDebug>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPromise>
+#include <QRegion>
+#include <QThreadPool>
+#include <QTimer>
+
+// Thumbnail width in pixels; the height follows the guest's aspect ratio.
+static constexpr int kThumbnailWidth = 160;
+
+// Each thumbnail is refreshed at most this often, backing off up to 8x
+// while grabs of it keep failing. Every grab POSTs /vncproxy, which Proxmox
+// runs as a worker task, so each one is an entry in the cluster task log;
+// its ticket is good for a single connection and can't be reused.
+static constexpr int kRefreshIntervalMs  = 300'000;
+static constexpr int kMaxBackoffShift    = 3;
+// How long an unwatched VM keeps its thumbnail (see watch()). As long as
+// the image is fresh, so reopening the popup doesn't grab again.
+static constexpr int kReleaseGraceMs     = kRefreshIntervalMs;
+
+// Global budgets. After every grab the service pauses until that grab's
+// CPU time and bytes relayed average out to these, and never less than
+// kMinGapMs, so a list of twenty VMs costs the same as a list of two; it
+// just cycles more slowly.
+static constexpr int kMinGapMs                  = 1'000;
+static constexpr int kCpuBudgetPermille         = 20;          // of one core
+static constexpr int kBandwidthBudgetBytesPerSec = 32 * 1024;
+
+// The proxy's share of a grab runs on the shared console I/O thread, whose
+// CPU clock can't be split per session, so it is charged as an estimate:
+// the vncproxy POST, a TLS handshake and the WebSocket upgrade once per
+// grab, then TLS decryption and WebSocket framing per byte relayed. Both
+// are on the high side of what a desktop CPU spends.
+static constexpr qint64 kProxySessionCpuUs = 10'000;
+static constexpr qint64 kProxyCpuNsPerByte = 20;
+
+// A grab gives up on a frame after kGrabTimeoutMs; the watchdog also
+// covers the vncproxy request before it.
+static constexpr int kGrabTimeoutMs  = 5'000;
+static constexpr int kStageTimeoutMs = 15'000;
+static constexpr int kGrabPollUs     = 100'000;
+
+// Tight first so servers that allow lossy encoding send JPEG; quality and
+// compression are at the cheap end since the result is a postage stamp.
+static constexpr const char *kThumbnailEncodings = "tight zrle hextile raw";
+static constexpr int kThumbnailCompressLevel = 9;
+static constexpr int kThumbnailQualityLevel  = 1;
+
+// Downscaled images of every service in the process, keyed by storeKey().
+// Written on the GUI thread, read by VncThumbnailProvider on whichever
+// thread the engine loads images from.
+struct ThumbnailStore {
+    QMutex mutex;
+    QHash<QString, QImage> images;
+};
+
+static ThumbnailStore &thumbnailStore()
+{
+    static ThumbnailStore store;
+    return store;
+}
+
+static QString targetKey(const QString &sessionKey, const QString &node, int vmid)
+{
+    return sessionKey + QLatin1Char('/') + node + QLatin1Char('/') + QString::number(vmid);
+}
+
+static qint64 threadCpuUs()
+{
+    timespec ts {};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return qint64(ts.tv_sec) * 1'000'000 + ts.tv_nsec / 1'000;
+}
+
+// RGB565 framebuffer to a kThumbnailWidth-wide RGB32 image: one box-filter
+// pass straight off the 565 rows, more halvings while the result stays at
+// least the target width, then a smooth scale for the remainder.
+static QImage downscaleFrame(const uint16_t *fb, int width, int height)
+{
+    const PixelKernels &k = pixelKernels();
+    const int w = width / 2;
+    const int h = height / 2;
+    if (w <= 0 || h <= 0) return {};
+
+    QImage image(w, h, QImage::Format_RGB32);
+    std::vector<uint32_t> row0(size_t(2 * w));
+    std::vector<uint32_t> row1(size_t(2 * w));
+    for (int y = 0; y < h; ++y) {
+        k.expand565(row0.data(), fb + size_t(2 * y) * width, 2 * w);
+        k.expand565(row1.data(), fb + size_t(2 * y + 1) * width, 2 * w);
+        k.downscale2x(reinterpret_cast<uint32_t *>(image.scanLine(y)), row0.data(), row1.data(), w);
+    }
+
+    while (image.width() / 2 >= kThumbnailWidth && image.height() >= 2) {
+        QImage half(image.width() / 2, image.height() / 2, QImage::Format_RGB32);
+        for (int y = 0; y < half.height(); ++y) {
+            k.downscale2x(reinterpret_cast<uint32_t *>(half.scanLine(y)),
+                          reinterpret_cast<const uint32_t *>(image.constScanLine(2 * y)),
+                          reinterpret_cast<const uint32_t *>(image.constScanLine(2 * y + 1)),
+                          half.width());
+        }
+        image = std::move(half);
+    }
+    if (image.width() > kThumbnailWidth)
+        image = image.scaledToWidth(kThumbnailWidth, Qt::SmoothTransformation);
+    return image;
+}
+
+// Client-data tag for the grab's damage region. Slot 1 holds the ticket,
+// as in VncClient; slot nullptr is left empty so VncClient's protocol
+// extension handler can tell a grab from a console session.
+static char kGrabTag;
+
+static void grabUpdateCallback(rfbClient *client, int x, int y, int w, int h)
+{
+    auto *damage = static_cast<QRegion *>(rfbClientGetClientData(client, &kGrabTag));
+    if (damage && w > 0 && h > 0)
+        *damage += QRect(x, y, w, h);
+}
+
+// Pool thread. Runs one whole RFB session on fd, which it owns, and returns
+// the first complete frame downscaled. A null image with an empty error
+// means the session was shut down from outside.
+static QImage grabThumbnail(int fd, QByteArray &ticket, const std::atomic<bool> &cancel, QString *error)
+{
+    // RGB565: half the bytes of the console's 32bpp for every non-JPEG
+    // tile, and the input format of PixelKernels::expand565.
+    rfbClient *rfb = rfbGetClient(5, 3, 2);
+    rfb->format.bitsPerPixel = 16;
+    rfb->format.depth        = 16;
+    rfb->format.trueColour   = TRUE;
+    rfb->format.bigEndian    = FALSE;
+    rfb->format.redShift     = 11;
+    rfb->format.greenShift   = 5;
+    rfb->format.blueShift    = 0;
+    rfb->format.redMax       = 0x1f;
+    rfb->format.greenMax     = 0x3f;
+    rfb->format.blueMax      = 0x1f;
+
+    QRegion damage;
+    rfbClientSetClientData(rfb, &kGrabTag, &damage);
+    rfb->GotFrameBufferUpdate = grabUpdateCallback;
+    rfb->serverHost = strdup("socketpair");
+    rfb->serverPort = 0;
+    rfb->sock       = fd;
+    rfb->appData.encodingsString = kThumbnailEncodings;
+    rfb->appData.compressLevel   = kThumbnailCompressLevel;
+    rfb->appData.qualityLevel    = kThumbnailQualityLevel;
+    rfb->appData.enableJPEG      = TRUE;
+    rfb->appData.shareDesktop    = TRUE;
+
+    rfb->GetPassword = [](rfbClient *client) -> char* {
+        char *t = static_cast<char *>(rfbClientGetClientData(client, (void*)1));
+        return t ? strdup(t) : strdup("");
+    };
+    char *ticketSlot = strdup(ticket.constData());
+    ticket.fill(0);
+    ticket.clear();
+    rfbClientSetClientData(rfb, (void*)1, ticketSlot);
+
+    // rfbInitClient sends the first full, non-incremental update request.
+    // It frees rfb (and closes fd) on failure.
+    const bool ok = rfbInitClient(rfb, nullptr, nullptr);
+    if (ok)
+        rfbClientSetClientData(rfb, (void*)1, nullptr);
+    explicit_bzero(ticketSlot, strlen(ticketSlot) + 1);
+    free(ticketSlot);
+    if (!ok) {
+        if (!cancel.load()) *error = QStringLiteral("Failed to connect to VNC server");
+        return {};
+    }
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+    bool complete = false;
+    while (!cancel.load() && elapsed.elapsed() < kGrabTimeoutMs) {
+        if (QRegion(0, 0, rfb->width, rfb->height).subtracted(damage).isEmpty()) {
+            complete = true;
+            break;
+        }
+        const int result = rfb->buffered > 0 ? 1 : WaitForMessage(rfb, kGrabPollUs);
+        if (result == 0) continue;
+        if (result < 0 || !HandleRFBServerMessage(rfb)) {
+            if (!cancel.load()) *error = QStringLiteral("Lost connection to VNC server");
+            break;
+        }
+    }
+
+    QImage image;
+    if (complete) {
+        image = downscaleFrame(reinterpret_cast<const uint16_t *>(rfb->frameBuffer),
+                               rfb->width, rfb->height);
+    } else if (error->isEmpty() && !cancel.load()) {
+        *error = QStringLiteral("Timed out waiting for a frame");
+    }
+    rfbClientCleanup(rfb);
+    return image;
+}
+
+VncThumbnailService::VncThumbnailService(QObject *parent)
+    : QObject(parent)
+    , m_timer(new QTimer(this))
+    , m_watchdog(new QTimer(this))
+{
+    static std::atomic<int> instances { 0 };
+    m_instance = QString::number(++instances);
+    m_clock.start();
+
+    m_timer->setSingleShot(true);
+    connect(m_timer, &QTimer::timeout, this, &VncThumbnailService::startNext);
+    m_watchdog->setSingleShot(true);
+    connect(m_watchdog, &QTimer::timeout, this, [this]() {
+        abortCurrent(QStringLiteral("Timed out"));
+    });
+}
+
+VncThumbnailService::~VncThumbnailService()
+{
+    if (m_cancel) m_cancel->store(true);
+    if (m_grabFd >= 0) ::shutdown(m_grabFd, SHUT_RDWR);
+    m_grab.waitForFinished();
+    if (m_grabFd >= 0) ::close(m_grabFd);
+    m_grabTicket.fill(0);
+    m_grabTicket.clear();
+
+    ThumbnailStore &store = thumbnailStore();
+    QMutexLocker lock(&store.mutex);
+    for (auto it = m_targets.cbegin(); it != m_targets.cend(); ++it)
+        store.images.remove(storeKey(it.key()));
+}
+
+void VncThumbnailService::setActive(bool active)
+{
+    if (m_active == active) return;
+    m_active = active;
+    if (active) {
+        schedule(0);
+    } else {
+        m_timer->stop();
+        abortCurrent(QString());
+    }
+}
+
+void VncThumbnailService::watch(const QString &sessionKey, const QString &node, int vmid)
+{
+    const QString key = targetKey(sessionKey, node, vmid);
+    auto it = m_targets.find(key);
+    if (it == m_targets.end()) {
+        Target target;
+        target.sessionKey = sessionKey;
+        target.node       = node;
+        target.vmid       = vmid;
+        it = m_targets.insert(key, target);
+        m_order.append(key);
+    }
+    if (it->watchers++ > 0) return;
+    // A pending timer is either a budget pause or the next due grab; don't
+    // cut either short.
+    if (m_phase == Phase::Idle && !m_timer->isActive())
+        schedule(0);
+}
+
+void VncThumbnailService::unwatch(const QString &sessionKey, const QString &node, int vmid)
+{
+    auto it = m_targets.find(targetKey(sessionKey, node, vmid));
+    if (it == m_targets.end() || it->watchers == 0) return;
+    if (--it->watchers == 0)
+        it->releasedMs = m_clock.elapsed();
+}
+
+// Forgets targets unwatched for longer than the grace period.
+void VncThumbnailService::dropReleased(qint64 now)
+{
+    bool changed = false;
+    for (int i = m_order.size() - 1; i >= 0; --i) {
+        const QString &key = m_order[i];
+        const Target &target = m_targets[key];
+        if (target.watchers > 0 || now - target.releasedMs < kReleaseGraceMs || key == m_current)
+            continue;
+        changed = changed || target.serial > 0;
+        {
+            ThumbnailStore &store = thumbnailStore();
+            QMutexLocker lock(&store.mutex);
+            store.images.remove(storeKey(key));
+        }
+        m_targets.remove(key);
+        m_order.removeAt(i);
+        if (i < m_cursor) --m_cursor;
+    }
+    if (m_cursor >= m_order.size()) m_cursor = 0;
+    if (changed) emit thumbnailsChanged();
+}
+
+QString VncThumbnailService::url(const QString &sessionKey, const QString &node, int vmid) const
+{
+    const QString key = targetKey(sessionKey, node, vmid);
+    const auto it = m_targets.constFind(key);
+    if (it == m_targets.cend() || it->serial == 0) return QString();
+    // Hex keeps session keys and node names out of URL escaping rules.
+    return QStringLiteral("image://%1/%2/%3")
+        .arg(QLatin1String(VncThumbnailProvider::kId),
+             QString::fromLatin1(storeKey(key).toUtf8().toHex()))
+        .arg(it->serial);
+}
+
+QString VncThumbnailService::storeKey(const QString &key) const
+{
+    return m_instance + QLatin1Char('/') + key;
+}
+
+void VncThumbnailService::schedule(int delayMs)
+{
+    if (!m_active) return;
+    m_timer->start(delayMs);
+}
+
+void VncThumbnailService::startNext()
+{
+    if (!m_active || m_phase != Phase::Idle) return;
+
+    const qint64 now = m_clock.elapsed();
+    dropReleased(now);
+    qint64 nextDue = -1;
+    for (int i = 0; i < m_order.size(); ++i) {
+        const int index = (m_cursor + i) % m_order.size();
+        const Target &target = m_targets[m_order[index]];
+        if (target.watchers == 0) {
+            // Rechecked for removal once its grace period is over.
+            const qint64 dropMs = target.releasedMs + kReleaseGraceMs;
+            if (nextDue < 0 || dropMs < nextDue) nextDue = dropMs;
+            continue;
+        }
+        if (target.dueMs > now) {
+            if (nextDue < 0 || target.dueMs < nextDue) nextDue = target.dueMs;
+            continue;
+        }
+        m_cursor  = (index + 1) % m_order.size();
+        m_current = m_order[index];
+        m_phase   = Phase::Ticket;
+        m_watchdog->start(kStageTimeoutMs);
+        const QString sessionKey = target.sessionKey;
+        const QString node = target.node;
+        const int vmid = target.vmid;
+        emit ticketRequested(sessionKey, node, vmid);
+        return;
+    }
+    if (nextDue >= 0)
+        schedule(int(qMax<qint64>(0, nextDue - now)));
+}
+
+void VncThumbnailService::deliverTicket(const QString &sessionKey, const QString &node, int vmid,
+                                        const QString &host, int apiPort, int vncPort, bool ignoreSsl,
+                                        QByteArray ticket, QByteArray authHeader)
+{
+    // A ticket for a grab that was cancelled or timed out meanwhile.
+    if (m_phase != Phase::Ticket || targetKey(sessionKey, node, vmid) != m_current) {
+        ticket.fill(0);
+        authHeader.fill(0);
+        return;
+    }
+
+    m_phase  = Phase::Grab;
+    m_cancel = std::make_shared<std::atomic<bool>>(false);
+    m_grabTicket = ticket;
+
+    m_proxy = new VncWsProxy(this);
+    m_proxy->setHost(host);
+    m_proxy->setApiPort(apiPort);
+    m_proxy->setNode(node);
+    m_proxy->setKind(ProxmoxConst::Kind::Qemu);
+    m_proxy->setVmid(vmid);
+    m_proxy->setVncPort(vncPort);
+    m_proxy->setIgnoreSsl(ignoreSsl);
+    connect(m_proxy, &VncWsProxy::transportReady, this, &VncThumbnailService::launchGrab);
+    // Once the grab runs, a proxy failure reaches it as EOF on the socket.
+    connect(m_proxy, &VncWsProxy::errorOccurred, this, [this](const QString &message) {
+        if (m_phase == Phase::Grab && m_grabFd < 0)
+            finishGrab(m_current, QImage(), 0, message);
+    });
+    m_proxy->setAuthHeaderSecure(authHeader);
+    m_proxy->setTicketSecure(ticket);
+    ticket.fill(0);
+    authHeader.fill(0);
+    m_proxy->start();
+}
+
+void VncThumbnailService::ticketFailed(const QString &sessionKey, const QString &node, int vmid,
+                                       const QString &message)
+{
+    if (m_phase != Phase::Ticket || targetKey(sessionKey, node, vmid) != m_current) return;
+    finishGrab(m_current, QImage(), 0, message);
+}
+
+void VncThumbnailService::launchGrab(int fd)
+{
+    if (m_phase != Phase::Grab || m_grabFd >= 0) {
+        ::close(fd);
+        return;
+    }
+    // A second descriptor for the same socket: shutting it down wakes a
+    // grab blocked in libvncclient without racing its close().
+    m_grabFd = ::dup(fd);
+
+    auto promise = std::make_shared<QPromise<void>>();
+    m_grab = promise->future();
+    promise->start();
+    QThreadPool::globalInstance()->start(
+        [this, promise, fd, key = m_current, cancel = m_cancel,
+         ticket = std::exchange(m_grabTicket, QByteArray())]() mutable {
+        const qint64 cpuStart = threadCpuUs();
+        QString error;
+        const QImage image = grabThumbnail(fd, ticket, *cancel, &error);
+        const qint64 cpuUs = threadCpuUs() - cpuStart;
+        // The destructor waits for this future, so `this` is still alive;
+        // the queued call is dropped if it is gone by delivery.
+        QMetaObject::invokeMethod(this, [this, key, image, cpuUs, error]() {
+            finishGrab(key, image, cpuUs, error);
+        }, Qt::QueuedConnection);
+        promise->finish();
+    });
+}
+
+// Empty reason: cancelled (popup closed, VM gone), not counted as a failure.
+void VncThumbnailService::abortCurrent(const QString &reason)
+{
+    switch (m_phase) {
+    case Phase::Idle:
+        return;
+    case Phase::Ticket:
+        // A late ticket is burned by deliverTicket.
+        finishGrab(m_current, QImage(), 0, reason);
+        return;
+    case Phase::Grab:
+        if (m_grabFd < 0) {
+            finishGrab(m_current, QImage(), 0, reason);
+            return;
+        }
+        // The grab thread wakes up and reports through finishGrab; unless
+        // cancelled, as a failure.
+        m_cancel->store(reason.isEmpty());
+        ::shutdown(m_grabFd, SHUT_RDWR);
+        return;
+    }
+}
+
+void VncThumbnailService::finishGrab(const QString &grabKey, const QImage &image, qint64 cpuUs,
+                                     const QString &error)
+{
+    if (grabKey != m_current || m_phase == Phase::Idle) return;
+    const QString key = m_current;   // grabKey may alias m_current
+
+    qint64 bytes = 0;
+    if (m_proxy) {
+        const QVariantMap s = m_proxy->stats();
+        bytes = s.value(QStringLiteral("bytesFromServer")).toLongLong()
+              + s.value(QStringLiteral("bytesToServer")).toLongLong();
+        cpuUs += kProxySessionCpuUs + bytes * kProxyCpuNsPerByte / 1000;
+        m_proxy->disconnect(this);
+        m_proxy->stop();
+        m_proxy->deleteLater();
+        m_proxy = nullptr;
+    }
+    if (m_grabFd >= 0) {
+        ::close(m_grabFd);
+        m_grabFd = -1;
+    }
+    m_grabTicket.fill(0);
+    m_grabTicket.clear();
+    m_watchdog->stop();
+    m_phase = Phase::Idle;
+    m_current.clear();
+    m_cancel.reset();
+
+    auto it = m_targets.find(key);
+    if (it != m_targets.end()) {
+        if (!image.isNull()) {
+            {
+                ThumbnailStore &store = thumbnailStore();
+                QMutexLocker lock(&store.mutex);
+                store.images.insert(storeKey(key), image);
+            }
+            it->failures = 0;
+            ++it->serial;
+            it->dueMs = m_clock.elapsed() + kRefreshIntervalMs;
+            emit thumbnailsChanged();
+        } else if (!error.isEmpty()) {
+            qDebug() << "[VncThumbnailService]" << key << error;
+            ++it->failures;
+            it->dueMs = m_clock.elapsed()
+                      + (qint64(kRefreshIntervalMs) << qMin(it->failures, kMaxBackoffShift));
+        }
+        // Cancelled grabs keep their due time.
+    }
+
+    // Pause long enough for this grab's cost to average out to the budgets.
+    const qint64 cpuGapMs   = cpuUs / kCpuBudgetPermille;
+    const qint64 bytesGapMs = bytes * 1000 / kBandwidthBudgetBytesPerSec;
+    schedule(int(qMax<qint64>(kMinGapMs, qMax(cpuGapMs, bytesGapMs))));
+}
+
+VncThumbnailProvider::VncThumbnailProvider()
+    : QQuickImageProvider(QQuickImageProvider::Image)
+{
+}
+
+QImage VncThumbnailProvider::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
+{
+    // id is "<hex store key>/<serial>"; the serial only defeats the cache.
+    const QString hex = id.left(id.lastIndexOf(QLatin1Char('/')));
+    const QString key = QString::fromUtf8(QByteArray::fromHex(hex.toLatin1()));
+    QImage image;
+    {
+        ThumbnailStore &store = thumbnailStore();
+        QMutexLocker lock(&store.mutex);
+        image = store.images.value(key);
+    }
+    if (size) *size = image.size();
+    if (!image.isNull() && requestedSize.isValid())
+        image = image.scaled(requestedSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    return image;
+}
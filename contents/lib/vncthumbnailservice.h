@@ -0,0 +1,103 @@
+#pragma once
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QQuickImageProvider>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <memory>
+
+class QTimer;
+class VncWsProxy;
+
+// Live low-resolution screens for the guest list. Runs at most one short
+// RFB session at a time, round-robin over the watched VMs: fetch a vncproxy
+// ticket, open a VncWsProxy, take one low-quality 16bpp frame, downscale it
+// and hang up. The pause after each grab is sized so the average CPU time
+// (the grab thread's, plus an estimate for the proxy's TLS work) and bytes
+// on the wire stay within fixed budgets. Nothing runs while inactive (the
+// popup is closed). Off by default: every grab is a new TLS and RFB session. GUI thread only; see docs/ARCHITECTURE.md.
+class VncThumbnailService : public QObject {
+    Q_OBJECT
+
+public:
+    explicit VncThumbnailService(QObject *parent = nullptr);
+    ~VncThumbnailService() override;
+
+    bool isActive() const { return m_active; }
+    void setActive(bool active);
+
+    // Running qemu VMs shown in the list, reference counted per row. sessionKey
+    // is empty in single mode. A VM nobody watches keeps its thumbnail for a
+    // grace period, so a refresh that rebuilds the rows doesn't drop them.
+    void watch(const QString &sessionKey, const QString &node, int vmid);
+    void unwatch(const QString &sessionKey, const QString &node, int vmid);
+    // image:// URL of the latest thumbnail; empty until one was grabbed.
+    QString url(const QString &sessionKey, const QString &node, int vmid) const;
+
+    // Answers to ticketRequested(), from the controller's vncproxy replies.
+    void deliverTicket(const QString &sessionKey, const QString &node, int vmid,
+                       const QString &host, int apiPort, int vncPort, bool ignoreSsl,
+                       QByteArray ticket, QByteArray authHeader);
+    void ticketFailed(const QString &sessionKey, const QString &node, int vmid,
+                      const QString &message);
+
+signals:
+    void ticketRequested(const QString &sessionKey, const QString &node, int vmid);
+    // Some url() changed.
+    void thumbnailsChanged();
+
+private:
+    struct Target {
+        QString sessionKey;
+        QString node;
+        int     vmid      = 0;
+        qint64  dueMs     = 0;      // on m_clock
+        int     failures  = 0;
+        int     serial    = 0;      // 0: no image yet
+        int     watchers  = 0;
+        qint64  releasedMs = 0;     // when watchers dropped to 0
+    };
+    enum class Phase { Idle, Ticket, Grab };
+
+    void schedule(int delayMs);
+    void startNext();
+    void dropReleased(qint64 now);
+    void launchGrab(int fd);
+    void finishGrab(const QString &grabKey, const QImage &image, qint64 cpuUs, const QString &error);
+    void abortCurrent(const QString &reason);
+    QString storeKey(const QString &key) const;
+
+    QHash<QString, Target> m_targets;
+    QStringList m_order;                // round-robin order of m_targets keys
+    int         m_cursor = 0;
+    bool        m_active = false;
+
+    Phase       m_phase = Phase::Idle;
+    QString     m_current;              // key being grabbed
+    VncWsProxy *m_proxy = nullptr;
+    QByteArray  m_grabTicket;           // VNC password for the grab thread
+    QFuture<void> m_grab;               // on the global QThreadPool
+    int         m_grabFd = -1;          // dup of the grab's socket, for shutdown()
+    std::shared_ptr<std::atomic<bool>> m_cancel;
+
+    QTimer       *m_timer    = nullptr; // next grab
+    QTimer       *m_watchdog = nullptr; // ticket + grab stage limit
+    QElapsedTimer m_clock;
+    QString       m_instance;           // keeps several applets apart in the shared store
+};
+
+// Serves "image://proxmonthumbs/<key>/<serial>" from the thumbnails the
+// services have grabbed. Registered once per engine by the plugin.
+class VncThumbnailProvider : public QQuickImageProvider {
+public:
+    static constexpr const char *kId = "proxmonthumbs";
+
+    VncThumbnailProvider();
+    QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize) override;
+};
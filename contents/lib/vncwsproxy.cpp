@@ -1,40 +1,197 @@
 #include "vncwsproxy.h"
 
+#include "consoleiothread.h"
+
+#include <QElapsedTimer>
+#include <QLocalSocket>
 #include <QNetworkRequest>
+#include <QPointer>
 #include <QSslConfiguration>
+#include <QThread>
+#include <QTimer>
+#include <QUrl>
 #include <QUrlQuery>
+#include <QWebSocket>
 #include <QDebug>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <utility>
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Ping interval for RTT and throughput sampling. Short enough to follow a
+// VPN that degrades mid-session, long enough to be free.
+static constexpr int kLinkSampleIntervalMs = 2000;
+// Below this many bytes in an interval the console was idle or trickling
+// and the byte rate says nothing about the link: about 2.6 Mbit/s over
+// one interval.
+static constexpr qint64 kMinThroughputSampleBytes = 640 * 1024;
+
+// Flow control. WS → libvncclient: once this much is queued on the
+// socketpair, stop reading the WebSocket until bytesWritten brings it under
+// the low mark. Its TCP socket (read buffer capped) fills and TCP flow
+// control pushes back on the server; nothing on the I/O thread waits.
+// The pause relies on Qt internals: QWebSocket's transport being a direct
+// QAbstractSocket child (see pauseWsRead). Without it the pause is counted
+// as unavailable and this direction is unbounded again.
+static constexpr qint64 kLocalWriteHighWater = 4 * 1024 * 1024;
+static constexpr qint64 kLocalWriteLowWater  = 1 * 1024 * 1024;
+static constexpr qint64 kWsReadBufferSize    = 1 * 1024 * 1024;
+// libvncclient → WS: stop reading the socketpair while this much is unsent
+// on the WebSocket, resume below the low mark. With a bounded local read
+// buffer the kernel buffer fills and libvncclient's writes block instead.
+static constexpr qint64 kWsSendHighWater     = 1 * 1024 * 1024;
+static constexpr qint64 kWsSendLowWater      = 256 * 1024;
+static constexpr qint64 kWsSendChunk         = 64 * 1024;
+static constexpr qint64 kLocalReadBufferSize = 1 * 1024 * 1024;
+
+// Everything that touches a socket. Lives on consoleIoThread(); the facade
+// reaches it only through queued calls and hears back through queued
+// signals, so a stalled GUI thread never stalls the byte stream.
+class VncWsProxyWorker : public QObject {
+    Q_OBJECT
+public:
+    struct Session {
+        QString    host;
+        int        apiPort = 8006;
+        QString    node;
+        QString    kind;
+        int        vmid    = 0;
+        int        vncPort = 0;
+        bool       ignoreSsl = false;
+        QByteArray ticket;
+        QByteArray authHeader;
+        int        localFd = -1;
+    };
+
+    VncWsProxyWorker();
+    ~VncWsProxyWorker() override;
+
+    // Takes the credentials out of session (moved, not copied) so the
+    // worker holds the only reference until onWsConnected burns them.
+    void start(Session &session);
+    void stop();
+    // Safe from any thread: counters are atomics.
+    QVariantMap stats() const;
+
+signals:
+    void wsConnected();
+    void errorOccurred(const QString &message);
+    // Once per sampling interval; throughputMeasured is false when the
+    // interval carried too little traffic to count.
+    void linkSampled(int rttMs, int throughputKbps, bool throughputMeasured);
+
+private:
+    void cleanup();
+    QUrl buildWsUrl(const Session &session) const;
+
+    void onWsConnected();
+    void onWsBinaryMessage(const QByteArray &data);
+    void onWsError(QAbstractSocket::SocketError error);
+    void onWsSslErrors(const QList<QSslError> &errors);
+    void onLocalReadyRead();
+    void onLocalBytesWritten(qint64 bytes);
+    void onLocalDisconnected();
+    void onWsDisconnected();
+    void onWsPong(quint64 elapsedTime, const QByteArray &payload);
+    void onWsBytesWritten(qint64 bytes);
+    void sampleLink();
+    void pauseWsRead();
+    void resumeWsRead();
+
+    QByteArray m_ticket;
+    QByteArray m_authHeader;
+
+    QLocalSocket *m_local    = nullptr;   // proxy end of the socketpair
+    QWebSocket   *m_ws       = nullptr;
+    // QWebSocket's TCP/TLS socket; held only while its reads are paused.
+    QPointer<QAbstractSocket> m_wsTransport;
+
+    // Flow control. m_wsOutstanding approximates QWebSocket's unsent bytes
+    // (it has no bytesToWrite()); the peaks are the high-water marks.
+    qint64        m_wsOutstanding      = 0;
+    bool          m_localReadPaused    = false;
+    bool          m_wsReadPaused       = false;
+    std::atomic<qint64>  m_wsToLocalPeak{0};
+    std::atomic<qint64>  m_localToWsPeak{0};
+    std::atomic<quint64> m_wsReadPauses{0};
+    std::atomic<quint64> m_wsReadPauseUnavailable{0};   // transport not found
+    std::atomic<quint64> m_localReadPauses{0};
+    // Payload bytes relayed since start(), per direction.
+    std::atomic<quint64> m_bytesFromServer{0};
+    std::atomic<quint64> m_bytesToServer{0};
+
+    QTimer       *m_linkTimer  = nullptr;
+    QElapsedTimer m_linkClock;
+    qint64        m_rxBytes    = 0;     // since the last sample
+    int           m_rttMs      = -1;
+    int           m_throughputKbps = 0;
+};
+
+// Facade — GUI thread
 
 VncWsProxy::VncWsProxy(QObject *parent)
     : QObject(parent)
-    , m_server(new QTcpServer(this))
+    , m_worker(new VncWsProxyWorker)
 {
-    connect(m_server, &QTcpServer::newConnection, this, &VncWsProxy::onNewConnection);
+    m_worker->moveToThread(consoleIoThread());
+    connect(m_worker, &VncWsProxyWorker::wsConnected,   this, &VncWsProxy::connected);
+    connect(m_worker, &VncWsProxyWorker::errorOccurred, this, &VncWsProxy::errorOccurred);
+    connect(m_worker, &VncWsProxyWorker::linkSampled,   this, &VncWsProxy::onLinkSampled);
 }
 
 VncWsProxy::~VncWsProxy()
 {
-    cleanup();
+    // The worker's destructor tears the sockets down on the I/O thread.
+    m_worker->deleteLater();
+    m_authHeader.fill(0);
+    m_authHeader.clear();
+    m_ticket.fill(0);
+    m_ticket.clear();
 }
 
 // Public API
 void VncWsProxy::start()
 {
-    // Clean up any prior session before re-starting.
-    cleanup();
-
-    if (!m_server->listen(QHostAddress::LocalHost, 0)) {
-        emit errorOccurred(QStringLiteral("VncWsProxy: failed to bind local TCP server: %1")
-                               .arg(m_server->errorString()));
+    // One end stays with the worker, the other becomes libvncclient's
+    // rfb->sock. Bytes cross the kernel once per direction, there is no
+    // accept round trip, and no other process can reach an unnamed socketpair.
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) {
+        emit errorOccurred(QStringLiteral("VncWsProxy: failed to create transport: %1")
+                               .arg(QString::fromLocal8Bit(strerror(errno))));
         return;
     }
 
-    emit ready(m_server->serverPort());
+    // Hand the credentials over by move: after this the facade holds no
+    // copy, and the worker burns its own in onWsConnected.
+    VncWsProxyWorker::Session session;
+    session.host       = m_host;
+    session.apiPort    = m_apiPort;
+    session.node       = m_node;
+    session.kind       = m_kind;
+    session.vmid       = m_vmid;
+    session.vncPort    = m_vncPort;
+    session.ignoreSsl  = m_ignoreSsl;
+    session.ticket     = std::exchange(m_ticket, QByteArray());
+    session.authHeader = std::exchange(m_authHeader, QByteArray());
+    session.localFd    = fds[0];
+
+    VncWsProxyWorker *worker = m_worker;
+    QMetaObject::invokeMethod(worker, [worker, session = std::move(session)]() mutable {
+        worker->start(session);
+    }, Qt::QueuedConnection);
+
+    // The WS handshake and the RFB client start in parallel; anything
+    // libvncclient writes before the WS is up waits in the socket buffer.
+    emit transportReady(fds[1]);
 }
 
 void VncWsProxy::stop()
 {
-    cleanup();
+    QMetaObject::invokeMethod(m_worker, &VncWsProxyWorker::stop, Qt::QueuedConnection);
 }
 
 void VncWsProxy::setAuthHeaderSecure(const QByteArray &header)
@@ -47,88 +204,152 @@ void VncWsProxy::setTicketSecure(const QByteArray &ticket)
     m_ticket = ticket;
 }
 
-// Private helpers
-
-QUrl VncWsProxy::buildWsUrl() const
+QVariantMap VncWsProxy::stats() const
 {
-    // wss://host:apiPort/api2/json/nodes/{node}/{kind}/{vmid}/vncwebsocket
-    //   ?port={vncPort}&vncticket={urlEncoded(ticket)}
-    QUrl url;
-    url.setScheme(m_ignoreSsl ? QStringLiteral("ws") : QStringLiteral("wss"));
-    url.setHost(m_host);
-    url.setPort(m_apiPort);
-    url.setPath(QStringLiteral("/api2/json/nodes/%1/%2/%3/vncwebsocket")
-                    .arg(m_node, m_kind).arg(m_vmid));
-
-    QUrlQuery q;
-    q.addQueryItem(QStringLiteral("port"),       QString::number(m_vncPort));
-    // Percent-encode the ticket so that base64 '+' characters aren't
-    // misread as spaces by Proxmox's form-URL decoder (same fix as LxcTerminal).
-    // m_ticket is a QByteArray; percent-encoded output is ASCII-safe so fromLatin1 is correct.
-    q.addQueryItem(QStringLiteral("vncticket"),
-                   QString::fromLatin1(m_ticket.toPercentEncoding()));
-    url.setQuery(q);
-    return url;
+    QVariantMap s = m_worker->stats();
+    s.insert(QStringLiteral("rttMs"),          m_rttMs);
+    s.insert(QStringLiteral("throughputKbps"), m_throughputKbps);
+    return s;
 }
 
-void VncWsProxy::cleanup()
+void VncWsProxy::onLinkSampled(int rttMs, int throughputKbps, bool throughputMeasured)
 {
-    if (m_tcp) {
-        m_tcp->disconnect(this);
-        m_tcp->abort();
-        m_tcp->deleteLater();
-        m_tcp = nullptr;
-    }
-    if (m_ws) {
-        m_ws->disconnect(this);
-        m_ws->abort();
-        m_ws->deleteLater();
-        m_ws = nullptr;
-    }
-    if (m_server->isListening()) {
-        m_server->close();
+    if (m_rttMs != rttMs || m_throughputKbps != throughputKbps) {
+        m_rttMs = rttMs;
+        m_throughputKbps = throughputKbps;
+        emit linkStatsChanged();
     }
+    emit linkSampled(rttMs, throughputMeasured ? throughputKbps : -1);
 }
 
-// Slots — incoming TCP connection from libvncclient
+// Worker — console I/O thread
 
-void VncWsProxy::onNewConnection()
+VncWsProxyWorker::VncWsProxyWorker()
+    : m_linkTimer(new QTimer(this))
 {
-    // Accept exactly one connection; stop listening immediately.
-    m_tcp = m_server->nextPendingConnection();
-    m_server->close();
+    m_linkTimer->setInterval(kLinkSampleIntervalMs);
+    connect(m_linkTimer, &QTimer::timeout, this, &VncWsProxyWorker::sampleLink);
+}
 
-    connect(m_tcp, &QTcpSocket::readyRead,    this, &VncWsProxy::onTcpReadyRead);
-    connect(m_tcp, &QTcpSocket::disconnected, this, &VncWsProxy::onTcpDisconnected);
+VncWsProxyWorker::~VncWsProxyWorker()
+{
+    cleanup();
+}
+
+void VncWsProxyWorker::start(Session &session)
+{
+    // Clean up any prior session before re-starting.
+    cleanup();
+    m_ticket     = std::exchange(session.ticket, QByteArray());
+    m_authHeader = std::exchange(session.authHeader, QByteArray());
+    m_bytesFromServer.store(0, std::memory_order_relaxed);
+    m_bytesToServer.store(0, std::memory_order_relaxed);
+
+    m_local = new QLocalSocket(this);
+    if (!m_local->setSocketDescriptor(session.localFd)) {
+        // libvncclient's end is closed by VncClient and sees EOF.
+        ::close(session.localFd);
+        delete m_local;
+        m_local = nullptr;
+        cleanup();
+        emit errorOccurred(QStringLiteral("VncWsProxy: failed to adopt transport socket"));
+        return;
+    }
+    m_local->setReadBufferSize(kLocalReadBufferSize);
+    connect(m_local, &QLocalSocket::readyRead,    this, &VncWsProxyWorker::onLocalReadyRead);
+    connect(m_local, &QLocalSocket::bytesWritten, this, &VncWsProxyWorker::onLocalBytesWritten);
+    connect(m_local, &QLocalSocket::disconnected, this, &VncWsProxyWorker::onLocalDisconnected);
 
     m_ws = new QWebSocket(QString(), QWebSocketProtocol::VersionLatest, this);
+    m_ws->setReadBufferSize(kWsReadBufferSize);
 
-    if (m_ignoreSsl) {
+    if (session.ignoreSsl) {
         // Mirror LxcTerminal's approach: modify the existing socket config.
         QSslConfiguration cfg = m_ws->sslConfiguration();
         cfg.setPeerVerifyMode(QSslSocket::VerifyNone);
         m_ws->setSslConfiguration(cfg);
-        connect(m_ws, &QWebSocket::sslErrors, this, &VncWsProxy::onWsSslErrors);
+        connect(m_ws, &QWebSocket::sslErrors, this, &VncWsProxyWorker::onWsSslErrors);
     }
 
-    connect(m_ws, &QWebSocket::connected,             this, &VncWsProxy::onWsConnected);
-    connect(m_ws, &QWebSocket::binaryMessageReceived, this, &VncWsProxy::onWsBinaryMessage);
-    connect(m_ws, &QWebSocket::disconnected,          this, &VncWsProxy::onWsDisconnected);
-    connect(m_ws, &QWebSocket::errorOccurred,         this, &VncWsProxy::onWsError);
+    connect(m_ws, &QWebSocket::connected,             this, &VncWsProxyWorker::onWsConnected);
+    connect(m_ws, &QWebSocket::binaryMessageReceived, this, &VncWsProxyWorker::onWsBinaryMessage);
+    connect(m_ws, &QWebSocket::disconnected,          this, &VncWsProxyWorker::onWsDisconnected);
+    connect(m_ws, &QWebSocket::errorOccurred,         this, &VncWsProxyWorker::onWsError);
+    connect(m_ws, &QWebSocket::pong,                  this, &VncWsProxyWorker::onWsPong);
+    connect(m_ws, &QWebSocket::bytesWritten,          this, &VncWsProxyWorker::onWsBytesWritten);
 
     // Build the upgrade request with the auth header.
     // Do NOT set Sec-WebSocket-Protocol: Proxmox doesn't advertise "binary"
     // in its 101 response, which causes Qt to reject the handshake.
-    QNetworkRequest req(buildWsUrl());
+    QNetworkRequest req(buildWsUrl(session));
     if (!m_authHeader.isEmpty()) {
         req.setRawHeader("Authorization", m_authHeader);
     }
     m_ws->open(req);
 }
 
+void VncWsProxyWorker::stop()
+{
+    cleanup();
+}
+
+// Private helpers
+
+QUrl VncWsProxyWorker::buildWsUrl(const Session &session) const
+{
+    // wss://host:apiPort/api2/json/nodes/{node}/{kind}/{vmid}/vncwebsocket
+    //   ?port={vncPort}&vncticket={urlEncoded(ticket)}
+    QUrl url;
+    url.setScheme(session.ignoreSsl ? QStringLiteral("ws") : QStringLiteral("wss"));
+    url.setHost(session.host);
+    url.setPort(session.apiPort);
+    url.setPath(QStringLiteral("/api2/json/nodes/%1/%2/%3/vncwebsocket")
+                    .arg(session.node, session.kind).arg(session.vmid));
+
+    QUrlQuery q;
+    q.addQueryItem(QStringLiteral("port"),       QString::number(session.vncPort));
+    // Percent-encode the ticket so that base64 '+' characters aren't
+    // misread as spaces by Proxmox's form-URL decoder (same fix as LxcTerminal).
+    // m_ticket is a QByteArray; percent-encoded output is ASCII-safe so fromLatin1 is correct.
+    q.addQueryItem(QStringLiteral("vncticket"),
+                   QString::fromLatin1(m_ticket.toPercentEncoding()));
+    url.setQuery(q);
+    return url;
+}
+
+void VncWsProxyWorker::cleanup()
+{
+    // A session torn down before the upgrade completed still holds its
+    // credentials; burn them here rather than leave them for the next start().
+    m_authHeader.fill(0);
+    m_authHeader.clear();
+    m_ticket.fill(0);
+    m_ticket.clear();
+    m_linkTimer->stop();
+    m_rxBytes = 0;
+    m_wsOutstanding = 0;
+    m_localReadPaused = false;
+    m_wsReadPaused = false;
+    if (m_wsTransport) {
+        m_wsTransport->blockSignals(false);
+        m_wsTransport = nullptr;
+    }
+    if (m_local) {
+        m_local->disconnect(this);
+        m_local->abort();
+        m_local->deleteLater();
+        m_local = nullptr;
+    }
+    if (m_ws) {
+        m_ws->disconnect(this);
+        m_ws->abort();
+        m_ws->deleteLater();
+        m_ws = nullptr;
+    }
+}
 
 // Slots — WebSocket events
-void VncWsProxy::onWsConnected()
+void VncWsProxyWorker::onWsConnected()
 {
     // HTTP upgrade complete — auth header and ticket were sent in the
     // handshake request and are no longer needed. Zero then clear both.
@@ -137,20 +358,83 @@ void VncWsProxy::onWsConnected()
     m_ticket.fill(0);
     m_ticket.clear();
     // Flush any bytes libvncclient already wrote while WS was connecting.
-    if (m_tcp && m_tcp->bytesAvailable() > 0) {
-        onTcpReadyRead();
+    if (m_local && m_local->bytesAvailable() > 0) {
+        onLocalReadyRead();
     }
+
+    m_rxBytes = 0;
+    m_linkClock.start();
+    m_linkTimer->start();
+    m_ws->ping();
+    emit wsConnected();
+}
+
+void VncWsProxyWorker::onWsBinaryMessage(const QByteArray &data)
+{
+    // WS → socketpair: forward raw RFB bytes to libvncclient.
+    m_rxBytes += data.size();
+    m_bytesFromServer.fetch_add(quint64(data.size()), std::memory_order_relaxed);
+    if (!m_local || !m_local->isOpen())
+        return;
+
+    m_local->write(data);
+    const qint64 queued = m_local->bytesToWrite();
+    if (queued > m_wsToLocalPeak.load(std::memory_order_relaxed))
+        m_wsToLocalPeak.store(queued, std::memory_order_relaxed);
+    if (queued > kLocalWriteHighWater)
+        pauseWsRead();
+}
+
+// QWebSocket has no read pause and drains its socket on every readyRead.
+// Its transport socket is a direct child; blocking that socket's signals
+// keeps readyRead from reaching it, so the capped read buffer fills and the
+// kernel stops acknowledging. Frames QWebSocket already holds still arrive
+// and are queued — at most one read buffer's worth.
+void VncWsProxyWorker::pauseWsRead()
+{
+    if (m_wsReadPaused || !m_ws) return;
+    m_wsTransport = m_ws->findChild<QAbstractSocket *>(QString(), Qt::FindDirectChildrenOnly);
+    if (!m_wsTransport) {
+        static std::atomic<bool> warned { false };
+        if (!warned.exchange(true))
+            qWarning() << "[VncWsProxy] QWebSocket transport not found; WebSocket reads can't be paused";
+        ++m_wsReadPauseUnavailable;
+        return;
+    }
+    m_wsTransport->blockSignals(true);
+    m_wsReadPaused = true;
+    ++m_wsReadPauses;
 }
 
-void VncWsProxy::onWsBinaryMessage(const QByteArray &data)
+void VncWsProxyWorker::resumeWsRead()
 {
-    // WS → TCP: forward raw RFB bytes to libvncclient.
-    if (m_tcp && m_tcp->isOpen()) {
-        m_tcp->write(data);
+    if (!m_wsReadPaused) return;
+    m_wsReadPaused = false;
+    QAbstractSocket *transport = m_wsTransport.data();
+    m_wsTransport = nullptr;
+    if (!transport) return;
+    transport->blockSignals(false);
+    // Signals are dropped while blocked, not queued: catch up on a close,
+    // replay readyRead for what piled up, and resync the send estimate
+    // (bytesWritten went missing too).
+    if (transport->state() != QAbstractSocket::ConnectedState) {
+        onWsDisconnected();
+        return;
     }
+    m_wsOutstanding = qMin(m_wsOutstanding, transport->bytesToWrite());
+    if (transport->bytesAvailable() > 0)
+        emit transport->readyRead();
+    onWsBytesWritten(0);
 }
 
-void VncWsProxy::onWsError(QAbstractSocket::SocketError /*error*/)
+void VncWsProxyWorker::onLocalBytesWritten(qint64 bytes)
+{
+    Q_UNUSED(bytes)
+    if (m_wsReadPaused && m_local && m_local->bytesToWrite() < kLocalWriteLowWater)
+        resumeWsRead();
+}
+
+void VncWsProxyWorker::onWsError(QAbstractSocket::SocketError /*error*/)
 {
     const QString msg = m_ws ? m_ws->errorString() : QStringLiteral("unknown WS error");
     qWarning() << "[VncWsProxy] WebSocket error:" << msg;
@@ -158,31 +442,97 @@ void VncWsProxy::onWsError(QAbstractSocket::SocketError /*error*/)
     cleanup();
 }
 
-void VncWsProxy::onWsSslErrors(const QList<QSslError> &errors)
+void VncWsProxyWorker::onWsSslErrors(const QList<QSslError> &errors)
 {
     // ignoreSsl is set — suppress all SSL errors.
     Q_UNUSED(errors)
     if (m_ws) m_ws->ignoreSslErrors();
 }
 
-void VncWsProxy::onWsDisconnected()
+void VncWsProxyWorker::onWsPong(quint64 elapsedTime, const QByteArray &payload)
 {
-    // Close the TCP side so libvncclient sees EOF.
-    if (m_tcp) m_tcp->disconnectFromHost();
+    Q_UNUSED(payload)
+    // Reported with the next interval's sample, so each interval is one vote.
+    m_rttMs = int(qMin<quint64>(elapsedTime, INT_MAX));
 }
 
-// Slots — TCP (libvncclient) events
-void VncWsProxy::onTcpReadyRead()
+// Throughput is demand-limited — an idle console moves almost nothing — so
+// only intervals that carried a burst (a full-screen redraw, scrolling)
+// count. Those feed a peak that decays by 10% per counted interval: bursts
+// raise it to what the link actually delivered, and it drifts down if the
+// link gets worse. Quiet intervals leave it alone and report RTT only.
+void VncWsProxyWorker::sampleLink()
 {
-    // TCP → WS: forward raw RFB bytes from libvncclient as binary WS frames.
+    const qint64 elapsedMs = m_linkClock.restart();
+    const bool measured = elapsedMs > 0 && m_rxBytes >= kMinThroughputSampleBytes;
+    if (measured) {
+        const int kbps = int(qMin<qint64>(m_rxBytes * 8 / elapsedMs, INT_MAX));
+        const int decayed = m_throughputKbps - m_throughputKbps / 10;
+        m_throughputKbps = qMax(kbps, decayed);
+    }
+    if (m_rttMs >= 0)
+        emit linkSampled(m_rttMs, m_throughputKbps, measured);
+    m_rxBytes = 0;
+    if (m_ws && m_ws->state() == QAbstractSocket::ConnectedState)
+        m_ws->ping();
+}
+
+void VncWsProxyWorker::onWsDisconnected()
+{
+    // Close our end so libvncclient sees EOF.
+    if (m_local) m_local->disconnectFromServer();
+}
+
+// Slots — socketpair (libvncclient) events
+void VncWsProxyWorker::onLocalReadyRead()
+{
+    // socketpair → WS: forward raw RFB bytes from libvncclient as binary WS frames.
     if (!m_ws || m_ws->state() != QAbstractSocket::ConnectedState) return;
-    const QByteArray data = m_tcp->readAll();
-    if (!data.isEmpty()) {
-        m_ws->sendBinaryMessage(data);
+    while (m_wsOutstanding < kWsSendHighWater) {
+        const QByteArray data = m_local->read(kWsSendChunk);
+        if (data.isEmpty()) {
+            m_localReadPaused = false;
+            return;
+        }
+        m_wsOutstanding += m_ws->sendBinaryMessage(data);
+        m_bytesToServer.fetch_add(quint64(data.size()), std::memory_order_relaxed);
+        if (m_wsOutstanding > m_localToWsPeak.load(std::memory_order_relaxed))
+            m_localToWsPeak.store(m_wsOutstanding, std::memory_order_relaxed);
+    }
+    // WebSocket backed up: leave the rest in the socketpair until
+    // onWsBytesWritten brings us under the low mark.
+    if (!m_localReadPaused) {
+        m_localReadPaused = true;
+        ++m_localReadPauses;
     }
 }
 
-void VncWsProxy::onTcpDisconnected()
+void VncWsProxyWorker::onWsBytesWritten(qint64 bytes)
+{
+    // bytesWritten counts frame headers too, so clamp rather than go negative.
+    m_wsOutstanding = qMax<qint64>(0, m_wsOutstanding - bytes);
+    if (m_localReadPaused && m_wsOutstanding < kWsSendLowWater && m_local) {
+        m_localReadPaused = false;
+        onLocalReadyRead();
+    }
+}
+
+QVariantMap VncWsProxyWorker::stats() const
+{
+    return {
+        { QStringLiteral("wsToLocalPeakBytes"), m_wsToLocalPeak.load(std::memory_order_relaxed) },
+        { QStringLiteral("localToWsPeakBytes"), m_localToWsPeak.load(std::memory_order_relaxed) },
+        { QStringLiteral("wsReadPauses"),       QVariant::fromValue(m_wsReadPauses.load(std::memory_order_relaxed)) },
+        { QStringLiteral("wsReadPauseUnavailable"), QVariant::fromValue(m_wsReadPauseUnavailable.load(std::memory_order_relaxed)) },
+        { QStringLiteral("localReadPauses"),    QVariant::fromValue(m_localReadPauses.load(std::memory_order_relaxed)) },
+        { QStringLiteral("bytesFromServer"),    QVariant::fromValue(m_bytesFromServer.load(std::memory_order_relaxed)) },
+        { QStringLiteral("bytesToServer"),      QVariant::fromValue(m_bytesToServer.load(std::memory_order_relaxed)) },
+    };
+}
+
+void VncWsProxyWorker::onLocalDisconnected()
 {
     if (m_ws) m_ws->close();
 }
+
+#include "vncwsproxy.moc"
@@ -1,14 +1,19 @@
 #pragma once
 
+#include <QByteArray>
 #include <QObject>
-#include <QTcpServer>
-#include <QTcpSocket>
-#include <QWebSocket>
-#include <QUrl>
+#include <QString>
+#include <QVariantMap>
 
-// Bridges a raw-TCP libvncclient connection to the Proxmox vncwebsocket endpoint.
+class VncWsProxyWorker;
+
+// Bridges libvncclient to the Proxmox vncwebsocket endpoint over an
+// in-process socketpair: start() keeps one end and hands the other to
+// VncClient via transportReady(fd). No listening socket is involved.
 // Credentials are delivered via setAuthHeaderSecure / setTicketSecure — never Q_PROPERTYs.
-// Handles exactly one client connection per instance. See docs/ARCHITECTURE.md.
+// Handles exactly one session per start(). The sockets themselves live on
+// consoleIoThread() in a private worker; this object is the GUI-thread facade
+// that QML talks to. See docs/ARCHITECTURE.md.
 
 class VncWsProxy : public QObject {
     Q_OBJECT
@@ -20,6 +25,12 @@ class VncWsProxy : public QObject {
     Q_PROPERTY(int     vmid        READ vmid        WRITE setVmid        NOTIFY vmidChanged)
     Q_PROPERTY(int     vncPort     READ vncPort     WRITE setVncPort     NOTIFY vncPortChanged)
     Q_PROPERTY(bool    ignoreSsl   READ ignoreSsl   WRITE setIgnoreSsl   NOTIFY ignoreSslChanged)
+    // Link measurements of the WebSocket carrying the RFB stream.
+    // rttMs is the last ping/pong round trip (-1 until measured);
+    // throughputKbps is a decaying peak of server→client throughput over
+    // the intervals busy enough to measure it (0 until one was).
+    Q_PROPERTY(int     rttMs          READ rttMs          NOTIFY linkStatsChanged)
+    Q_PROPERTY(int     throughputKbps READ throughputKbps NOTIFY linkStatsChanged)
 
 public:
     explicit VncWsProxy(QObject *parent = nullptr);
@@ -32,6 +43,8 @@ public:
     int     vmid()       const { return m_vmid; }
     int     vncPort()    const { return m_vncPort; }
     bool    ignoreSsl()  const { return m_ignoreSsl; }
+    int     rttMs()          const { return m_rttMs; }
+    int     throughputKbps() const { return m_throughputKbps; }
 
     void setHost(const QString &v)       { if (m_host == v) return;       m_host = v;       emit hostChanged(); }
     void setApiPort(int v)               { if (m_apiPort == v) return;    m_apiPort = v;    emit apiPortChanged(); }
@@ -45,10 +58,22 @@ public:
     Q_INVOKABLE void stop();
     Q_INVOKABLE void setAuthHeaderSecure(const QByteArray &header);
     Q_INVOKABLE void setTicketSecure(const QByteArray &ticket);
+    // Flow-control diagnostics: buffer high-water marks per direction, how
+    // often each side was throttled, bytes relayed each way since start(),
+    // and the current link measurements.
+    Q_INVOKABLE QVariantMap stats() const;
 
 signals:
-    void ready(int localPort);
+    // fd is libvncclient's end of the socketpair; the receiver owns it
+    // (VncClient::connectToSocket closes it when the session ends).
+    void transportReady(int fd);
+    // The WebSocket upgrade completed; RFB bytes flow from here on.
+    void connected();
     void errorOccurred(const QString &message);
+    void linkStatsChanged();
+    // One per sampling interval, after the first RTT is known.
+    // throughputKbps is -1 when the interval was too quiet to measure it.
+    void linkSampled(int rttMs, int throughputKbps);
 
     void hostChanged();
     void apiPortChanged();
@@ -58,19 +83,8 @@ signals:
     void vncPortChanged();
     void ignoreSslChanged();
 
-private slots:
-    void onNewConnection();
-    void onWsConnected();
-    void onWsBinaryMessage(const QByteArray &data);
-    void onWsError(QAbstractSocket::SocketError error);
-    void onWsSslErrors(const QList<QSslError> &errors);
-    void onTcpReadyRead();
-    void onTcpDisconnected();
-    void onWsDisconnected();
-
 private:
-    void cleanup();
-    QUrl buildWsUrl() const;
+    void onLinkSampled(int rttMs, int throughputKbps, bool throughputMeasured);
 
     QString m_host;
     int     m_apiPort   = 8006;
@@ -82,7 +96,8 @@ private:
     QByteArray m_authHeader;
     bool    m_ignoreSsl = false;
 
-    QTcpServer  *m_server    = nullptr;
-    QTcpSocket  *m_tcp       = nullptr;
-    QWebSocket  *m_ws        = nullptr;
+    // Owned; lives on consoleIoThread() and is released with deleteLater.
+    VncWsProxyWorker *m_worker = nullptr;
+    int m_rttMs          = -1;
+    int m_throughputKbps = 0;
 };
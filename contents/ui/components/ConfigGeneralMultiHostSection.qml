@@ -488,6 +488,25 @@ ColumnLayout {
                         }
                     }
 
+                    QQC2.Label {
+                        text: "PBS Parallel Requests:"
+                        visible: pbsEnabledCheck.checked
+                        Layout.alignment: Qt.AlignRight | Qt.AlignVCenter
+                        horizontalAlignment: Text.AlignRight
+                    }
+                    QQC2.SpinBox {
+                        visible: pbsEnabledCheck.checked
+                        from: 1
+                        to: 16
+                        value: card.entry.pbsMaxConcurrent || 4
+                        editable: true
+                        onValueModified: {
+                            var arr = root.ensureMultiHostsLen(5)
+                            arr[card.index].pbsMaxConcurrent = value
+                            root.saveMultiHosts(arr)
+                        }
+                    }
+
                     Item {
                         Layout.columnSpan: 2
                         Layout.fillWidth: true
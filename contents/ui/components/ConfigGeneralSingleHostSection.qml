@@ -22,6 +22,7 @@ GridLayout {
     property alias pbsTrustedCertPath: pbsTrustedCertPathField.text
     property alias pbsWarningDays: pbsWarningDaysField.value
     property alias pbsStaleDays: pbsStaleDaysField.value
+    property alias pbsMaxConcurrent: pbsMaxConcurrentField.value
     property int pbsRefreshInterval: 3600
     signal stashSecret(string secret)
     signal forgetSecret()
@@ -312,6 +313,15 @@ GridLayout {
                 value: 14
                 editable: true
             }
+
+            QQC2.Label { text: "Parallel requests:"; Layout.alignment: Qt.AlignRight | Qt.AlignVCenter; horizontalAlignment: Text.AlignRight }
+            QQC2.SpinBox {
+                id: pbsMaxConcurrentField
+                from: 1
+                to: 16
+                value: 4
+                editable: true
+            }
         }
 
     }
@@ -118,6 +118,8 @@ Rectangle {
                                               && root.ctModel.backupStatus !== 0
                                               && root.ctModel.backupStatus !== 5 // Excluded
             readonly property bool isExcluded: root.ctModel && root.ctModel.backupStatus === 5
+            // Last known state from the backup cache; dimmed until PBS answers.
+            readonly property bool isStale: root.ctModel && root.ctModel.backupStale === true
 
             Layout.fillHeight: true
             Layout.preferredWidth: (hasBackup || isExcluded) ? 50 : 0
@@ -131,6 +133,7 @@ Rectangle {
                 radius: 4
                 anchors.left: parent.left
                 anchors.verticalCenter: parent.verticalCenter
+                opacity: parent.isStale ? 0.4 : 1.0
                 visible: parent.hasBackup
                 color: {
                     switch (root.ctModel ? root.ctModel.backupStatus : 0) {
@@ -151,7 +154,7 @@ Rectangle {
                 text: root.ctModel ? (root.ctModel.lastBackupDisplay || "") : ""
                 font.pixelSize: 10
                 font.family: "JetBrains Mono"
-                opacity: 0.7
+                opacity: parent.isStale ? 0.4 : 0.7
                 visible: parent.hasBackup
                 color: root.ctModel && root.ctModel.verifyState === "failed"
                     ? Kirigami.Theme.negativeTextColor
@@ -45,6 +45,9 @@ ColumnLayout {
     property var onAction: null
     property var onConsole: null
     property bool consoleEnabled: true
+    property bool thumbnailsEnabled: false
+    property var thumbnailSource: null
+    property var watchThumbnail: null
     property bool powerActionsEnabled: true
 
     Layout.fillWidth: true
@@ -146,6 +149,9 @@ ColumnLayout {
             onConsole: root.onConsole
             consoleEnabled: root.consoleEnabled
             powerActionsEnabled: root.powerActionsEnabled
+            thumbnailsEnabled: root.thumbnailsEnabled
+            thumbnailSource: root.thumbnailSource
+            watchThumbnail: root.watchThumbnail
         }
     }
 }
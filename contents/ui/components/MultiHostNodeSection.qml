@@ -42,6 +42,9 @@ ColumnLayout {
     property var onAction: null
     property var onConsole: null
     property bool consoleEnabled: true
+    property bool thumbnailsEnabled: false
+    property var thumbnailSource: null
+    property var watchThumbnail: null
     property bool powerActionsEnabled: true
 
     Layout.fillWidth: true
@@ -230,6 +233,13 @@ ColumnLayout {
                     }
                     consoleEnabled: root.consoleEnabled
                     powerActionsEnabled: root.powerActionsEnabled
+                    thumbnailsEnabled: root.thumbnailsEnabled
+                    thumbnailSource: function(nodeName, vmid) {
+                        return typeof root.thumbnailSource === "function" ? root.thumbnailSource(root.sessionKey, nodeName, vmid) : ""
+                    }
+                    watchThumbnail: function(watch, nodeName, vmid) {
+                        if (typeof root.watchThumbnail === "function") root.watchThumbnail(root.sessionKey, watch, nodeName, vmid)
+                    }
                 }
             }
         }
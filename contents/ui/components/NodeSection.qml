@@ -42,6 +42,9 @@ ColumnLayout {
     property var onAction: null
     property var onConsole: null
     property bool consoleEnabled: true
+    property bool thumbnailsEnabled: false
+    property var thumbnailSource: null
+    property var watchThumbnail: null
     property bool powerActionsEnabled: true
 
     Layout.fillWidth: true
@@ -222,6 +225,9 @@ ColumnLayout {
                     onConsole: root.onConsole
                     consoleEnabled: root.consoleEnabled
                     powerActionsEnabled: root.powerActionsEnabled
+                    thumbnailsEnabled: root.thumbnailsEnabled
+                    thumbnailSource: root.thumbnailSource
+                    watchThumbnail: root.watchThumbnail
                 }
             }
         }
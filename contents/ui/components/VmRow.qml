@@ -31,6 +31,37 @@ Rectangle {
     property var onConsole: null
     property bool consoleEnabled: true
     property bool powerActionsEnabled: true
+    // Live screen preview (controller's VncThumbnailService).
+    // thumbnailSource(nodeName, vmid) returns an image:// URL or "";
+    // watchThumbnail(watch, nodeName, vmid) registers the row while it wants one.
+    property bool thumbnailsEnabled: false
+    property var thumbnailSource: null
+    property var watchThumbnail: null
+    readonly property bool thumbnailWanted: thumbnailsEnabled && consoleEnabled && visible
+                                            && !!vmModel && vmModel.status === "running"
+    property var watchedThumbnail: null // {node, vmid} while registered
+
+    function updateThumbnailWatch() {
+        var want = thumbnailWanted && typeof watchThumbnail === "function"
+        var current = watchedThumbnail
+        if (current && (!want || current.node !== nodeName || current.vmid !== vmModel.vmid)) {
+            if (typeof watchThumbnail === "function") watchThumbnail(false, current.node, current.vmid)
+            watchedThumbnail = null
+        }
+        if (want && !watchedThumbnail) {
+            watchedThumbnail = { node: nodeName, vmid: vmModel.vmid }
+            watchThumbnail(true, nodeName, vmModel.vmid)
+        }
+    }
+
+    onThumbnailWantedChanged: updateThumbnailWatch()
+    onNodeNameChanged: updateThumbnailWatch()
+    onVmModelChanged: updateThumbnailWatch()
+    Component.onCompleted: updateThumbnailWatch()
+    Component.onDestruction: {
+        if (watchedThumbnail && typeof watchThumbnail === "function")
+            watchThumbnail(false, watchedThumbnail.node, watchedThumbnail.vmid)
+    }
 
     Layout.fillWidth: true
     Layout.preferredHeight: uiRowHeight
@@ -53,6 +84,29 @@ Rectangle {
             color: root.vmModel && root.vmModel.status === "running" ? root.uiRunningColor : root.uiStoppedColor
         }
 
+        Image {
+            id: vmThumbnail
+            readonly property string url: root.thumbnailWanted && typeof root.thumbnailSource === "function"
+                ? root.thumbnailSource(root.nodeName, root.vmModel.vmid)
+                : ""
+            visible: url !== ""
+            source: url
+            fillMode: Image.PreserveAspectFit
+            smooth: true
+            Layout.preferredHeight: root.uiRowHeight - 6
+            Layout.preferredWidth: visible ? Math.round(Layout.preferredHeight * 16 / 10) : 0
+
+            HoverHandler { id: thumbnailHover }
+
+            PlasmaComponents.ToolTip {
+                visible: thumbnailHover.hovered
+                contentItem: Image {
+                    source: vmThumbnail.source
+                    fillMode: Image.PreserveAspectFit
+                }
+            }
+        }
+
         PlasmaComponents.Label {
             text: root.vmModel
                 ? (root.anonymizeVmId(root.vmModel.vmid, root.vmIndex) + ": " + root.anonymizeVmName(root.vmModel.name, root.vmIndex))
@@ -119,6 +173,8 @@ Rectangle {
                                               && root.vmModel.backupStatus !== 0
                                               && root.vmModel.backupStatus !== 5 // Excluded
             readonly property bool isExcluded: root.vmModel && root.vmModel.backupStatus === 5
+            // Last known state from the backup cache; dimmed until PBS answers.
+            readonly property bool isStale: root.vmModel && root.vmModel.backupStale === true
 
             Layout.fillHeight: true
             Layout.preferredWidth: (hasBackup || isExcluded) ? 50 : 0
@@ -132,6 +188,7 @@ Rectangle {
                 radius: 4
                 anchors.left: parent.left
                 anchors.verticalCenter: parent.verticalCenter
+                opacity: parent.isStale ? 0.4 : 1.0
                 visible: parent.hasBackup
                 color: {
                     switch (root.vmModel ? root.vmModel.backupStatus : 0) {
@@ -152,7 +209,7 @@ Rectangle {
                 text: root.vmModel ? (root.vmModel.lastBackupDisplay || "") : ""
                 font.pixelSize: 10
                 font.family: "JetBrains Mono"
-                opacity: 0.7
+                opacity: parent.isStale ? 0.4 : 0.7
                 visible: parent.hasBackup
                 color: root.vmModel && root.vmModel.verifyState === "failed"
                     ? Kirigami.Theme.negativeTextColor
@@ -1,6 +1,7 @@
 // qmllint disable import missing-property unresolved-type unused-imports unqualified
 import QtQuick
 import QtQuick.Window
+import QtQuick.Layouts
 import org.kde.plasma.components as PlasmaComponents
 import "../../lib/proxmox" as ProxMon
 
@@ -20,9 +21,70 @@ Window {
     // Controller reference — used to deliver the auth header directly in C++
     // without passing it through the QML/JS heap.
     property var    controller: null
+    // Stage -> ms since the open was requested, from consoleOpenTimed.
+    property var    openTimeline: null
+    property bool   firstFrameSeen: false
+    // Performance HUD: rates over the last second, from the stats() of the
+    // client, the proxy and the view. Off by default; nothing is polled
+    // while it is hidden.
+    property bool   hudVisible: false
+    property var    hudSample: null
+    property var    hud: null
     signal requestReconnect()
 
+    function sampleHud() {
+        var sample = {
+            time:   Date.now(),
+            client: vncClient.stats(),
+            proxy:  wsProxy.stats(),
+            view:   vncCanvas.stats()
+        }
+        var prev = hudSample
+        hudSample = sample
+        if (!prev) return
+        var dt = (sample.time - prev.time) / 1000
+        if (dt <= 0) return
+        // Counters restart with a new session; never show negative rates.
+        function delta(group, key) {
+            return Math.max(0, Number(sample[group][key] || 0) - Number(prev[group][key] || 0))
+        }
+        var messages = delta("client", "serverMessages")
+        var uploads = delta("view", "uploads")
+        var latencySamples = delta("client", "inputLatencySamples")
+        hud = {
+            updates:   delta("client", "framesPublished") / dt,
+            displayed: delta("client", "framesDisplayed") / dt,
+            dropped:   delta("client", "framesDropped") / dt,
+            down:      delta("proxy", "bytesFromServer") / dt,
+            up:        delta("proxy", "bytesToServer") / dt,
+            handleMs:  messages > 0 ? delta("client", "handleUs") / messages / 1000 : 0,
+            uploadMs:  uploads > 0 ? delta("view", "uploadUs") / uploads / 1000 : 0,
+            latencyMs: latencySamples > 0
+                       ? delta("client", "inputLatencyUs") / latencySamples / 1000
+                       : Number(sample.client.inputLatencyLastUs) / 1000
+        }
+    }
+
+    function formatRate(bytesPerSecond) {
+        if (bytesPerSecond >= 1024 * 1024) return (bytesPerSecond / (1024 * 1024)).toFixed(1) + " MiB/s"
+        return (bytesPerSecond / 1024).toFixed(1) + " KiB/s"
+    }
+
+    function markStage(stage) {
+        if (controller)
+            controller.markConsoleStage(sessionKey, kind, nodeName, vmid, stage)
+    }
+
+    // The window may exist before the vncproxy reply (consoleOpening);
+    // a failed request then has to be shown here.
+    function openFailed(message) {
+        if (vncClient.state !== "connected")
+            statusLabel.text = "Console failed: " + message
+    }
+
     function connectWithTicket(port) {
+        firstFrameSeen  = false
+        hudSample       = null
         vncPort         = port
         wsProxy.vncPort = port
         // Deliver auth header and ticket from C++ registry — never touches JS heap.
@@ -40,10 +102,10 @@ Window {
     minimumHeight: 480
     visible: true
 
-    /* WebSocket-to-TCP shim: libvncclient speaks raw TCP; Proxmox only exposes
-       a WebSocket endpoint (vncwebsocket). VncWsProxy binds a random local TCP
-       port, accepts libvncclient's connection, and bridges bytes over a WS
-       connection to Proxmox — all transparent to libvncclient.
+    /* WebSocket shim: libvncclient speaks a raw byte stream; Proxmox only
+       exposes a WebSocket endpoint (vncwebsocket). VncWsProxy creates a
+       socketpair, hands one end to libvncclient and bridges the other over a
+       WS connection to Proxmox — all transparent to libvncclient.
     */
     ProxMon.VncWsProxy {
         id: wsProxy
@@ -55,23 +117,24 @@ Window {
         vncPort:    consoleWindow.vncPort
         ignoreSsl: consoleWindow.ignoreSsl
 
-        onReady: function(localPort) {
-            // Proxy is listening — hand the local port to libvncclient.
+        onConnected: consoleWindow.markStage("websocket")
+        onTransportReady: function(fd) {
+            // Hand libvncclient its end of the socketpair (it takes ownership).
             // Ticket was already delivered via deliverConsoleTicket before start().
-            vncClient.connectToVnc("127.0.0.1", localPort)
+            vncClient.connectToSocket(fd)
         }
         onErrorOccurred: function(message) {
             statusLabel.text = "Proxy error: " + message
         }
+        // One RTT/throughput sample per interval drives the "auto" profile.
+        onLinkSampled: function(rttMs, throughputKbps) {
+            vncClient.updateLinkEstimate(rttMs, throughputKbps)
+        }
     }
 
     ProxMon.VncClient {
         id: vncClient
 
-        onFrameUpdated: function(image, x, y, w, h) {
-            vncCanvas.updateFrame(image, x, y, w, h)
-        }
-
         onStateChanged: {
             if (state === "error") {
                 statusLabel.text = "Connection lost - reconnecting..."
@@ -80,6 +143,7 @@ Window {
                 statusLabel.text = ""
                 reconnectTimer.stop()
                 consoleWindow.reconnectAttempts = 0
+                consoleWindow.markStage("handshake")
             } else if (state === "connecting") {
                 statusLabel.text = "Connecting..."
             }
@@ -88,7 +152,23 @@ Window {
         onErrorOccurred: function(message) {
             statusLabel.text = message
         }
+        onFrameReady: {
+            if (!consoleWindow.firstFrameSeen) {
+                consoleWindow.firstFrameSeen = true
+                consoleWindow.markStage("firstFrame")
+            }
+        }
     }
+    Timer {
+        id: hudTimer
+        interval: 1000
+        repeat: true
+        triggeredOnStart: true
+        running: consoleWindow.hudVisible && vncClient.state === "connected"
+        onRunningChanged: if (!running) consoleWindow.hudSample = null
+        onTriggered: consoleWindow.sampleHud()
+    }
+
     property int reconnectAttempts: 0
     readonly property int maxReconnectAttempts: 3
     Timer {
@@ -113,12 +193,18 @@ Window {
         ProxMon.VncFrameView {
             id: vncCanvas
             anchors.fill: parent
+            client: vncClient
 
             MouseArea {
                 id: mouseArea
                 anchors.fill: parent
                 acceptedButtons: Qt.AllButtons
                 hoverEnabled: true
+                // The server's cursor is drawn by VncFrameView; hide ours over
+                // the frame so there is only one pointer on screen.
+                property bool pointerInFrame: false
+                cursorShape: (vncClient.hasCursorShape && pointerInFrame) ? Qt.BlankCursor : Qt.ArrowCursor
+                onExited: pointerInFrame = false
 
                 /* Map canvas (window) coords to framebuffer coords using
                    the same aspect-preserving fit math as VncFrameView::paint.
@@ -149,6 +235,7 @@ Window {
                 onPositionChanged: function(mouse) {
                     if (!vncClient || vncClient.state !== "connected") return
                     var p = mapToFrame(mouse.x, mouse.y)
+                    pointerInFrame = p !== null
                     if (!p) return
                     // Each pointer event is a discrete WebSocket frame — no TCP
                     // stream buffering issues, so send every event immediately.
@@ -206,6 +293,110 @@ Window {
             onActiveFocusChanged: if (!activeFocus) vncClient.allKeysUp()
         }
 
+        /* Encoding profile: shows what is in effect and allows pinning it per
+           console. The combo never takes focus so keystrokes keep going to
+           the remote side.
+        */
+        Rectangle {
+            anchors.top: parent.top
+            anchors.right: parent.right
+            anchors.margins: 6
+            width: encodingRow.implicitWidth + 12
+            height: encodingRow.implicitHeight + 8
+            radius: 4
+            color: "#a0000000"
+            visible: vncClient.state === "connected"
+
+            RowLayout {
+                id: encodingRow
+                anchors.centerIn: parent
+                spacing: 6
+
+                PlasmaComponents.Label {
+                    color: "white"
+                    text: {
+                        var label = "Encoding: " + vncClient.activeEncodingProfile
+                        if (vncClient.encodingProfile === "auto") label += " (auto)"
+                        if (wsProxy.rttMs >= 0) label += " · " + wsProxy.rttMs + " ms"
+                        return label
+                    }
+                }
+
+                PlasmaComponents.ToolButton {
+                    focusPolicy: Qt.NoFocus
+                    icon.name: "view-statistics"
+                    checkable: true
+                    checked: consoleWindow.hudVisible
+                    PlasmaComponents.ToolTip { text: "Performance overlay" }
+                    onToggled: {
+                        consoleWindow.hudVisible = checked
+                        vncCanvas.forceActiveFocus()
+                    }
+                }
+
+                PlasmaComponents.ComboBox {
+                    focusPolicy: Qt.NoFocus
+                    textRole: "text"
+                    valueRole: "value"
+                    model: [
+                        { text: "Auto",      value: "auto" },
+                        { text: "LAN",       value: "lan" },
+                        { text: "WAN",       value: "wan" },
+                        { text: "Slow link", value: "slow" }
+                    ]
+                    Component.onCompleted: currentIndex = indexOfValue(vncClient.encodingProfile)
+                    onActivated: {
+                        vncClient.encodingProfile = currentValue
+                        vncCanvas.forceActiveFocus()
+                    }
+                }
+            }
+        }
+
+        /* Performance HUD. Server updates vs displayed fps separates a
+           quiet server from a slow renderer; bytes/s against decode and
+           upload times separates the link from the CPU/GPU side.
+        */
+        Rectangle {
+            anchors.top: parent.top
+            anchors.left: parent.left
+            anchors.margins: 6
+            width: hudText.implicitWidth + 12
+            height: hudText.implicitHeight + 8
+            radius: 4
+            color: "#a0000000"
+            visible: consoleWindow.hudVisible && vncClient.state === "connected"
+
+            PlasmaComponents.Label {
+                id: hudText
+                anchors.centerIn: parent
+                color: "white"
+                font.family: "monospace"
+                text: {
+                    var h = consoleWindow.hud
+                    var lines = []
+                    if (!h) {
+                        lines.push("Measuring...")
+                    } else {
+                        lines.push("Server updates " + h.updates.toFixed(1) + "/s")
+                        lines.push("Displayed      " + h.displayed.toFixed(1) + " fps, "
+                                   + h.dropped.toFixed(1) + "/s dropped")
+                        lines.push("Down           " + consoleWindow.formatRate(h.down))
+                        lines.push("Up             " + consoleWindow.formatRate(h.up))
+                        lines.push("Handling       " + h.handleMs.toFixed(2) + " ms/msg")
+                        lines.push("Upload         " + h.uploadMs.toFixed(2) + " ms/frame")
+                        lines.push("Input→update   "
+                                   + (h.latencyMs >= 0 ? h.latencyMs.toFixed(1) + " ms" : "-"))
+                    }
+                    var t = consoleWindow.openTimeline
+                    if (t && t.firstFrame !== undefined)
+                        lines.push("First frame    " + t.firstFrame + " ms"
+                                   + (t.cachedSecret ? " (cached creds)" : ""))
+                    return lines.join("\n")
+                }
+            }
+        }
+
         PlasmaComponents.Label {
             id: statusLabel
             anchors.centerIn: parent
@@ -217,6 +408,13 @@ Window {
     }
 
     Component.onCompleted: {
+        markStage("window")
+        // Opened ahead of the vncproxy reply: connectWithTicket() starts
+        // the session once consoleReady delivers the port.
+        if (vncPort <= 0) {
+            statusLabel.text = "Requesting console..."
+            return
+        }
         // Deliver auth header and ticket from C++ registry before starting proxy.
         if (controller) {
             controller.deliverConsoleAuth(consoleWindow.sessionKey, wsProxy)
@@ -227,7 +425,7 @@ Window {
 
     onClosing: {
         reconnectTimer.stop()
-        /* Stop the proxy first — this aborts the loopback TCP socket so
+        /* Stop the proxy first — this closes its end of the socketpair so
            rfbInitClient (which is blocked waiting for RFB handshake bytes)
            sees a connection error and exits promptly. Without this, disconnect()
            would block in m_thread->wait() indefinitely because the event loop
@@ -39,6 +39,8 @@ KCM.SimpleKCM {
     property int cfg_pbsBackupStaleDaysDefault: 14
     property int cfg_pbsRefreshInterval: 3600
     property int cfg_pbsRefreshIntervalDefault: 3600
+    property int cfg_pbsMaxConcurrentRequests: 4
+    property int cfg_pbsMaxConcurrentRequestsDefault: 4
     property string cfg_pbsExcludeTag: ""
     property string cfg_pbsExcludeTagDefault: ""
     property string cfg_pbsExcludeVmids: ""
@@ -65,6 +67,8 @@ KCM.SimpleKCM {
     property bool cfg_multiHostSharedCertDefault: true
     property bool cfg_consoleEnabled: true
     property bool cfg_consoleEnabledDefault: true
+    property bool cfg_consoleThumbnails: false
+    property bool cfg_consoleThumbnailsDefault: false
     property bool cfg_powerActionsEnabled: true
     property bool cfg_powerActionsEnabledDefault: true
     property bool cfg_autoRetry: true
@@ -38,6 +38,8 @@ KCM.SimpleKCM {
     property int cfg_pbsBackupStaleDaysDefault: 14
     property int cfg_pbsRefreshInterval: 3600
     property int cfg_pbsRefreshIntervalDefault: 3600
+    property int cfg_pbsMaxConcurrentRequests: 4
+    property int cfg_pbsMaxConcurrentRequestsDefault: 4
     property string cfg_pbsExcludeTag: ""
     property string cfg_pbsExcludeTagDefault: ""
     property string cfg_pbsExcludeVmids: ""
@@ -119,6 +121,8 @@ KCM.SimpleKCM {
     // Console toggle
     property alias cfg_consoleEnabled: consoleEnabledCheck.checked
     property bool cfg_consoleEnabledDefault: true
+    property alias cfg_consoleThumbnails: consoleThumbnailsCheck.checked
+    property bool cfg_consoleThumbnailsDefault: false
 
     // Power actions toggle
     property alias cfg_powerActionsEnabled: powerActionsEnabledCheck.checked
@@ -309,6 +313,23 @@ KCM.SimpleKCM {
             wrapMode: Text.WordWrap
         }
 
+        QQC2.CheckBox {
+            id: consoleThumbnailsCheck
+            text: "Show live VM screen thumbnails"
+            checked: root.cfg_consoleThumbnails
+            onCheckedChanged: root.cfg_consoleThumbnails = checked
+            enabled: consoleEnabledCheck.checked
+            Layout.leftMargin: 35
+        }
+
+        QQC2.Label {
+            text: "Shows a small, periodically refreshed preview of each running VM's screen while the popup is open. Previews are taken one VM at a time, at most every 5 minutes per VM, each over a new encrypted VNC session. Every preview opens a VNC console on the server, which shows up in the Proxmox task log as a \"VNC console\" task."
+            font.pixelSize: 11
+            opacity: 0.6
+            Layout.fillWidth: true
+            wrapMode: Text.WordWrap
+        }
+
         QQC2.CheckBox {
             id: powerActionsEnabledCheck
             text: "Enable power actions (Start / Shutdown / Reboot)"
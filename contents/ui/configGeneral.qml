@@ -37,6 +37,7 @@ KCM.SimpleKCM {
     property alias cfg_pbsBackupWarningDays: singleHostSection.pbsWarningDays
     property alias cfg_pbsBackupStaleDays: singleHostSection.pbsStaleDays
     property alias cfg_pbsRefreshInterval: singleHostSection.pbsRefreshInterval
+    property alias cfg_pbsMaxConcurrentRequests: singleHostSection.pbsMaxConcurrent
     property bool cfg_pbsEnabledDefault: false
     property string cfg_pbsHostDefault: ""
     property int cfg_pbsPortDefault: 8007
@@ -47,6 +48,7 @@ KCM.SimpleKCM {
     property int cfg_pbsBackupWarningDaysDefault: 7
     property int cfg_pbsBackupStaleDaysDefault: 14
     property int cfg_pbsRefreshIntervalDefault: 3600
+    property int cfg_pbsMaxConcurrentRequestsDefault: 4
     property string cfg_apiTokenSecretDefault: ""
     property string cfg_trustedCertPem: ""
     property string cfg_trustedCertPath: ""
@@ -70,6 +72,8 @@ KCM.SimpleKCM {
     // property set instead of warning about missing properties.
     property bool cfg_consoleEnabled: true
     property bool cfg_consoleEnabledDefault: true
+    property bool cfg_consoleThumbnails: false
+    property bool cfg_consoleThumbnailsDefault: false
     property bool cfg_powerActionsEnabled: true
     property bool cfg_powerActionsEnabledDefault: true
     property string cfg_defaultSorting: "status"
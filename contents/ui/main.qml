@@ -75,9 +75,21 @@ PlasmoidItem {
     property string multiHostsJson: Plasmoid.configuration.multiHostsJson || "[]"
     property string multiHostSecretsJson: Plasmoid.configuration.multiHostSecretsJson || "{}"
 
+    // Live VM screen thumbnails in the guest list; grabbed only while the
+    // popup is open. thumbnailGeneration is bumped on every new thumbnail so
+    // bindings that call thumbnailUrl() re-evaluate.
+    readonly property bool thumbnailsEnabled: Plasmoid.configuration.consoleEnabled !== false
+                                              && Plasmoid.configuration.consoleThumbnails === true
+    property int thumbnailGeneration: 0
+
+    function thumbnailUrl(sessionKey, nodeName, vmid) {
+        return root.thumbnailGeneration >= 0 ? controller.thumbnailUrl(sessionKey, nodeName, vmid) : ""
+    }
+
     ProxMon.ProxmoxController {
         id: controller
         connectionMode: root.connectionMode
+        thumbnailsActive: root.expanded && root.thumbnailsEnabled
         host: root.proxmoxHost
         port: root.proxmoxPort
         tokenId: root.apiTokenId
@@ -95,8 +107,14 @@ PlasmoidItem {
         pbsBackupWarningDays: root.pbsBackupWarningDays
         pbsBackupStaleDays: root.pbsBackupStaleDays
         pbsRefreshInterval: root.pbsRefreshInterval
+        pbsMaxConcurrentRequests: root.pbsMaxConcurrentRequests
         pbsExcludeTag: root.pbsExcludeTag
         pbsExcludeVmids: root.pbsExcludeVmids
+        notifyMode: root.notifyMode
+        notifyFilter: root.notifyFilter
+        notifyOnStart: root.notifyOnStart
+        notifyOnStop: root.notifyOnStop
+        notifyOnNodeChange: root.notifyOnNodeChange
         debugEnabled: root.devMode
         ignoreSsl: root.ignoreSsl
         autoRetry: root.autoRetry
@@ -147,6 +165,7 @@ PlasmoidItem {
     property int pbsBackupWarningDays: Math.max(1, Plasmoid.configuration.pbsBackupWarningDays || 7)
     property int pbsBackupStaleDays: Math.max(1, Plasmoid.configuration.pbsBackupStaleDays || 14)
     property int pbsRefreshInterval: Math.max(1800, Plasmoid.configuration.pbsRefreshInterval || 3600)
+    property int pbsMaxConcurrentRequests: Math.max(1, Plasmoid.configuration.pbsMaxConcurrentRequests || 4)
     property string pbsExcludeTag: Plasmoid.configuration.pbsExcludeTag || ""
     property string pbsExcludeVmids: Plasmoid.configuration.pbsExcludeVmids || ""
     property string defaultSorting: Plasmoid.configuration.defaultSorting || "status"
@@ -170,8 +189,6 @@ PlasmoidItem {
     property bool redactNotifyIdentities: Plasmoid.configuration.redactNotifyIdentities !== false
     property bool notifyRateLimitEnabled: Plasmoid.configuration.notifyRateLimitEnabled !== false
     property int notifyRateLimitSeconds: Math.max(0, Plasmoid.configuration.notifyRateLimitSeconds || 120)
-    // key => epoch ms
-    property var notifyLastSent: ({})
 
     // Compact label mode: "cpu" (default), "running", "error", "lastUpdate"
     property string compactMode: Plasmoid.configuration.compactMode || "cpu"
@@ -182,6 +199,10 @@ PlasmoidItem {
     property var displayedProxmoxData: controller.displayedProxmoxData
     property var displayedVmData: controller.displayedVmData
     property var displayedLxcData: controller.displayedLxcData
+    // "sessionKey|node" -> deduplicated rows, rebuilt once per list change
+    // so each multi-host node section is a lookup, not a pass over every guest.
+    readonly property var vmRowsBySessionNode: indexRowsBySessionNode(displayedVmData)
+    readonly property var lxcRowsBySessionNode: indexRowsBySessionNode(displayedLxcData)
     property var displayedEndpoints: controller.displayedEndpoints
     property var displayedEndpointsModel: {
         var arr = []
@@ -268,10 +289,6 @@ PlasmoidItem {
     property var collapsedNodes: ({})
 
     // State tracking for notifications
-    property var previousVmStates: ({})
-    property var previousLxcStates: ({})
-    property var previousNodeStates: ({})
-    property bool initialLoadComplete: false
 
     // Anonymization data for dev mode
     readonly property var anonNodeNames: ["server-01", "server-02", "server-03", "pve-node", "cluster-main"]
@@ -416,131 +433,28 @@ PlasmoidItem {
         sendNotification("Debug logs copied")
     }
 
-
-    // Escape regex special chars except "*"
-    function escapeRegexPattern(str) {
-        if (!str) return ""
-        // Escape regex metacharacters but intentionally leave "*" untouched so
-        // shouldNotify() can expand wildcard filters into ".*" afterwards.
-        return str.replace(/[.+?^${}()|[\]\\]/g, "\\$&")
-    }
-
-    // Check if a VM/container should trigger notifications based on filter
-    function shouldNotify(name, vmid) {
-        if (notifyMode === "all") {
-            return true
-        }
-
-        // Empty filter behavior:
-        // - whitelist: nothing matches => no notifications
-        // - blacklist: nothing excluded => notify everything
-        if (!notifyFilter || notifyFilter.trim() === "") {
-            return notifyMode === "blacklist"
-        }
-
-        var filters = notifyFilter.split(",").map(function(f) {
-            return f.trim().toLowerCase()
-        }).filter(function(f) {
-            return f.length > 0
-        })
-
-        if (filters.length === 0) {
-            return notifyMode === "blacklist"
-        }
-
-        var nameL = (name || "").toLowerCase()
-        var vmidStr = String(vmid)
-
-        var matches = filters.some(function(filter) {
-            // Check for wildcard patterns
-            if (filter.indexOf("*") !== -1) {
-                // Expand literal wildcard markers only after escaping the rest of
-                // the pattern; otherwise inputs like "web*" become /^web\*$/.
-                var escaped = escapeRegexPattern(filter).replace(/\*/g, ".*")
-                var regex = new RegExp("^" + escaped + "$")
-                return regex.test(nameL) || regex.test(vmidStr)
-            }
-            // Exact match
-            return nameL === filter || vmidStr === filter
-        })
-
-        if (notifyMode === "whitelist") {
-            return matches
-        } else if (notifyMode === "blacklist") {
-            return !matches
-        }
-
-        return true
-    }
-
     ProxMon.Notifier {
         id: notifier
-    }
-
-    function shouldRateLimitNotify(key) {
-        if (!notifyRateLimitEnabled) return false
-        if (!notifyRateLimitSeconds || notifyRateLimitSeconds <= 0) return false
-        if (!key) return false
-
-        var last = notifyLastSent[key]
-        if (!last) return false
-
-        var now = Date.now()
-        return (now - last) < (notifyRateLimitSeconds * 1000)
-    }
-
-    function markNotifySent(key) {
-        if (!key) return
-        var now = Date.now()
-        var newMap = Object.assign({}, notifyLastSent)
-        newMap[key] = now
-        notifyLastSent = newMap
-    }
-
-    function sendNotification(title, message, iconName, rateLimitKey) {
-        if (!enableNotifications) {
-            return
-        }
-
-        if (rateLimitKey && shouldRateLimitNotify(rateLimitKey)) {
-            logDebug("Notification rate-limited: " + rateLimitKey)
-            return
-        }
-
-        // Prevent newlines from breaking the shell command
-        title = (title || "").replace(/[\r\n]+/g, " ")
-        message = (message || "").replace(/[\r\n]+/g, " ")
-
-        // Redact sensitive "user@realm!tokenid" fragments from notification text.
-        function redactIdentities(str) {
-            str = String(str || "")
-            // redact "user@realm" portion but preserve realm
-            str = str.replace(/([A-Za-z0-9._-]+)@([A-Za-z0-9._-]+)/g, "REDACTED@$2")
-            // redact token id portion after "!"
-            str = str.replace(/!([A-Za-z0-9._:-]+)/g, "!REDACTED")
-            return str
-        }
-
-        if (redactNotifyIdentities) {
-            title = redactIdentities(title)
-            message = redactIdentities(message)
+        enabled: root.enableNotifications
+        rateLimitEnabled: root.notifyRateLimitEnabled
+        rateLimitSeconds: root.notifyRateLimitSeconds
+        redactIdentities: root.redactNotifyIdentities
+        onFallbackRequested: function(title, message, iconName) {
+            // D-Bus notifications unavailable; fall back to notify-send.
+            var notifyCmd = "notify-send -i '" + escapeShell(iconName) + "' -a 'Proxmox Monitor' '"
+                + escapeShell(title) + "' '" + escapeShell(message) + "'"
+            executable.connectSource(notifyCmd)
         }
-
-        logDebug("Notification: " + title + " - " + message)
-
-        // Prefer D-Bus notifier; fallback to notify-send.
-        if (notifier.notify(title, message, iconName || "proxmox-monitor", 5000)) {
-            if (rateLimitKey) markNotifySent(rateLimitKey)
-            return
+        // Logged here rather than in sendNotification so the debug log only
+        // ever sees the redacted text.
+        onSent: function(title, message) {
+            logDebug("Notification: " + title + " - " + message)
         }
+    }
 
-        var safeIcon = escapeShell(iconName || "proxmox-monitor")
-        var safeTitle = escapeShell(title)
-        var safeMessage = escapeShell(message)
-
-        var notifyCmd = "notify-send -i '" + safeIcon + "' -a 'Proxmox Monitor' '" + safeTitle + "' '" + safeMessage + "'"
-        executable.connectSource(notifyCmd)
-        if (rateLimitKey) markNotifySent(rateLimitKey)
+    // Enable/rate-limit/redaction are handled by the notifier service.
+    function sendNotification(title, message, iconName, rateLimitKey) {
+        notifier.send(title || "", message || "", iconName || "", rateLimitKey || "")
     }
 
     // Test notifications function
@@ -549,310 +463,20 @@ PlasmoidItem {
         sendNotification("VM Stopped", "test-vm (100) on pve1 is now stopped", "dialog-warning")
     }
 
-    // Multi-host notification state keys must be namespaced by endpoint/session so
-    // identical node names / VMIDs on different controller.endpoints do not overwrite each other.
-    function multiHostNodeStateKey(sessionKey, nodeName) {
-        return String(sessionKey) + "::" + String(nodeName || "")
-    }
-
-    function multiHostVmStateKey(sessionKey, nodeName, vmid) {
-        return String(sessionKey) + "::" + String(nodeName || "") + "_vm_" + vmid
-    }
-
-    function multiHostLxcStateKey(sessionKey, nodeName, vmid) {
-        return String(sessionKey) + "::" + String(nodeName || "") + "_lxc_" + vmid
-    }
-
-    function pushGroupedNotificationEntry(entries, kindLabel, item) {
-        entries.push({
-            kind: kindLabel,
-            vmid: String(item.vmid),
-            name: String(item.name || item.vmid)
-        })
-    }
-
-    function formatGroupedNotificationSection(entries, kindLabel, verb) {
-        var matching = entries.filter(function(entry) {
-            return entry.kind === kindLabel
-        })
-        if (matching.length === 0) return ""
-
-        var ids = matching.map(function(entry) { return entry.vmid }).join(", ")
-        var names = matching.map(function(entry) { return entry.name }).join(", ")
-        var label = kindLabel === "CT" ? "LXCs" : (kindLabel + "s")
-        return label + ": " + ids + "  " + names
-    }
-
-    function sendGroupedNotification(entries, iconName, rateLimitKey, verb) {
-        if (!entries || entries.length === 0) return
-
-        var sections = []
-        var vmSection = formatGroupedNotificationSection(entries, "VM", verb)
-        var ctSection = formatGroupedNotificationSection(entries, "CT", verb)
-        if (vmSection) sections.push(vmSection)
-        if (ctSection) sections.push(ctSection)
-
-        if (sections.length === 0) return
-
-        var kinds = entries.map(function(entry) { return entry.kind })
-        var hasVm = kinds.indexOf("VM") !== -1
-        var hasCt = kinds.indexOf("CT") !== -1
-        var title = hasVm && !hasCt
-            ? (verb === "started" ? "VMs Started" : "VMs Stopped")
-            : hasCt && !hasVm
-            ? (verb === "started" ? "LXCs Started" : "LXCs Stopped")
-            : (verb === "started" ? "Workloads Started" : "Workloads Stopped")
-
-        sendNotification(title, sections.join("; "), iconName, rateLimitKey)
-    }
-
-    // Check for state changes and send notifications
-    function checkStateChanges() {
-        if (connectionMode === "multiHost") {
-            var multiStartedEntries = []
-            var multiStoppedEntries = []
-
-            // No displayed endpoint buckets means there is nothing stable to compare yet.
-            if (!displayedEndpoints || displayedEndpoints.length === 0) return
-
-            if (!initialLoadComplete) {
-                logDebug("checkStateChanges(multi): Initial load, recording states")
-
-                // Record initial node states
-                for (var mn = 0; mn < displayedEndpoints.length; mn++) {
-                    var endpoint = displayedEndpoints[mn]
-                    if (!endpoint || !endpoint.sessionKey || !endpoint.nodes) continue
-
-                    for (var mni = 0; mni < endpoint.nodes.length; mni++) {
-                        var multiNode = endpoint.nodes[mni]
-                        previousNodeStates[multiHostNodeStateKey(endpoint.sessionKey, multiNode.node)] = multiNode.status
-                    }
-                }
-
-                // Record initial VM states per endpoint/session. Items missing sessionKey
-                // are ignored silently so partial/malformed multi-host data does not spam logs.
-                for (var mvi = 0; mvi < displayedVmData.length; mvi++) {
-                    var multiVm = displayedVmData[mvi]
-                    if (!multiVm || !multiVm.sessionKey) continue
-                    previousVmStates[multiHostVmStateKey(multiVm.sessionKey, multiVm.node, multiVm.vmid)] = multiVm.status
-                }
-
-                // Record initial LXC states per endpoint/session.
-                for (var mli = 0; mli < displayedLxcData.length; mli++) {
-                    var multiLxc = displayedLxcData[mli]
-                    if (!multiLxc || !multiLxc.sessionKey) continue
-                    previousLxcStates[multiHostLxcStateKey(multiLxc.sessionKey, multiLxc.node, multiLxc.vmid)] = multiLxc.status
-                }
-
-                initialLoadComplete = true
-                return
-            }
-
-            // Check nodes for state changes
-            if (notifyOnNodeChange) {
-                for (var mei = 0; mei < displayedEndpoints.length; mei++) {
-                    var endpointData = displayedEndpoints[mei]
-                    if (!endpointData || !endpointData.sessionKey || !endpointData.nodes) continue
-
-                    for (var mni2 = 0; mni2 < endpointData.nodes.length; mni2++) {
-                        var nodeDataMulti = endpointData.nodes[mni2]
-                        var nodeStateKey = multiHostNodeStateKey(endpointData.sessionKey, nodeDataMulti.node)
-                        var prevNodeStateMulti = previousNodeStates[nodeStateKey]
-
-                        if (prevNodeStateMulti !== undefined && prevNodeStateMulti !== nodeDataMulti.status) {
-                            if (prevNodeStateMulti === "online" && nodeDataMulti.status !== "online") {
-                                sendNotification(
-                                    "Node Offline",
-                                    nodeDataMulti.node + " is now " + nodeDataMulti.status,
-                                    "dialog-error",
-                                    "node:" + endpointData.sessionKey + ":" + nodeDataMulti.node + ":offline"
-                                )
-                            } else if (prevNodeStateMulti !== "online" && nodeDataMulti.status === "online") {
-                                sendNotification(
-                                    "Node Online",
-                                    nodeDataMulti.node + " is back online",
-                                    "dialog-information",
-                                    "node:" + endpointData.sessionKey + ":" + nodeDataMulti.node + ":online"
-                                )
-                            }
-                        }
-                        previousNodeStates[nodeStateKey] = nodeDataMulti.status
-                    }
-                }
-            }
-
-            // Check VMs for state changes per endpoint/session while keeping existing
-            // notification content and rate-limit keys unchanged.
-            for (var mvm = 0; mvm < displayedVmData.length; mvm++) {
-                var vmItemMulti = displayedVmData[mvm]
-                if (!vmItemMulti || !vmItemMulti.sessionKey) continue
-
-                var vmStateKeyMulti = multiHostVmStateKey(vmItemMulti.sessionKey, vmItemMulti.node, vmItemMulti.vmid)
-                var prevVmStateMulti = previousVmStates[vmStateKeyMulti]
-
-                if (prevVmStateMulti !== undefined && prevVmStateMulti !== vmItemMulti.status) {
-                    if (shouldNotify(vmItemMulti.name, vmItemMulti.vmid)) {
-                        if (notifyOnStop && prevVmStateMulti === "running" && vmItemMulti.status !== "running") {
-                            pushGroupedNotificationEntry(multiStoppedEntries, "VM", vmItemMulti)
-                        } else if (notifyOnStart && prevVmStateMulti !== "running" && vmItemMulti.status === "running") {
-                            pushGroupedNotificationEntry(multiStartedEntries, "VM", vmItemMulti)
-                        }
-                    }
-                        // Safety-net: clear busy spinner if status changed                    if (root.isActionBusy(vmItemMulti.node, "qemu", vmItemMulti.vmid, vmItemMulti.sessionKey))
-                        root.setActionBusy(vmItemMulti.node, "qemu", vmItemMulti.vmid, false, vmItemMulti.sessionKey)
-                }
-                previousVmStates[vmStateKeyMulti] = vmItemMulti.status
-            }
-
-            // Check LXCs for state changes per endpoint/session while keeping existing
-            // notification content and rate-limit keys unchanged.
-            for (var mlx = 0; mlx < displayedLxcData.length; mlx++) {
-                var lxcItemMulti = displayedLxcData[mlx]
-                if (!lxcItemMulti || !lxcItemMulti.sessionKey) continue
-
-                var lxcStateKeyMulti = multiHostLxcStateKey(lxcItemMulti.sessionKey, lxcItemMulti.node, lxcItemMulti.vmid)
-                var prevLxcStateMulti = previousLxcStates[lxcStateKeyMulti]
-
-                if (prevLxcStateMulti !== undefined && prevLxcStateMulti !== lxcItemMulti.status) {
-                    if (shouldNotify(lxcItemMulti.name, lxcItemMulti.vmid)) {
-                        if (notifyOnStop && prevLxcStateMulti === "running" && lxcItemMulti.status !== "running") {
-                            pushGroupedNotificationEntry(multiStoppedEntries, "CT", lxcItemMulti)
-                        } else if (notifyOnStart && prevLxcStateMulti !== "running" && lxcItemMulti.status === "running") {
-                            pushGroupedNotificationEntry(multiStartedEntries, "CT", lxcItemMulti)
-                        }
-                    }
-                    // Safety-net: clear busy spinner if status changed
-                    if (root.isActionBusy(lxcItemMulti.node, "lxc", lxcItemMulti.vmid, lxcItemMulti.sessionKey))
-                        root.setActionBusy(lxcItemMulti.node, "lxc", lxcItemMulti.vmid, false, lxcItemMulti.sessionKey)
-                }
-                previousLxcStates[lxcStateKeyMulti] = lxcItemMulti.status
-            }
-
-            logDebug("checkStateChanges(multi): started=" + multiStartedEntries.length + " stopped=" + multiStoppedEntries.length)
-            sendGroupedNotification(multiStartedEntries,
-                                    "dialog-information",
-                                    "grouped:multi:running:" + multiStartedEntries.map(function(entry) { return entry.kind + ":" + entry.vmid }).sort().join(","),
-                                    "started")
-            sendGroupedNotification(multiStoppedEntries,
-                                    "dialog-warning",
-                                    "grouped:multi:stopped:" + multiStoppedEntries.map(function(entry) { return entry.kind + ":" + entry.vmid }).sort().join(","),
-                                    "stopped")
-            return
-        }
-
-        var startedEntries = []
-        var stoppedEntries = []
-
-        if (!initialLoadComplete) {
-            // Record initial node states
-            if (displayedProxmoxData && displayedProxmoxData.data) {
-                for (var n = 0; n < displayedProxmoxData.data.length; n++) {
-                    var node = displayedProxmoxData.data[n]
-                    previousNodeStates[node.node] = node.status
-                }
-            }
-
-            // Record initial VM states
-            for (var i = 0; i < displayedVmData.length; i++) {
-                var vm = displayedVmData[i]
-                var vmKey = vm.node + "_vm_" + vm.vmid
-                previousVmStates[vmKey] = vm.status
-            }
-
-            // Record initial LXC states
-            for (var j = 0; j < displayedLxcData.length; j++) {
-                var lxc = displayedLxcData[j]
-                var lxcKey = lxc.node + "_lxc_" + lxc.vmid
-                previousLxcStates[lxcKey] = lxc.status
-            }
-
-            initialLoadComplete = true
-            return
-        }
-
-        // Check nodes for state changes
-        if (notifyOnNodeChange && displayedProxmoxData && displayedProxmoxData.data) {
-            for (var ni = 0; ni < displayedProxmoxData.data.length; ni++) {
-                var nodeData = displayedProxmoxData.data[ni]
-                var prevNodeState = previousNodeStates[nodeData.node]
-
-                if (prevNodeState !== undefined && prevNodeState !== nodeData.status) {
-                    if (prevNodeState === "online" && nodeData.status !== "online") {
-                        sendNotification(
-                            "Node Offline",
-                            nodeData.node + " is now " + nodeData.status,
-                            "dialog-error",
-                            "node:" + nodeData.node + ":offline"
-                        )
-                    } else if (prevNodeState !== "online" && nodeData.status === "online") {
-                        sendNotification(
-                            "Node Online",
-                            nodeData.node + " is back online",
-                            "dialog-information",
-                            "node:" + nodeData.node + ":online"
-                        )
-                    }
-                }
-                previousNodeStates[nodeData.node] = nodeData.status
-            }
+    // Controller-detected state transitions: clear busy spinners here, hand
+    // the list to the notifier, which batches, groups and rate-limits.
+    function handleStateTransitions(transitions) {
+        var multi = connectionMode === "multiHost"
+        for (var i = 0; i < transitions.length; i++) {
+            var t = transitions[i]
+            if (t.type === "node") continue
+            logDebug("stateTransitions: " + t.type + " " + t.name + " changed from " + t.previous + " to " + t.current)
+            // Safety-net: clear busy spinner if status changed
+            var busyKey = multi ? t.sessionKey : undefined
+            if (root.isActionBusy(t.node, t.type, t.vmid, busyKey))
+                root.setActionBusy(t.node, t.type, t.vmid, false, busyKey)
         }
-
-        // Check VMs for state changes
-        for (var vi = 0; vi < displayedVmData.length; vi++) {
-            var vmItem = displayedVmData[vi]
-            var vmStateKey = vmItem.node + "_vm_" + vmItem.vmid
-            var prevVmState = previousVmStates[vmStateKey]
-
-            if (prevVmState !== undefined && prevVmState !== vmItem.status) {
-                logDebug("checkStateChanges: VM " + vmItem.name + " changed from " + prevVmState + " to " + vmItem.status)
-
-                // Check if this VM should trigger notifications
-                if (shouldNotify(vmItem.name, vmItem.vmid)) {
-                    if (notifyOnStop && prevVmState === "running" && vmItem.status !== "running") {
-                        pushGroupedNotificationEntry(stoppedEntries, "VM", vmItem)
-                    } else if (notifyOnStart && prevVmState !== "running" && vmItem.status === "running") {
-                        pushGroupedNotificationEntry(startedEntries, "VM", vmItem)
-                    }
-                }
-                // Safety-net: clear busy spinner if status changed
-                if (root.isActionBusy(vmItem.node, "qemu", vmItem.vmid))
-                    root.setActionBusy(vmItem.node, "qemu", vmItem.vmid, false)
-            }
-            previousVmStates[vmStateKey] = vmItem.status
-        }
-
-        // Check LXCs for state changes
-        for (var li = 0; li < displayedLxcData.length; li++) {
-            var lxcItem = displayedLxcData[li]
-            var lxcStateKey = lxcItem.node + "_lxc_" + lxcItem.vmid
-            var prevLxcState = previousLxcStates[lxcStateKey]
-
-            if (prevLxcState !== undefined && prevLxcState !== lxcItem.status) {
-                logDebug("checkStateChanges: LXC " + lxcItem.name + " changed from " + prevLxcState + " to " + lxcItem.status)
-
-                // Check if this LXC should trigger notifications
-                if (shouldNotify(lxcItem.name, lxcItem.vmid)) {
-                    if (notifyOnStop && prevLxcState === "running" && lxcItem.status !== "running") {
-                        pushGroupedNotificationEntry(stoppedEntries, "CT", lxcItem)
-                    } else if (notifyOnStart && prevLxcState !== "running" && lxcItem.status === "running") {
-                        pushGroupedNotificationEntry(startedEntries, "CT", lxcItem)
-                    }
-                }
-                // Safety-net: clear busy spinner if status changed
-                if (root.isActionBusy(lxcItem.node, "lxc", lxcItem.vmid))
-                    root.setActionBusy(lxcItem.node, "lxc", lxcItem.vmid, false)
-            }
-            previousLxcStates[lxcStateKey] = lxcItem.status
-        }
-
-        sendGroupedNotification(startedEntries,
-                                "dialog-information",
-                                "grouped:single:running:" + startedEntries.map(function(entry) { return entry.kind + ":" + entry.vmid }).sort().join(","),
-                                "started")
-        sendGroupedNotification(stoppedEntries,
-                                "dialog-warning",
-                                "grouped:single:stopped:" + stoppedEntries.map(function(entry) { return entry.kind + ":" + entry.vmid }).sort().join(","),
-                                "stopped")
+        notifier.queueTransitions(transitions)
     }
 
 
@@ -864,24 +488,25 @@ PlasmoidItem {
         return sortByStatus(nodeVms)
     }
 
-    function getVmsForNodeMulti(sessionKey, nodeName) {
-        var arr = []
-        for (var i = 0; i < displayedEndpoints.length; i++) {
-            var b = displayedEndpoints[i]
-            if (!b || b.sessionKey !== sessionKey) continue
-            arr = b.vms.filter(function(vm) {
-                return vm.node === nodeName
-            })
-            break
-        }
+    // displayedVmData/displayedLxcData carry the correlated backup fields;
+    // the per-endpoint buckets do not.
+    function indexRowsBySessionNode(rows) {
+        var index = ({})
         var seen = ({})
-        var deduped = arr.filter(function(vm) {
-            var key = String(sessionKey) + "::" + String(vm.node || "") + "::vm::" + String(vm.vmid)
-            if (seen[key]) return false
-            seen[key] = true
-            return true
-        })
-        return sortByStatus(deduped)
+        for (var i = 0; i < rows.length; i++) {
+            var row = rows[i]
+            var key = String(row.sessionKey) + "|" + String(row.node || "")
+            var rowKey = key + "|" + String(row.vmid)
+            if (seen[rowKey]) continue
+            seen[rowKey] = true
+            if (!index[key]) index[key] = []
+            index[key].push(row)
+        }
+        return index
+    }
+
+    function getVmsForNodeMulti(sessionKey, nodeName) {
+        return sortByStatus(vmRowsBySessionNode[String(sessionKey) + "|" + String(nodeName || "")] || [])
     }
 
     // Get LXCs for a specific node (use displayed data)
@@ -893,23 +518,7 @@ PlasmoidItem {
     }
 
     function getLxcForNodeMulti(sessionKey, nodeName) {
-        var arr2 = []
-        for (var i2 = 0; i2 < displayedEndpoints.length; i2++) {
-            var b2 = displayedEndpoints[i2]
-            if (!b2 || b2.sessionKey !== sessionKey) continue
-            arr2 = b2.lxcs.filter(function(lxc) {
-                return lxc.node === nodeName
-            })
-            break
-        }
-        var seen = ({})
-        var deduped = arr2.filter(function(lxc) {
-            var key = String(sessionKey) + "::" + String(lxc.node || "") + "::lxc::" + String(lxc.vmid)
-            if (seen[key]) return false
-            seen[key] = true
-            return true
-        })
-        return sortByStatus(deduped)
+        return sortByStatus(lxcRowsBySessionNode[String(sessionKey) + "|" + String(nodeName || "")] || [])
     }
 
     // Get running VM count for a node (use displayed data)
@@ -1194,10 +803,7 @@ PlasmoidItem {
         if (reason === "connectionMode" || reason === "multiHostsJson"
                 || reason === "proxmoxHost" || reason === "proxmoxPort"
                 || reason === "apiTokenId" || reason === "apiTokenSecret") {
-            previousVmStates = ({})
-            previousLxcStates = ({})
-            previousNodeStates = ({})
-            initialLoadComplete = false
+            controller.resetTransitionBaseline()
         }
 
         // If secrets need re-resolving (e.g. token changed), resolveSecretIfNeeded() handlers will do it.
@@ -1257,11 +863,8 @@ PlasmoidItem {
 
     Connections {
         target: controller
-        function onDisplayedEndpointsChanged() {
-            root.checkStateChanges()
-        }
-        function onIsRefreshingChanged() {
-            if (!controller.isRefreshing && root.connectionMode !== "multiHost") root.checkStateChanges()
+        function onStateTransitions(transitions) {
+            root.handleStateTransitions(transitions)
         }
         function onErrorMessageChanged() {
             if (controller.errorMessage !== "") root.errorMessage = controller.errorMessage
@@ -1272,6 +875,16 @@ PlasmoidItem {
         function onActionReply(sessionKey, actionKind, node, vmid, action, data) {
             root.setActionBusy(node, actionKind, vmid, false, sessionKey)
         }
+        function onConsoleOpening(sessionKey, host, node, kind, vmid, vmName, apiPort, ignoreSsl) {
+            // Build the window while the keyring read / vncproxy POST run;
+            // onConsoleReady then finds it and only starts the session.
+            if (root.openConsoles[kind + ":" + vmid]) return
+            root.createVncConsole(sessionKey, host, node, kind, vmid, vmName, 0, apiPort, ignoreSsl)
+        }
+        function onConsoleOpenTimed(sessionKey, kind, node, vmid, timeline) {
+            var win = root.openConsoles[kind + ":" + vmid]
+            if (win && win.sessionKey === sessionKey) win.openTimeline = timeline
+        }
         function onConsoleReady(sessionKey, host, node, kind, vmid, vmName, vncPort, apiPort, ignoreSsl) {
             var key = kind + ":" + vmid
             if (root.openConsoles[key]) {
@@ -1281,23 +894,7 @@ PlasmoidItem {
                 root.openConsoles[key].requestActivate()
                 return
             }
-            var win = consoleComponent.createObject(root, {
-                controller: controller,
-                host: host,
-                nodeName: node,
-                vmid: vmid,
-                vmName: vmName || (kind + " " + vmid),
-                vncPort: vncPort,
-                sessionKey: sessionKey,
-                kind: kind,
-                apiPort: apiPort,
-                ignoreSsl: ignoreSsl
-            })
-            root.openConsoles[key] = win
-            win.closing.connect(function() { delete root.openConsoles[key] })
-            win.requestReconnect.connect(function() {
-                controller.openConsole(win.sessionKey, win.kind, win.nodeName, win.vmid, win.vmName)
-            })
+            root.createVncConsole(sessionKey, host, node, kind, vmid, vmName, vncPort, apiPort, ignoreSsl)
         }
         function onLxcConsoleReady(sessionKey, host, apiPort, node, vmid, vmName, proxyPort, user, ignoreSsl) {
             var key = "lxc:" + vmid
@@ -1336,7 +933,12 @@ PlasmoidItem {
             controller.deliverConsoleTicket(sessionKey, term)
             term.open(host, apiPort, node, vmid, label, proxyPort, user, ignoreSsl)
         }
+        function onThumbnailsChanged() {
+            root.thumbnailGeneration++
+        }
         function onConsoleError(node, kind, vmid, message) {
+            var win = root.openConsoles[kind + ":" + vmid]
+            if (win && win.openFailed) win.openFailed(message)
             root.errorMessage = "Console failed: " + message
         }
         function onActionError(sessionKey, actionKind, node, vmid, action, message) {
@@ -1352,6 +954,28 @@ PlasmoidItem {
         }
     }
 
+    // vncPort 0: opened ahead of the vncproxy reply (consoleOpening).
+    function createVncConsole(sessionKey, host, node, kind, vmid, vmName, vncPort, apiPort, ignoreSsl) {
+        var key = kind + ":" + vmid
+        var win = consoleComponent.createObject(root, {
+            controller: controller,
+            host: host,
+            nodeName: node,
+            vmid: vmid,
+            vmName: vmName || (kind + " " + vmid),
+            vncPort: vncPort,
+            sessionKey: sessionKey,
+            kind: kind,
+            apiPort: apiPort,
+            ignoreSsl: ignoreSsl
+        })
+        root.openConsoles[key] = win
+        win.closing.connect(function() { delete root.openConsoles[key] })
+        win.requestReconnect.connect(function() {
+            controller.openConsole(win.sessionKey, win.kind, win.nodeName, win.vmid, win.vmName)
+        })
+    }
+
     function resolveSecretIfNeeded() {
         controller.resolveSecretsIfNeeded()
     }
@@ -1813,6 +1437,13 @@ PlasmoidItem {
                         }
                         consoleEnabled: Plasmoid.configuration.consoleEnabled !== false
                         powerActionsEnabled: Plasmoid.configuration.powerActionsEnabled !== false
+                        thumbnailsEnabled: root.thumbnailsEnabled
+                        thumbnailSource: function(nodeName, vmid) {
+                            return root.thumbnailUrl("", nodeName, vmid)
+                        }
+                        watchThumbnail: function(watch, nodeName, vmid) {
+                            controller.watchThumbnail("", nodeName, vmid, watch)
+                        }
                     }
                 }
 
@@ -1868,6 +1499,11 @@ PlasmoidItem {
                         }
                         consoleEnabled: Plasmoid.configuration.consoleEnabled !== false
                         powerActionsEnabled: Plasmoid.configuration.powerActionsEnabled !== false
+                        thumbnailsEnabled: root.thumbnailsEnabled
+                        thumbnailSource: root.thumbnailUrl
+                        watchThumbnail: function(sessionKey, watch, nodeName, vmid) {
+                            controller.watchThumbnail(sessionKey, nodeName, vmid, watch)
+                        }
                     }
                 }
 